@@ -0,0 +1,374 @@
+// Throughput and latency benchmarks for the chx channels.
+//
+// Every case moves a fixed number of messages from P producer threads to C
+// consumer threads. Each message carries the time at which it was sent, so
+// consumers record its latency. Results are printed as CSV (default) or JSON,
+// one row per case, so runs on different commits can be diffed.
+//
+// Usage: chx_bench [--messages N] [--filter TEXT] [--format csv|json]
+//                  [--output FILE] [--no-pin]
+
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/backoff.hpp"
+#include "chx/channel_factory.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ *  @brief Message of `Size` bytes. The first 8 bytes hold the send time.
+ * */
+template <std::size_t Size> struct Payload {
+  static_assert(Size > sizeof(std::int64_t));
+  std::int64_t sent_at = 0;
+  std::array<std::byte, Size - sizeof(std::int64_t)> data{};
+};
+
+template <> struct Payload<sizeof(std::int64_t)> {
+  std::int64_t sent_at = 0;
+};
+
+std::int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+struct Options {
+  std::size_t messages = 200000;
+  std::string filter;
+  bool json = false;
+  bool pin = true;
+  std::string output;
+};
+
+struct Topology {
+  const char *name;
+  unsigned producers;
+  unsigned consumers;
+};
+
+constexpr std::array<Topology, 3> topologies = {{
+    {"spsc", 1, 1},
+    {"mpsc", 4, 1},
+    {"mpmc", 4, 4},
+}};
+
+/**
+ *  @brief Which side polls with `try_*` instead of blocking. There is no case
+ *  where both sides poll: two polling threads never meet on an unbuffered
+ *  channel.
+ * */
+enum class Api { blocking, try_send, try_receive };
+
+constexpr std::array<Api, 3> apis = {Api::blocking, Api::try_send,
+                                     Api::try_receive};
+
+const char *to_string(Api api) {
+  switch (api) {
+  case Api::try_send:
+    return "try_send";
+  case Api::try_receive:
+    return "try_receive";
+  case Api::blocking:
+    break;
+  }
+  return "blocking";
+}
+
+struct Result {
+  std::string channel;
+  std::size_t capacity;
+  Topology topology;
+  std::size_t payload;
+  Api api;
+  std::size_t messages;
+  double seconds;
+  std::int64_t p50, p90, p99, p999, max;
+};
+
+/**
+ *  @brief Pins the calling thread to `cpu` (modulo the number of cores).
+ * */
+void pin_to_core(unsigned cpu) {
+#if defined(__linux__)
+  const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % cores, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  (void)cpu;
+#endif
+}
+
+std::int64_t percentile(std::vector<std::int64_t> &samples, double p) {
+  if (samples.empty()) {
+    return 0;
+  }
+  const auto index = static_cast<std::size_t>(p * (samples.size() - 1));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index];
+}
+
+template <typename Message, typename Handle>
+Result run_case(Handle ch, std::string channel, std::size_t capacity,
+                const Topology &topology, Api api, const Options &options) {
+  const std::size_t per_producer = options.messages / topology.producers;
+  const std::size_t total = per_producer * topology.producers;
+  std::atomic<std::size_t> received{0};
+  std::atomic<unsigned> ready{0};
+  std::atomic<bool> start{false};
+  std::vector<std::vector<std::int64_t>> latencies(topology.consumers);
+  std::vector<std::thread> producers;
+  std::vector<std::thread> consumers;
+  const unsigned threads = topology.producers + topology.consumers;
+
+  auto wait_start = [&](unsigned cpu) {
+    if (options.pin) {
+      pin_to_core(cpu);
+    }
+    ready++;
+    while (!start.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  };
+
+  for (unsigned c = 0; c < topology.consumers; c++) {
+    consumers.emplace_back([&, c, rx = ch.make_receiver()]() mutable {
+      auto &samples = latencies[c];
+      samples.reserve(total);
+      wait_start(topology.producers + c);
+      chx::detail::Backoff backoff;
+      for (;;) {
+        auto message =
+            api == Api::try_receive ? rx.try_receive() : rx.receive();
+        if (!message.has_value()) {
+          if (message.error() == chx::Error::would_block) {
+            backoff.snooze();
+            continue;
+          }
+          break;
+        }
+        backoff = {};
+        samples.push_back(now_ns() - message->sent_at);
+        received.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+  for (unsigned p = 0; p < topology.producers; p++) {
+    producers.emplace_back([&, p, tx = ch.make_sender()]() mutable {
+      wait_start(p);
+      Message message;
+      for (std::size_t i = 0; i < per_producer; i++) {
+        message.sent_at = now_ns();
+        if (api != Api::try_send) {
+          tx.send(message);
+          continue;
+        }
+        // The latency of a try_send counts from its successful attempt.
+        chx::detail::Backoff backoff;
+        while (!tx.try_send(message).has_value()) {
+          backoff.snooze();
+          message.sent_at = now_ns();
+        }
+      }
+    });
+  }
+
+  while (ready.load() != threads) {
+    std::this_thread::yield();
+  }
+  const auto begin = Clock::now();
+  start.store(true, std::memory_order_release);
+  for (auto &t : producers) {
+    t.join();
+  }
+  while (received.load(std::memory_order_relaxed) != total) {
+    std::this_thread::yield();
+  }
+  const auto end = Clock::now();
+  ch.close();
+  for (auto &t : consumers) {
+    t.join();
+  }
+
+  std::vector<std::int64_t> samples;
+  samples.reserve(total);
+  for (auto &l : latencies) {
+    samples.insert(samples.end(), l.begin(), l.end());
+  }
+  Result result{std::move(channel),
+                capacity,
+                topology,
+                sizeof(Message),
+                api,
+                total,
+                std::chrono::duration<double>(end - begin).count(),
+                0,
+                0,
+                0,
+                0,
+                0};
+  result.p50 = percentile(samples, 0.50);
+  result.p90 = percentile(samples, 0.90);
+  result.p99 = percentile(samples, 0.99);
+  result.p999 = percentile(samples, 0.999);
+  result.max = samples.empty() ? 0
+                               : *std::max_element(samples.begin(),
+                                                   samples.end());
+  return result;
+}
+
+class Suite {
+public:
+  explicit Suite(Options options) : options_(std::move(options)) {}
+
+  template <std::size_t PayloadSize> void run_payload() {
+    using Message = Payload<PayloadSize>;
+    this->run_buffered<Message, 1>();
+    this->run_buffered<Message, 64>();
+    this->run_buffered<Message, 1024>();
+    this->run_all<Message>("unbuffered", 0,
+                           [] { return chx::CreateChannel<Message>(); });
+  }
+
+  const std::vector<Result> &results() const { return this->results_; }
+
+private:
+  template <typename Message, std::size_t Capacity> void run_buffered() {
+    this->run_all<Message>("buffered", Capacity, [] {
+      return chx::CreateChannel<Message, Capacity>();
+    });
+  }
+
+  template <typename Message, typename Factory>
+  void run_all(const char *channel, std::size_t capacity, Factory factory) {
+    for (const Topology &topology : topologies) {
+      for (Api api : apis) {
+        const std::string name =
+            std::string(channel) + "/" + std::to_string(capacity) + "/" +
+            topology.name + "/" + std::to_string(sizeof(Message)) + "B/" +
+            to_string(api);
+        if (name.find(this->options_.filter) == std::string::npos) {
+          continue;
+        }
+        std::cerr << "running " << name << "\n";
+        this->results_.push_back(run_case<Message>(
+            factory(), channel, capacity, topology, api, this->options_));
+      }
+    }
+  }
+
+  Options options_;
+  std::vector<Result> results_;
+};
+
+void write_csv(std::ostream &out, const std::vector<Result> &results) {
+  out << "channel,capacity,topology,producers,consumers,payload_bytes,api,"
+         "messages,seconds,msgs_per_sec,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n";
+  for (const Result &r : results) {
+    out << r.channel << ',' << r.capacity << ',' << r.topology.name << ','
+        << r.topology.producers << ',' << r.topology.consumers << ','
+        << r.payload << ',' << to_string(r.api) << ',' << r.messages << ','
+        << r.seconds << ','
+        << static_cast<std::uint64_t>(r.messages / r.seconds) << ','
+        << r.p50 << ',' << r.p90 << ',' << r.p99 << ',' << r.p999 << ','
+        << r.max << '\n';
+  }
+}
+
+void write_json(std::ostream &out, const std::vector<Result> &results) {
+  out << "[\n";
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    out << "  {\"channel\": \"" << r.channel << "\", \"capacity\": "
+        << r.capacity << ", \"topology\": \"" << r.topology.name
+        << "\", \"producers\": " << r.topology.producers
+        << ", \"consumers\": " << r.topology.consumers
+        << ", \"payload_bytes\": " << r.payload << ", \"api\": \""
+        << to_string(r.api) << "\", \"messages\": " << r.messages
+        << ", \"seconds\": " << r.seconds << ", \"msgs_per_sec\": "
+        << static_cast<std::uint64_t>(r.messages / r.seconds)
+        << ", \"p50_ns\": " << r.p50 << ", \"p90_ns\": " << r.p90
+        << ", \"p99_ns\": " << r.p99 << ", \"p999_ns\": " << r.p999
+        << ", \"max_ns\": " << r.max << "}"
+        << (i + 1 == results.size() ? "\n" : ",\n");
+  }
+  out << "]\n";
+}
+
+bool parse(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--messages" && has_value) {
+      options.messages = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--filter" && has_value) {
+      options.filter = argv[++i];
+    } else if (arg == "--format" && has_value) {
+      options.json = std::string_view(argv[++i]) == "json";
+    } else if (arg == "--output" && has_value) {
+      options.output = argv[++i];
+    } else if (arg == "--no-pin") {
+      options.pin = false;
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--messages N] [--filter TEXT] [--format csv|json]"
+                   " [--output FILE] [--no-pin]\n";
+      return false;
+    }
+  }
+  options.messages = std::max<std::size_t>(options.messages, 4);
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse(argc, argv, options)) {
+    return EXIT_FAILURE;
+  }
+  Suite suite(options);
+  suite.run_payload<8>();
+  suite.run_payload<64>();
+  suite.run_payload<512>();
+  suite.run_payload<4096>();
+
+  std::ofstream file;
+  if (!options.output.empty()) {
+    file.open(options.output);
+    if (!file) {
+      std::cerr << "cannot open " << options.output << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream &out = options.output.empty() ? std::cout : file;
+  if (options.json) {
+    write_json(out, suite.results());
+  } else {
+    write_csv(out, suite.results());
+  }
+  return EXIT_SUCCESS;
+}
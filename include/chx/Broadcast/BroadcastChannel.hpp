@@ -0,0 +1,659 @@
+#pragma once
+
+#include "chx/Buffered/circular_queue.hpp"
+#include "chx/cache_line.hpp"
+#include "chx/channelCore.hpp"
+#include "chx/receive_iterator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace chx::broadcast {
+
+/**
+ *  @brief Read position of one subscriber: the index of the next message it
+ *  receives. Each one has its own cache line, since its subscriber moves it
+ *  on every receive.
+ * */
+struct alignas(cache_line_size) Cursor {
+  std::atomic<std::size_t> position{0};
+};
+
+/**
+ *  @brief Core of a broadcast channel: a ring of `Capacity` messages, each
+ *  stored once and received by every subscriber, like a disruptor. Every
+ *  subscriber keeps its own cursor into the ring, so neither memory nor the
+ *  cost of a send depend on the number of subscribers.
+ *
+ *  A message stays in the ring until the slowest subscriber received it:
+ *  senders block (or `try_send` fails) while the ring holds `Capacity`
+ *  messages that some subscriber did not receive yet. Subscribers never take
+ *  a lock while there are messages for them; senders take one to serialize
+ *  with each other, and only look at the cursors when the ring seems full.
+ *  New subscribers start at the head, with the next message sent.
+ *
+ *  It is used through `Sender` and `Subscriber` handles, built by
+ *  `CreateBroadcastChannel`.
+ * */
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+class Channel {
+public:
+  Channel() = default;
+  ~Channel();
+
+  Channel(const Channel &) = delete;
+  Channel &operator=(const Channel &) = delete;
+
+  /**
+   *  @brief Sends an object constructed from `args` to every subscriber. This
+   *  method blocks the thread until the slowest subscriber leaves room for
+   *  it, or `deadline` expires.
+   * */
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  std::expected<void, Error> send(Deadline deadline, Args &&...args);
+
+  /**
+   *  @brief Sends `value` to every subscriber if there is room for it right
+   *  away.
+   * */
+  template <typename U>
+    requires std::constructible_from<T, U &&>
+  std::expected<void, Error> try_send(U &&value);
+
+  /**
+   *  @brief Waits until there is a message at `cursor`, or `deadline`
+   *  expires, and calls `visit` with it, in place. The cursor moves on once
+   *  `visit` returns.
+   *  @returns What `visit` returned, or an `Error` if the operation failed.
+   * */
+  template <typename Visitor>
+    requires std::invocable<Visitor &, const T &>
+  std::expected<std::invoke_result_t<Visitor &, const T &>, Error>
+  receive(Cursor &cursor, Deadline deadline, Visitor &&visit);
+
+  /**
+   *  @brief Copies the messages at `cursor` into `out`, waiting for at least
+   *  `min` of them, and moves the cursor once past all of them.
+   *  @returns The number of messages copied, or an `Error` if none could be
+   *  received.
+   * */
+  std::expected<std::size_t, Error> receive_many(Cursor &cursor,
+                                                 std::span<T> out,
+                                                 std::size_t min,
+                                                 std::size_t max)
+    requires std::copyable<T>;
+
+  /**
+   *  @brief Registers a new cursor at the head of the ring.
+   * */
+  std::unique_ptr<Cursor> subscribe();
+
+  /**
+   *  @brief Removes `cursor`, so senders no longer wait for it.
+   * */
+  void unsubscribe(Cursor &cursor);
+
+  /**
+   *  @returns The number of messages sent that `cursor` did not receive yet.
+   * */
+  std::size_t pending(const Cursor &cursor) const {
+    return this->tail.load(std::memory_order_acquire) -
+           cursor.position.load(std::memory_order_relaxed);
+  }
+
+  std::size_t subscribers() const {
+    std::lock_guard lock(this->mutex);
+    return this->cursors.size();
+  }
+
+  void close();
+  bool is_closed() const {
+    return this->closed.load(std::memory_order_acquire);
+  }
+
+private:
+  /**
+   *  @returns True if the slot of message `index` is free, that is, if every
+   *  subscriber received the message stored there before. Must be called
+   *  with `send_mutex` held.
+   * */
+  bool has_room(std::size_t index);
+
+  /**
+   *  @brief Waits, without `send_mutex`, until the slot of message `index`
+   *  may be free, the head moves, or `deadline` expires.
+   *  @returns False if `deadline` expired.
+   * */
+  bool wait_room(std::size_t index, Deadline deadline);
+
+  /**
+   *  @brief Stores the message `index` and publishes it. Must be called with
+   *  `send_mutex` held, once the slot is free.
+   * */
+  template <typename... Args> void publish(std::size_t index, Args &&...args);
+
+  /**
+   *  @returns The smallest cursor position, or `index` if there are no
+   *  subscribers. Must be called with `mutex` held.
+   * */
+  std::size_t slowest(std::size_t index) const;
+
+  /**
+   *  @brief Waits until there is a message at `position`, or `deadline`
+   *  expires.
+   *  @returns False if the channel was closed or `deadline` expired, leaving
+   *  the reason in `error`.
+   * */
+  bool wait_message(std::size_t position, Deadline deadline, Error &error);
+
+  void wake_subscribers();
+  void wake_senders();
+
+  T *slot(std::size_t index) {
+    return this->ring.data() + index % Capacity;
+  }
+
+  buffered::InlineRing<T, Capacity> ring;
+
+  // Index of the next message sent. Written by the sender holding
+  // `send_mutex`, read by every subscriber.
+  alignas(cache_line_size) std::atomic<std::size_t> tail{0};
+  // Slowest cursor position seen by the senders. Guarded by `send_mutex`.
+  std::size_t gate = 0;
+  std::mutex send_mutex;
+
+  alignas(cache_line_size) std::atomic<bool> closed{false};
+  std::atomic<std::size_t> senders_waiting{0};
+  std::atomic<std::size_t> subscribers_waiting{0};
+  mutable std::mutex mutex;
+  std::condition_variable not_full;
+  std::condition_variable not_empty;
+  std::vector<Cursor *> cursors;
+};
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+Channel<T, Capacity>::~Channel() {
+  const std::size_t end = this->tail.load(std::memory_order_relaxed);
+  const std::size_t begin = end > Capacity ? end - Capacity : 0;
+  for (std::size_t index = begin; index < end; ++index) {
+    std::destroy_at(this->slot(index));
+  }
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+template <typename... Args>
+  requires std::constructible_from<T, Args &&...>
+std::expected<void, Error> Channel<T, Capacity>::send(Deadline deadline,
+                                                      Args &&...args) {
+  std::unique_lock send_lock(this->send_mutex);
+  for (;;) {
+    if (this->closed.load(std::memory_order_acquire)) {
+      return std::unexpected(Error::closed);
+    }
+    const std::size_t index = this->tail.load(std::memory_order_relaxed);
+    if (this->has_room(index)) {
+      this->publish(index, std::forward<Args>(args)...);
+      return {};
+    }
+    // Other senders go on (and fail or park too) while this one waits.
+    send_lock.unlock();
+    if (!this->wait_room(index, deadline)) {
+      return std::unexpected(Error::timeout);
+    }
+    send_lock.lock();
+  }
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+template <typename U>
+  requires std::constructible_from<T, U &&>
+std::expected<void, Error> Channel<T, Capacity>::try_send(U &&value) {
+  std::lock_guard send_lock(this->send_mutex);
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  const std::size_t index = this->tail.load(std::memory_order_relaxed);
+  if (!this->has_room(index)) {
+    return std::unexpected(Error::would_block);
+  }
+  this->publish(index, std::forward<U>(value));
+  return {};
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+bool Channel<T, Capacity>::has_room(std::size_t index) {
+  if (index - this->gate < Capacity) {
+    return true;
+  }
+  std::lock_guard lock(this->mutex);
+  this->gate = this->slowest(index);
+  return index - this->gate < Capacity;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+bool Channel<T, Capacity>::wait_room(std::size_t index, Deadline deadline) {
+  std::unique_lock lock(this->mutex);
+  this->senders_waiting.fetch_add(1, std::memory_order_relaxed);
+  // Pairs with the fence in `wake_senders`: either the subscriber sees our
+  // counter, or we see the cursor it has just moved.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const bool ready =
+      detail::wait_until(this->not_full, lock, deadline, [&] {
+        return index - this->slowest(index) < Capacity ||
+               this->tail.load(std::memory_order_relaxed) != index ||
+               this->closed.load(std::memory_order_acquire);
+      });
+  this->senders_waiting.fetch_sub(1, std::memory_order_relaxed);
+  return ready;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+template <typename... Args>
+void Channel<T, Capacity>::publish(std::size_t index, Args &&...args) {
+  if (index >= Capacity) {
+    std::destroy_at(this->slot(index));
+  }
+  std::construct_at(this->slot(index), std::forward<Args>(args)...);
+  this->tail.store(index + 1, std::memory_order_release);
+  this->wake_subscribers();
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+std::size_t Channel<T, Capacity>::slowest(std::size_t index) const {
+  std::size_t position = index;
+  for (const Cursor *cursor : this->cursors) {
+    position = std::min(position,
+                        cursor->position.load(std::memory_order_acquire));
+  }
+  return position;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+bool Channel<T, Capacity>::wait_message(std::size_t position,
+                                        Deadline deadline, Error &error) {
+  auto has_message = [&] {
+    return this->tail.load(std::memory_order_acquire) > position;
+  };
+  for (;;) {
+    if (this->closed.load(std::memory_order_acquire)) {
+      error = Error::closed;
+      return false;
+    }
+    if (has_message()) {
+      return true;
+    }
+    if (deadline != no_deadline &&
+        std::chrono::steady_clock::now() >= deadline) {
+      error = Error::timeout;
+      return false;
+    }
+    std::unique_lock lock(this->mutex);
+    this->subscribers_waiting.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence in `wake_subscribers`.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    detail::wait_until(this->not_empty, lock, deadline, [&] {
+      return has_message() || this->closed.load(std::memory_order_acquire);
+    });
+    this->subscribers_waiting.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+template <typename Visitor>
+  requires std::invocable<Visitor &, const T &>
+std::expected<std::invoke_result_t<Visitor &, const T &>, Error>
+Channel<T, Capacity>::receive(Cursor &cursor, Deadline deadline,
+                              Visitor &&visit) {
+  using Result = std::invoke_result_t<Visitor &, const T &>;
+  const std::size_t position = cursor.position.load(std::memory_order_relaxed);
+  Error error{};
+  if (!this->wait_message(position, deadline, error)) {
+    return std::unexpected(error);
+  }
+  // The slot is not reused until the cursor moves past it.
+  auto advance = [&] {
+    cursor.position.store(position + 1, std::memory_order_release);
+    this->wake_senders();
+  };
+  if constexpr (std::is_void_v<Result>) {
+    std::invoke(visit, std::as_const(*this->slot(position)));
+    advance();
+    return {};
+  } else {
+    Result result = std::invoke(visit, std::as_const(*this->slot(position)));
+    advance();
+    return result;
+  }
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+std::expected<std::size_t, Error>
+Channel<T, Capacity>::receive_many(Cursor &cursor, std::span<T> out,
+                                   std::size_t min, std::size_t max)
+  requires std::copyable<T>
+{
+  max = std::min(max, out.size());
+  min = std::min(min, max);
+  const std::size_t position = cursor.position.load(std::memory_order_relaxed);
+  Error error{};
+  if (min != 0 && !this->wait_message(position + min - 1, no_deadline, error)) {
+    // Closed: the messages received so far are dropped, like on the other
+    // channels.
+    return std::unexpected(error);
+  }
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  const std::size_t available =
+      this->tail.load(std::memory_order_acquire) - position;
+  const std::size_t count = std::min(available, max);
+  if (count == 0) {
+    return max == 0 ? std::expected<std::size_t, Error>(0)
+                    : std::unexpected(Error::would_block);
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = *this->slot(position + i);
+  }
+  cursor.position.store(position + count, std::memory_order_release);
+  this->wake_senders();
+  return count;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+std::unique_ptr<Cursor> Channel<T, Capacity>::subscribe() {
+  auto cursor = std::make_unique<Cursor>();
+  std::lock_guard lock(this->mutex);
+  // A gate computed by a sender before this cursor existed is at most the
+  // head, so no slot read from here can be reused without looking at it.
+  cursor->position.store(this->tail.load(std::memory_order_acquire),
+                         std::memory_order_relaxed);
+  this->cursors.push_back(cursor.get());
+  return cursor;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+void Channel<T, Capacity>::unsubscribe(Cursor &cursor) {
+  std::lock_guard lock(this->mutex);
+  std::erase(this->cursors, &cursor);
+  // The slowest subscriber may be gone.
+  this->not_full.notify_all();
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+void Channel<T, Capacity>::close() {
+  this->closed.store(true, std::memory_order_release);
+  std::lock_guard lock(this->mutex);
+  this->not_full.notify_all();
+  this->not_empty.notify_all();
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+void Channel<T, Capacity>::wake_subscribers() {
+  // Pairs with the fence taken by a subscriber before it parks.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->subscribers_waiting.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  std::lock_guard lock(this->mutex);
+  this->not_empty.notify_all();
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0 && Capacity != dynamic_capacity)
+void Channel<T, Capacity>::wake_senders() {
+  // Pairs with the fence taken by a sender before it parks.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->senders_waiting.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  std::lock_guard lock(this->mutex);
+  this->not_full.notify_all();
+}
+
+template <typename T, std::size_t Capacity> class Subscriber;
+
+/**
+ *  @brief Sending handle of a broadcast channel. Every message sent reaches
+ *  every subscriber. Copies share the channel, so there may be several
+ *  senders.
+ * */
+template <typename T, std::size_t Capacity> class Sender {
+public:
+  using value_type = T;
+  using core_type = Channel<T, Capacity>;
+
+  explicit Sender(std::shared_ptr<core_type> core) : core_(std::move(core)) {}
+
+  /**
+   *  @brief Sends an object to every subscriber. This method blocks the
+   * thread while the slowest subscriber is `Capacity` messages behind.
+   *  @returns `void` if the operation was successful. An `Error` if the
+   * operation failed.
+   * */
+  std::expected<void, Error> send(T &&value) {
+    return core_->send(no_deadline, std::move(value));
+  }
+  std::expected<void, Error> send(const T &value) {
+    return core_->send(no_deadline, value);
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  std::expected<void, Error> emplace_send(Args &&...args) {
+    return core_->send(no_deadline, std::forward<Args>(args)...);
+  }
+
+  /**
+   *  @brief Sends an object to every subscriber without blocking the thread.
+   *  @returns `Error::would_block` if the slowest subscriber is `Capacity`
+   * messages behind.
+   * */
+  std::expected<void, Error> try_send(T &&value) {
+    return core_->try_send(std::move(value));
+  }
+  std::expected<void, Error> try_send(const T &value) {
+    return core_->try_send(value);
+  }
+
+  template <typename Rep, typename Period>
+  std::expected<void, Error>
+  send_for(T value, const std::chrono::duration<Rep, Period> &timeout) {
+    return core_->send(detail::deadline_after(timeout), std::move(value));
+  }
+  template <typename Clock, typename Duration>
+  std::expected<void, Error>
+  send_until(T value,
+             const std::chrono::time_point<Clock, Duration> &deadline) {
+    return core_->send(detail::to_deadline(deadline), std::move(value));
+  }
+
+  /**
+   *  @returns A new subscriber, that receives the messages sent from now on.
+   * */
+  Subscriber<T, Capacity> subscribe() const {
+    return Subscriber<T, Capacity>(core_);
+  }
+  std::size_t subscribers() const { return core_->subscribers(); }
+
+  void close() { core_->close(); }
+  bool is_closed() const { return core_->is_closed(); }
+  static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+  std::shared_ptr<core_type> core_;
+};
+
+/**
+ *  @brief Receiving handle of a broadcast channel, with its own cursor: it
+ *  receives every message sent after it subscribed, no matter what the other
+ *  subscribers do. It can be moved but not copied; `subscribe` makes another
+ *  subscriber. Destroying it unsubscribes, so senders no longer wait for it.
+ *
+ *  `receive` copies the message out of the ring, while `receive_with` reads
+ *  it in place. Like `ReceiverChannel`, it is an input range. A subscriber
+ *  must be used by one thread at a time.
+ * */
+template <typename T, std::size_t Capacity> class Subscriber {
+public:
+  using value_type = T;
+  using core_type = Channel<T, Capacity>;
+
+  explicit Subscriber(std::shared_ptr<core_type> core)
+      : core_(std::move(core)), cursor_(core_->subscribe()) {}
+  Subscriber(Subscriber &&) = default;
+  Subscriber &operator=(Subscriber &&other) {
+    if (this == &other) {
+      return *this;
+    }
+    this->unsubscribe();
+    this->core_ = std::move(other.core_);
+    this->cursor_ = std::move(other.cursor_);
+    this->buffer_ = std::move(other.buffer_);
+    return *this;
+  }
+  ~Subscriber() { this->unsubscribe(); }
+
+  /**
+   *  @brief Receives a copy of the next message. This method blocks the
+   * thread until there is one.
+   *  @returns The message, or an `Error` if the operation failed.
+   * */
+  std::expected<T, Error> receive()
+    requires std::copy_constructible<T>
+  {
+    return this->buffer_.take_or([&] {
+      return core_->receive(*cursor_, no_deadline,
+                            [](const T &value) { return T(value); });
+    });
+  }
+
+  /**
+   *  @brief Receives a copy of the next message, if there is one already.
+   * */
+  std::expected<T, Error> try_receive()
+    requires std::copy_constructible<T>
+  {
+    if (this->buffer_.empty() && !this->is_closed() && this->size() == 0) {
+      return std::unexpected(Error::would_block);
+    }
+    return this->receive();
+  }
+
+  template <typename Rep, typename Period>
+  std::expected<T, Error>
+  receive_for(const std::chrono::duration<Rep, Period> &timeout)
+    requires std::copy_constructible<T>
+  {
+    return this->buffer_.take_or([&] {
+      return core_->receive(*cursor_, detail::deadline_after(timeout),
+                            [](const T &value) { return T(value); });
+    });
+  }
+
+  /**
+   *  @brief Waits for the next message and calls `visit` with a const
+   * reference to it, in the ring, so it is never copied. The other
+   * subscribers may read it at the same time.
+   *  @returns What `visit` returned, or an `Error` if the operation failed.
+   * */
+  template <typename Visitor>
+    requires std::invocable<Visitor &, const T &>
+  auto receive_with(Visitor &&visit)
+      -> std::expected<std::invoke_result_t<Visitor &, const T &>, Error> {
+    using Result = std::invoke_result_t<Visitor &, const T &>;
+    if (!this->buffer_.empty()) {
+      if constexpr (std::is_void_v<Result>) {
+        visit(std::as_const(this->buffer_.front()));
+        this->buffer_.pop_front();
+        return {};
+      } else {
+        auto result = visit(std::as_const(this->buffer_.front()));
+        this->buffer_.pop_front();
+        return result;
+      }
+    }
+    return core_->receive(*cursor_, no_deadline,
+                          std::forward<Visitor>(visit));
+  }
+
+  /**
+   *  @brief Copies the next messages into `out`: at least `min`, waiting for
+   * them, and then the ones already sent, up to `max`.
+   * */
+  std::expected<std::size_t, Error>
+  receive_many(std::span<T> out, std::size_t min = 1,
+               std::size_t max = std::numeric_limits<std::size_t>::max())
+    requires std::copyable<T>
+  {
+    if (this->buffer_.empty()) {
+      return core_->receive_many(*cursor_, out, min, max);
+    }
+    return this->buffer_.receive_many(*this, out, min, max);
+  }
+
+  /**
+   *  @returns A new subscriber, that receives the messages sent from now on.
+   * */
+  Subscriber subscribe() const { return Subscriber(core_); }
+
+  /**
+   *  @returns The number of messages sent that this subscriber did not
+   *  receive yet.
+   * */
+  std::size_t size() const { return core_->pending(*cursor_); }
+  static constexpr std::size_t capacity() { return Capacity; }
+  bool is_closed() const { return core_->is_closed(); }
+
+  ReceiveIterator<T, Subscriber> begin() {
+    return ReceiveIterator<T, Subscriber>(this, &this->buffer_);
+  }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+
+private:
+  void unsubscribe() {
+    if (this->cursor_) {
+      core_->unsubscribe(*this->cursor_);
+      this->cursor_.reset();
+    }
+  }
+
+  std::shared_ptr<core_type> core_;
+  std::unique_ptr<Cursor> cursor_;
+  // Messages taken by range loops, and not reached yet.
+  detail::ReceiveBuffer<T> buffer_;
+};
+
+} // namespace chx::broadcast
+
+// `size()` counts the messages pending now, not the ones a loop will receive.
+template <typename T, std::size_t Capacity>
+inline constexpr bool
+    std::ranges::disable_sized_range<chx::broadcast::Subscriber<T, Capacity>> =
+        true;
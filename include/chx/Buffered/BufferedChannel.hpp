@@ -2,16 +2,59 @@
 
 #include "chx/Buffered/circular_queue.hpp"
 #include "chx/channelCore.hpp"
-#include <condition_variable>
+#include "chx/wait_node.hpp"
+#include "chx/wait_strategy.hpp"
+#include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <utility>
 
 namespace chx::buffered {
 
-template <typename T, std::size_t Capacity>
-class Channel : public chx::ChannelCore<T> {
+/**
+ *  @brief Buffered channel protected by a mutex. `Wait` chooses how blocked
+ *  threads wait (see `chx::wait`).
+ *
+ *  Suspended coroutines wait in FIFO queues of their own. Every time objects
+ *  (or free slots) become available, the first queued coroutines are served
+ *  under the same lock and woken one by one.
+ * */
+template <typename T, std::size_t Capacity, typename Wait = wait::Blocking>
+class Channel final : public chx::ChannelCore<T> {
 public:
-  Channel() : chx::ChannelCore<T>(), closed(false) {}
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  Channel()
+    requires(Capacity != dynamic_capacity)
+      : chx::ChannelCore<T>(), closed(false) {}
+  /**
+   *  @brief Builds a channel whose waiter list is allocated from `alloc` (see
+   *  `CreateChannel`).
+   * */
+  Channel(std::allocator_arg_t, const allocator_type &alloc)
+    requires(Capacity != dynamic_capacity)
+      : chx::ChannelCore<T>(alloc.resource()), closed(false) {}
+
+  /**
+   *  @brief Builds a channel whose capacity is chosen at run time. Large
+   *  buffers are mapped lazily: their memory is only committed as the channel
+   *  fills up.
+   * */
+  explicit Channel(std::size_t capacity,
+                   PageBacking pages = PageBacking::standard)
+    requires(Capacity == dynamic_capacity)
+      : chx::ChannelCore<T>(), queue(capacity, pages), closed(false) {}
+
+  /**
+   *  @brief Builds a channel whose capacity is chosen at run time, and whose
+   *  buffer and waiter list are allocated from `alloc` (see `CreateChannel`).
+   *  The buffer is not mapped lazily then, whatever its size.
+   * */
+  Channel(std::allocator_arg_t, const allocator_type &alloc,
+          std::size_t capacity, PageBacking pages = PageBacking::standard)
+    requires(Capacity == dynamic_capacity)
+      : chx::ChannelCore<T>(alloc.resource()),
+        queue(capacity, pages, alloc.resource()), closed(false) {}
   ~Channel() = default;
 
   std::expected<void, Error> send(const T &value) override;
@@ -22,119 +65,614 @@ public:
   std::expected<T, Error> receive() override;
   std::expected<T, Error> try_receive() override;
 
+  std::expected<void, Error> send_until(T &&value,
+                                        Deadline deadline) override;
+  std::expected<void, Error> send_until(const T &value,
+                                        Deadline deadline) override;
+  std::expected<T, Error> receive_until(Deadline deadline) override;
+
+  /**
+   *  @brief Sends an object constructed from `args` directly in its slot of
+   *  the buffer. This method blocks the thread until there is room for it.
+   * */
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  std::expected<void, Error> emplace_send(Args &&...args) {
+    return this->send_(no_deadline, std::forward<Args>(args)...);
+  }
+
+  /**
+   *  @brief Builds an object from `args` directly in the next free slot of
+   *  the buffer, without sending it yet: `commit_claim` sends it, and
+   *  `cancel_claim` destroys it. This lets large objects be filled in place
+   *  (see `SendSlot`). Only one slot is claimed at a time, so the other
+   *  senders wait until it is committed or cancelled.
+   *  @returns The object, or an `Error` if the operation failed.
+   * */
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  std::expected<T *, Error> claim(Deadline deadline, Args &&...args) {
+    return this->claim_(true, deadline, std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  std::expected<T *, Error> try_claim(Args &&...args) {
+    return this->claim_(false, no_deadline, std::forward<Args>(args)...);
+  }
+  std::expected<void, Error> commit_claim();
+  void cancel_claim();
+
+  /**
+   *  @brief Gives access to the object at the front of the buffer, in place,
+   *  without receiving it yet: `release_acquired` drops it (see
+   *  `ReceiveView`). Only one object is acquired at a time, so the other
+   *  receivers wait until it is released.
+   *  @returns The object, or an `Error` if the operation failed.
+   * */
+  std::expected<T *, Error> acquire(Deadline deadline) {
+    return this->acquire_(true, deadline);
+  }
+  std::expected<T *, Error> try_acquire() {
+    return this->acquire_(false, no_deadline);
+  }
+  void release_acquired();
+
+  std::expected<std::size_t, Error> send_many(std::span<T> values) override;
+  std::expected<std::size_t, Error>
+  try_send_many(std::span<T> values) override;
+  std::expected<std::size_t, Error>
+  receive_many(std::span<T> out, std::size_t min, std::size_t max) override;
+  std::expected<std::size_t, Error>
+  try_receive_many(std::span<T> out) override;
+
+  detail::AsyncStart start_async_send(detail::WaitNode<T> &node) override;
+  detail::AsyncStart start_async_receive(detail::WaitNode<T> &node) override;
+  void cancel_async(detail::Side side, detail::WaitNode<T> &node) override;
+
   virtual void close() override;
   virtual bool is_closed() const override;
 
-  Channel<T, Capacity> &operator=(const Channel<T, Capacity> &ch) = delete;
+  std::size_t size() const override { return this->queue.size(); }
+  std::size_t capacity() const override { return this->queue.max_size(); }
+
+  Channel &operator=(const Channel &ch) = delete;
+
+protected:
+  void disconnect_senders() override;
 
 private:
-  template <typename U>
-    requires std::constructible_from<T, U &&>
-  std::expected<void, Error> send_(U &&value);
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  std::expected<void, Error> send_(Deadline deadline, Args &&...args);
 
   template <typename U>
     requires std::constructible_from<T, U &&>
   std::expected<void, Error> try_send_(U &&value);
 
+  std::expected<T, Error> receive_(Deadline deadline);
+
+  template <typename... Args>
+  std::expected<T *, Error> claim_(bool blocking, Deadline deadline,
+                                   Args &&...args);
+  std::expected<T *, Error> acquire_(bool blocking, Deadline deadline);
+
+  /**
+   *  @returns True if a sender may push now: there is room, and no slot is
+   *  claimed.
+   * */
+  bool can_send() const { return !this->queue.is_full() && !this->claimed; }
+
+  /**
+   *  @returns True if a receiver may pop now: there is an object, and the
+   *  front one is not acquired.
+   * */
+  bool can_receive() const {
+    return !this->queue.is_empty() && !this->acquired;
+  }
+
+  /**
+   *  @returns True if receivers get `Error::closed`: the channel was closed,
+   *  or its last sender was dropped and everything it sent was received.
+   * */
+  bool receive_closed() const {
+    return this->closed || (this->queue.is_empty() && !this->claimed &&
+                            this->senders_gone());
+  }
+
+  /**
+   *  @brief Wakes every receiver if the channel has just been drained after
+   *  its last sender was dropped. Must be called with the mutex held.
+   * */
+  void wake_if_drained();
+
+  /**
+   *  @brief Waits on `cv` until `ready` holds or `deadline` expires, and
+   *  returns the last value of `ready`. The time spent blocked is recorded as
+   *  `side`.
+   * */
+  template <typename Predicate>
+  bool wait(std::unique_lock<std::mutex> &lock, typename Wait::Condition &cv,
+            detail::Side side, Deadline deadline, Predicate ready);
+
+  /**
+   *  @brief Wakes the threads waiting on `cv`, and the registered waiters,
+   *  after `count` elements (or free slots) were made available, and serves
+   *  the queued coroutines. Must be called with the mutex held.
+   * */
+  void notify(typename Wait::Condition &cv, std::size_t count,
+              WaitEvent event);
+
+  /**
+   *  @brief Completes the queued coroutines that can go on now: receivers
+   *  take the front objects, and senders push theirs into the free slots.
+   *  Must be called with the mutex held.
+   * */
+  void serve_async();
+
   mutable std::mutex mutex;
-  std::condition_variable not_empty;
-  std::condition_variable not_full;
+  typename Wait::Condition not_empty;
+  typename Wait::Condition not_full;
   CircularQueue<T, Capacity> queue;
   bool closed = false;
+  bool claimed = false;
+  bool acquired = false;
+  // Coroutines waiting for a free slot (with the value to send), or for an
+  // object.
+  detail::NodeQueue<T> async_senders;
+  detail::NodeQueue<T> async_receivers;
 };
 
-template <typename T, std::size_t Capacity> void Channel<T, Capacity>::close() {
+template <typename T, std::size_t Capacity, typename Wait>
+void Channel<T, Capacity, Wait>::close() {
   std::lock_guard lock(this->mutex);
   this->closed = true;
+  this->metrics_.closed();
   this->not_empty.notify_all();
   this->not_full.notify_all();
+  this->async_senders.complete_all(detail::NodeState::closed);
+  this->async_receivers.complete_all(detail::NodeState::closed);
+  this->notify_waiters(WaitEvent::closed);
   return;
 }
 
-template <typename T, std::size_t Capacity>
-bool Channel<T, Capacity>::is_closed() const {
+template <typename T, std::size_t Capacity, typename Wait>
+void Channel<T, Capacity, Wait>::disconnect_senders() {
+  std::lock_guard lock(this->mutex);
+  // The receivers take what is left, and then find the channel closed.
+  this->not_empty.notify_all();
+  this->serve_async();
+  this->notify_waiters(WaitEvent::closed);
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+void Channel<T, Capacity, Wait>::wake_if_drained() {
+  if (!this->closed && this->receive_closed()) {
+    this->not_empty.notify_all();
+    this->async_receivers.complete_all(detail::NodeState::closed);
+    this->notify_waiters(WaitEvent::closed);
+  }
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+bool Channel<T, Capacity, Wait>::is_closed() const {
   std::lock_guard lock(this->mutex);
-  return this->closed == true;
+  return this->receive_closed();
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<void, Error> Channel<T, Capacity, Wait>::send(const T &value) {
+  return this->send_(no_deadline, value);
 }
 
-template <typename T, std::size_t Capacity>
-std::expected<void, Error> Channel<T, Capacity>::send(const T &value) {
-  return this->send_(value);
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<void, Error> Channel<T, Capacity, Wait>::send(T &&value) {
+  return this->send_(no_deadline, std::move(value));
 }
 
-template <typename T, std::size_t Capacity>
-std::expected<void, Error> Channel<T, Capacity>::send(T &&value) {
-  return this->send_(std::move(value));
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<void, Error>
+Channel<T, Capacity, Wait>::send_until(const T &value, Deadline deadline) {
+  return this->send_(deadline, value);
 }
 
-template <typename T, std::size_t Capacity>
-std::expected<void, Error> Channel<T, Capacity>::try_send(const T &value) {
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<void, Error>
+Channel<T, Capacity, Wait>::send_until(T &&value, Deadline deadline) {
+  return this->send_(deadline, std::move(value));
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<void, Error>
+Channel<T, Capacity, Wait>::try_send(const T &value) {
   return this->try_send_(value);
 }
 
-template <typename T, std::size_t Capacity>
-std::expected<void, Error> Channel<T, Capacity>::try_send(T &&value) {
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<void, Error> Channel<T, Capacity, Wait>::try_send(T &&value) {
   return this->try_send_(std::move(value));
 }
 
-template <typename T, std::size_t Capacity>
-template <typename U>
-  requires std::constructible_from<T, U &&>
-std::expected<void, Error> Channel<T, Capacity>::send_(U &&value) {
+template <typename T, std::size_t Capacity, typename Wait>
+template <typename... Args>
+  requires std::constructible_from<T, Args &&...>
+std::expected<void, Error>
+Channel<T, Capacity, Wait>::send_(Deadline deadline, Args &&...args) {
   std::unique_lock lock(this->mutex);
-  this->not_full.wait(lock,
-                      [&] { return !this->queue.is_full() || this->closed; });
+  if (!this->wait(lock, this->not_full, detail::Side::send, deadline, [&] {
+        return this->can_send() || this->closed;
+      })) {
+    return std::unexpected(Error::timeout);
+  }
   if (this->closed) {
-    return std::unexpected("channel closed");
+    return std::unexpected(Error::closed);
   }
-  this->queue.push(std::forward<U>(value));
-  this->not_empty.notify_one();
+  this->queue.emplace(std::forward<Args>(args)...);
+  this->record_sent(1);
+  this->notify(this->not_empty, 1, WaitEvent::readable);
   return {};
 }
 
-template <typename T, std::size_t Capacity>
+template <typename T, std::size_t Capacity, typename Wait>
 template <typename U>
   requires std::constructible_from<T, U &&>
-std::expected<void, Error> Channel<T, Capacity>::try_send_(U &&value) {
+std::expected<void, Error> Channel<T, Capacity, Wait>::try_send_(U &&value) {
   std::unique_lock lock(this->mutex);
   if (this->closed) {
-    return std::unexpected("channel closed");
+    return std::unexpected(Error::closed);
   }
-  if (this->queue.is_full()) {
-    return std::unexpected("cannot send inmediatly since the buffer is full");
+  if (!this->can_send()) {
+    this->metrics_.try_failed(detail::Side::send);
+    return std::unexpected(Error::would_block);
   }
   this->queue.push(std::forward<U>(value));
-  this->not_empty.notify_one();
+  this->record_sent(1);
+  this->notify(this->not_empty, 1, WaitEvent::readable);
   return {};
 }
 
-template <typename T, std::size_t Capacity>
-std::expected<T, Error> Channel<T, Capacity>::receive() {
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<T, Error> Channel<T, Capacity, Wait>::receive() {
+  return this->receive_(no_deadline);
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<T, Error>
+Channel<T, Capacity, Wait>::receive_until(Deadline deadline) {
+  return this->receive_(deadline);
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<T, Error>
+Channel<T, Capacity, Wait>::receive_(Deadline deadline) {
   std::unique_lock lock(this->mutex);
-  this->not_empty.wait(lock,
-                       [&] { return !this->queue.is_empty() || this->closed; });
-  if (this->closed) {
-    return std::unexpected("channel closed");
+  if (!this->wait(lock, this->not_empty, detail::Side::receive, deadline, [&] {
+        return this->can_receive() || this->receive_closed();
+      })) {
+    return std::unexpected(Error::timeout);
+  }
+  if (this->receive_closed()) {
+    return std::unexpected(Error::closed);
   }
   auto value = std::move(*this->queue.front());
   this->queue.pop();
-  this->not_full.notify_one();
+  this->metrics_.received(1);
+  this->notify(this->not_full, 1, WaitEvent::writable);
   return value;
 }
 
-template <typename T, std::size_t Capacity>
-std::expected<T, Error> Channel<T, Capacity>::try_receive() {
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<T, Error> Channel<T, Capacity, Wait>::try_receive() {
   std::unique_lock lock(this->mutex);
-  if (this->closed) {
-    return std::unexpected("channel closed");
+  if (this->receive_closed()) {
+    return std::unexpected(Error::closed);
   }
-  if (this->queue.is_empty()) {
-    return std::unexpected(
-        "cannot receive inmediatly since the buffer is empty");
+  if (!this->can_receive()) {
+    this->metrics_.try_failed(detail::Side::receive);
+    return std::unexpected(Error::would_block);
   }
   auto value = std::move(*this->queue.front());
   this->queue.pop();
-  this->not_empty.notify_one();
+  this->metrics_.received(1);
+  this->notify(this->not_full, 1, WaitEvent::writable);
+  return value;
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+template <typename... Args>
+std::expected<T *, Error>
+Channel<T, Capacity, Wait>::claim_(bool blocking, Deadline deadline,
+                                   Args &&...args) {
+  std::unique_lock lock(this->mutex);
+  if (blocking) {
+    if (!this->wait(lock, this->not_full, detail::Side::send, deadline,
+                    [&] { return this->can_send() || this->closed; })) {
+      return std::unexpected(Error::timeout);
+    }
+  }
+  if (this->closed) {
+    return std::unexpected(Error::closed);
+  }
+  if (!this->can_send()) {
+    this->metrics_.try_failed(detail::Side::send);
+    return std::unexpected(Error::would_block);
+  }
+  T *value = this->queue.reserve_back(std::forward<Args>(args)...);
+  this->claimed = true;
   return value;
 }
+
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<void, Error> Channel<T, Capacity, Wait>::commit_claim() {
+  std::unique_lock lock(this->mutex);
+  this->claimed = false;
+  // The senders that waited for the claim may go on, if there is room.
+  this->not_full.notify_all();
+  if (this->closed) {
+    this->queue.cancel_back();
+    return std::unexpected(Error::closed);
+  }
+  this->queue.commit_back();
+  this->record_sent(1);
+  // Without senders, the receivers waiting for the claim must all wake up:
+  // one takes the object, and the others find the channel drained.
+  this->notify(this->not_empty, this->senders_gone() ? 2 : 1,
+               WaitEvent::readable);
+  if (!this->queue.is_full()) {
+    this->notify_waiters(WaitEvent::writable);
+  }
+  return {};
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+void Channel<T, Capacity, Wait>::cancel_claim() {
+  std::unique_lock lock(this->mutex);
+  this->queue.cancel_back();
+  this->claimed = false;
+  this->notify(this->not_full, this->queue.max_size(), WaitEvent::writable);
+  this->wake_if_drained();
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<T *, Error>
+Channel<T, Capacity, Wait>::acquire_(bool blocking, Deadline deadline) {
+  std::unique_lock lock(this->mutex);
+  if (blocking) {
+    if (!this->wait(lock, this->not_empty, detail::Side::receive, deadline,
+                    [&] {
+                      return this->can_receive() || this->receive_closed();
+                    })) {
+      return std::unexpected(Error::timeout);
+    }
+  }
+  if (this->receive_closed()) {
+    return std::unexpected(Error::closed);
+  }
+  if (!this->can_receive()) {
+    this->metrics_.try_failed(detail::Side::receive);
+    return std::unexpected(Error::would_block);
+  }
+  this->acquired = true;
+  return this->queue.front();
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+void Channel<T, Capacity, Wait>::release_acquired() {
+  std::unique_lock lock(this->mutex);
+  this->queue.pop();
+  this->acquired = false;
+  this->metrics_.received(1);
+  this->notify(this->not_full, 1, WaitEvent::writable);
+  // The receivers that waited for the object may go on, if there are more.
+  if (!this->queue.is_empty()) {
+    this->notify(this->not_empty, this->queue.size() + 1,
+                 WaitEvent::readable);
+  }
+  this->wake_if_drained();
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+template <typename Predicate>
+bool Channel<T, Capacity, Wait>::wait(std::unique_lock<std::mutex> &lock,
+                                      typename Wait::Condition &cv,
+                                      detail::Side side, Deadline deadline,
+                                      Predicate ready) {
+  if (ready()) {
+    return true;
+  }
+  [[maybe_unused]] auto blocked = this->metrics_.block(side);
+  return cv.wait_until(lock, deadline, ready);
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+void Channel<T, Capacity, Wait>::notify(typename Wait::Condition &cv,
+                                        std::size_t count, WaitEvent event) {
+  if (count == 0) {
+    return;
+  }
+  if (count == 1) {
+    cv.notify_one();
+  } else {
+    cv.notify_all();
+  }
+  this->notify_waiters(event);
+  this->serve_async();
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+void Channel<T, Capacity, Wait>::serve_async() {
+  std::size_t received = 0;
+  std::size_t sent = 0;
+  for (;;) {
+    if (!this->async_receivers.empty() && this->can_receive()) {
+      detail::WaitNode<T> *node = this->async_receivers.pop_front();
+      node->value.emplace(std::move(*this->queue.front()));
+      this->queue.pop();
+      this->metrics_.received(1);
+      node->state = detail::NodeState::done;
+      node->wake();
+      received++;
+    } else if (!this->async_senders.empty() && this->can_send()) {
+      detail::WaitNode<T> *node = this->async_senders.pop_front();
+      this->queue.push(std::move(*node->value));
+      this->record_sent(1);
+      node->state = detail::NodeState::done;
+      node->wake();
+      sent++;
+    } else {
+      break;
+    }
+  }
+  // Not through `notify`, which would serve the coroutines again.
+  if (received != 0) {
+    received == 1 ? this->not_full.notify_one() : this->not_full.notify_all();
+    this->notify_waiters(WaitEvent::writable);
+  }
+  if (sent != 0) {
+    sent == 1 ? this->not_empty.notify_one() : this->not_empty.notify_all();
+    this->notify_waiters(WaitEvent::readable);
+  }
+  if (!this->async_receivers.empty() && this->receive_closed()) {
+    this->async_receivers.complete_all(detail::NodeState::closed);
+  }
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+detail::AsyncStart
+Channel<T, Capacity, Wait>::start_async_send(detail::WaitNode<T> &node) {
+  std::unique_lock lock(this->mutex);
+  if (this->closed) {
+    node.state = detail::NodeState::closed;
+    return detail::AsyncStart::done;
+  }
+  // Queued senders only wait while there is no room, so this keeps FIFO.
+  if (!this->can_send()) {
+    this->async_senders.push_back(&node);
+    return detail::AsyncStart::queued;
+  }
+  this->queue.push(std::move(*node.value));
+  this->record_sent(1);
+  node.state = detail::NodeState::done;
+  this->notify(this->not_empty, 1, WaitEvent::readable);
+  return detail::AsyncStart::done;
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+detail::AsyncStart
+Channel<T, Capacity, Wait>::start_async_receive(detail::WaitNode<T> &node) {
+  std::unique_lock lock(this->mutex);
+  if (this->receive_closed()) {
+    node.state = detail::NodeState::closed;
+    return detail::AsyncStart::done;
+  }
+  if (!this->can_receive()) {
+    this->async_receivers.push_back(&node);
+    return detail::AsyncStart::queued;
+  }
+  node.value.emplace(std::move(*this->queue.front()));
+  this->queue.pop();
+  this->metrics_.received(1);
+  node.state = detail::NodeState::done;
+  this->notify(this->not_full, 1, WaitEvent::writable);
+  return detail::AsyncStart::done;
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+void Channel<T, Capacity, Wait>::cancel_async(detail::Side side,
+                                              detail::WaitNode<T> &node) {
+  std::unique_lock lock(this->mutex);
+  if (node.state == detail::NodeState::waiting) {
+    (side == detail::Side::send ? this->async_senders : this->async_receivers)
+        .remove(&node);
+  }
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<std::size_t, Error>
+Channel<T, Capacity, Wait>::send_many(std::span<T> values) {
+  std::unique_lock lock(this->mutex);
+  std::size_t sent = 0;
+  while (sent < values.size()) {
+    this->wait(lock, this->not_full, detail::Side::send, no_deadline, [&] {
+      return this->can_send() || this->closed;
+    });
+    if (this->closed) {
+      break;
+    }
+    const std::size_t pushed = this->queue.push_many(values.subspan(sent));
+    sent += pushed;
+    this->record_sent(pushed);
+    this->notify(this->not_empty, pushed, WaitEvent::readable);
+  }
+  if (sent == 0 && this->closed) {
+    return std::unexpected(Error::closed);
+  }
+  return sent;
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<std::size_t, Error>
+Channel<T, Capacity, Wait>::try_send_many(std::span<T> values) {
+  std::unique_lock lock(this->mutex);
+  if (this->closed) {
+    return std::unexpected(Error::closed);
+  }
+  const std::size_t sent =
+      this->claimed ? 0 : this->queue.push_many(values);
+  if (sent == 0 && !values.empty()) {
+    this->metrics_.try_failed(detail::Side::send);
+    return std::unexpected(Error::would_block);
+  }
+  this->record_sent(sent);
+  this->notify(this->not_empty, sent, WaitEvent::readable);
+  return sent;
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<std::size_t, Error>
+Channel<T, Capacity, Wait>::receive_many(std::span<T> out, std::size_t min,
+                                         std::size_t max) {
+  max = std::min(max, out.size());
+  min = std::min(min, max);
+  std::unique_lock lock(this->mutex);
+  std::size_t received = 0;
+  while (received < max) {
+    if (received < min) {
+      this->wait(lock, this->not_empty, detail::Side::receive, no_deadline,
+                 [&] { return this->can_receive() || this->receive_closed(); });
+    }
+    if (this->receive_closed() || this->acquired) {
+      break;
+    }
+    const std::size_t popped =
+        this->queue.pop_many(out.subspan(received, max - received));
+    received += popped;
+    this->metrics_.received(popped);
+    this->notify(this->not_full, popped, WaitEvent::writable);
+    if (received >= min) {
+      break;
+    }
+  }
+  if (received == 0 && max != 0) {
+    return std::unexpected(this->receive_closed() ? Error::closed
+                                                  : Error::would_block);
+  }
+  return received;
+}
+
+template <typename T, std::size_t Capacity, typename Wait>
+std::expected<std::size_t, Error>
+Channel<T, Capacity, Wait>::try_receive_many(std::span<T> out) {
+  std::unique_lock lock(this->mutex);
+  if (this->receive_closed()) {
+    return std::unexpected(Error::closed);
+  }
+  const std::size_t received = this->acquired ? 0 : this->queue.pop_many(out);
+  if (received == 0 && !out.empty()) {
+    this->metrics_.try_failed(detail::Side::receive);
+    return std::unexpected(Error::would_block);
+  }
+  this->metrics_.received(received);
+  this->notify(this->not_full, received, WaitEvent::writable);
+  return received;
+}
 } // namespace chx::buffered
@@ -1,13 +1,112 @@
 #pragma once
 
-#include <array>
+#include "chx/Buffered/ring_memory.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace chx {
+
+/**
+ *  @brief `Capacity` of the buffered channels (and queues) whose capacity is
+ *  chosen at construction time.
+ * */
+inline constexpr std::size_t dynamic_capacity =
+    std::numeric_limits<std::size_t>::max();
+
+} // namespace chx
 
 namespace chx::buffered {
+
+/**
+ *  @brief Uninitialized ring of `Capacity` elements stored inline.
+ * */
+template <typename T, std::size_t Capacity> class InlineRing {
+public:
+  InlineRing() = default;
+
+  T *data() { return reinterpret_cast<T *>(this->storage_); }
+  static constexpr std::size_t capacity() { return Capacity; }
+  static constexpr bool is_mapped() { return false; }
+
+private:
+  alignas(T) std::byte storage_[sizeof(T) * Capacity];
+};
+
+/**
+ *  @brief Uninitialized ring whose capacity is chosen at construction time.
+ * */
+template <typename T> class DynamicRing {
+public:
+  /**
+   *  @throws std::length_error if `capacity` elements do not fit in the
+   *  address space.
+   * */
+  DynamicRing(std::size_t capacity, PageBacking pages,
+              std::pmr::memory_resource *resource)
+      : capacity_(std::max<std::size_t>(capacity, 1)),
+        memory_(bytes_for(this->capacity_), alignof(T), pages, resource) {}
+
+  T *data() { return static_cast<T *>(this->memory_.data()); }
+  std::size_t capacity() const { return this->capacity_; }
+  bool is_mapped() const { return this->memory_.is_mapped(); }
+
+private:
+  static std::size_t bytes_for(std::size_t capacity) {
+    // A wrapped size would map a ring smaller than the slots written to it.
+    if (capacity > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+      throw std::length_error("chx: ring capacity is too large");
+    }
+    return capacity * sizeof(T);
+  }
+
+  std::size_t capacity_;
+  RingMemory memory_;
+};
+
+/**
+ *  @brief Bounded FIFO queue over a ring of uninitialized slots. Elements are
+ *  constructed in their slot when pushed and destroyed when popped, so the
+ *  queue never builds objects it does not hold, nor keeps popped ones alive.
+ *
+ *  With `Capacity == dynamic_capacity` the capacity is chosen at construction
+ *  time, and large rings are mapped lazily (see `RingMemory`).
+ * */
 template <typename T, std::size_t Capacity>
   requires(Capacity > 0)
 class CircularQueue {
 public:
-  CircularQueue() = default;
+  CircularQueue()
+    requires(Capacity != dynamic_capacity)
+  = default;
+
+  /**
+   *  @param capacity Maximum number of elements. A capacity of 0 is rounded
+   *  up to 1.
+   *  @param pages Pages backing the ring, when it is large enough to be
+   *  mapped.
+   *  @param resource Resource the ring is allocated from, if not null (see
+   *  `RingMemory`).
+   *  @throws std::length_error if the ring would not fit in the address
+   *  space.
+   * */
+  explicit CircularQueue(std::size_t capacity,
+                         PageBacking pages = PageBacking::standard,
+                         std::pmr::memory_resource *resource = nullptr)
+    requires(Capacity == dynamic_capacity)
+      : ring_(capacity, pages, resource) {}
+
+  ~CircularQueue();
 
   CircularQueue(const CircularQueue &) = delete;
   CircularQueue(CircularQueue &&) = delete;
@@ -21,7 +120,7 @@ public:
    *  @returns True if the value was successfully inserted into the queue.
    *  False otherwise.
    * */
-  bool push(const T &value);
+  bool push(const T &value) { return this->emplace(value); }
 
   /**
    *  @brief Pushes a new element into the queue.
@@ -30,7 +129,55 @@ public:
    *  @returns True if the value was successfully inserted into the queue.
    *  False otherwise.
    * */
-  bool push(T &&value);
+  bool push(T &&value) { return this->emplace(std::move(value)); }
+
+  /**
+   *  @brief Constructs a new element in place, at the back of the queue.
+   *  @returns True if the element was constructed. False if the queue is full.
+   * */
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  bool emplace(Args &&...args);
+
+  /**
+   *  @brief Constructs an element in the slot at the back of the queue, but
+   *  does not push it yet: it is not part of the queue until `commit_back`,
+   *  or it is destroyed by `cancel_back`. With no `args`, the element is
+   *  default-initialized, so an array is not zeroed before being filled.
+   *  The queue must not be full, and nothing else may be pushed meanwhile.
+   *  @returns The element.
+   * */
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  T *reserve_back(Args &&...args);
+
+  /**
+   *  @brief Pushes the element built by `reserve_back`.
+   * */
+  void commit_back() {
+    this->tail_ = this->wrap(this->tail_ + 1);
+    this->grow(1);
+  }
+
+  /**
+   *  @brief Destroys the element built by `reserve_back`.
+   * */
+  void cancel_back() { std::destroy_at(this->slot(this->tail_)); }
+
+  /**
+   *  @brief Pushes as many elements of `values` as fit into the queue. They
+   *  are `moved` on insertion, with at most two contiguous moves (before and
+   *  after the wrap around point).
+   *  @returns The number of elements inserted (the first ones of `values`).
+   * */
+  std::size_t push_many(std::span<T> values);
+
+  /**
+   *  @brief Moves up to `out.size()` elements from the front of the queue into
+   *  `out`, with at most two contiguous moves, and deletes them from the queue.
+   *  @returns The number of elements moved into `out`.
+   * */
+  std::size_t pop_many(std::span<T> out);
 
   /**
    *  @returns A pointer to the element at the front of the queue. If the queue
@@ -47,61 +194,140 @@ public:
   /**
    *  @returns The maximun size of the queue.
    * */
-  std::size_t max_size() const { return Capacity; }
+  std::size_t max_size() const { return this->ring_.capacity(); }
 
   /**
-   *  @return The number of elements left in the queue.
+   *  @return The number of elements left in the queue. Unlike the rest of the
+   *  queue, it may be read while another thread modifies it.
    * */
-  std::size_t size() const { return this->space_used_; };
+  std::size_t size() const {
+    return this->space_used_.load(std::memory_order_relaxed);
+  };
 
   /**
    *  @return True if the queue is full. False otherwise.
    * */
-  bool is_full() const { return this->space_used_ == Capacity; }
+  bool is_full() const { return this->size() == this->max_size(); }
 
   /**
    *  @return True if the queue is empty. False otherwise.
    * */
-  bool is_empty() const { return this->space_used_ == 0; }
+  bool is_empty() const { return this->size() == 0; }
+
+  /**
+   *  @returns True if the ring is mapped, so its pages are committed lazily.
+   * */
+  bool is_mapped() const { return this->ring_.is_mapped(); }
 
 private:
-  std::array<T, Capacity> queue_;
+  /**
+   *  @returns `index` (smaller than twice the capacity) wrapped into the
+   *  ring. Power of two capacities use a mask instead of a division.
+   * */
+  std::size_t wrap(std::size_t index) const;
+
+  T *slot(std::size_t index) { return this->ring_.data() + index; }
+
+  /**
+   *  @brief Adds `delta` (modulo 2^N) to the size. Only the thread that owns
+   *  the queue writes it, so a plain load and store are enough.
+   * */
+  void grow(std::size_t delta) {
+    this->space_used_.store(this->size() + delta, std::memory_order_relaxed);
+  }
+
+  std::conditional_t<Capacity == dynamic_capacity, DynamicRing<T>,
+                     InlineRing<T, Capacity>>
+      ring_;
   std::size_t head_ = 0;
   std::size_t tail_ = 0;
-  std::size_t space_used_ = 0;
+  std::atomic<std::size_t> space_used_{0};
 };
 
 template <typename T, std::size_t Capacity>
   requires(Capacity > 0)
-bool CircularQueue<T, Capacity>::push(const T &value) {
-  if (this->is_full()) {
-    return false;
+CircularQueue<T, Capacity>::~CircularQueue() {
+  while (!this->is_empty()) {
+    this->pop();
   }
-  if (this->is_empty()) {
-    this->queue_[this->head_] = value;
-    this->tail_ = this->head_;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::size_t CircularQueue<T, Capacity>::wrap(std::size_t index) const {
+  if constexpr (Capacity != dynamic_capacity) {
+    if constexpr (std::has_single_bit(Capacity)) {
+      return index & (Capacity - 1);
+    } else {
+      return index % Capacity;
+    }
   } else {
-    this->queue_[this->tail_] = value;
+    const std::size_t capacity = this->ring_.capacity();
+    if (std::has_single_bit(capacity)) {
+      return index & (capacity - 1);
+    }
+    return index % capacity;
   }
-  this->tail_ = (this->tail_ + 1) % Capacity;
-  this->space_used_++;
-  return true;
 }
 
 template <typename T, std::size_t Capacity>
   requires(Capacity > 0)
-bool CircularQueue<T, Capacity>::push(T &&value) {
+template <typename... Args>
+  requires std::constructible_from<T, Args &&...>
+bool CircularQueue<T, Capacity>::emplace(Args &&...args) {
   if (this->is_full()) {
     return false;
   }
-  if (this->space_used_ == 0) {
-    this->queue_[this->head_] = std::move(value);
+  std::construct_at(this->slot(this->tail_), std::forward<Args>(args)...);
+  this->tail_ = this->wrap(this->tail_ + 1);
+  this->grow(1);
+  return true;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+template <typename... Args>
+  requires std::constructible_from<T, Args &&...>
+T *CircularQueue<T, Capacity>::reserve_back(Args &&...args) {
+  T *slot = this->slot(this->tail_);
+  if constexpr (sizeof...(Args) == 0) {
+    return ::new (static_cast<void *>(slot)) T;
   } else {
-    this->queue_[this->tail_] = std::move(value);
+    return std::construct_at(slot, std::forward<Args>(args)...);
   }
-  this->tail_ = (this->tail_ + 1) % Capacity;
-  this->space_used_++;
-  return true;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::size_t CircularQueue<T, Capacity>::push_many(std::span<T> values) {
+  const std::size_t count =
+      std::min(values.size(), this->max_size() - this->size());
+  const std::size_t first_part =
+      std::min(count, this->max_size() - this->tail_);
+  std::uninitialized_move_n(values.begin(), first_part,
+                            this->slot(this->tail_));
+  std::uninitialized_move_n(values.begin() + first_part, count - first_part,
+                            this->slot(0));
+  this->tail_ = this->wrap(this->tail_ + count);
+  this->grow(count);
+  return count;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::size_t CircularQueue<T, Capacity>::pop_many(std::span<T> out) {
+  const std::size_t count = std::min(out.size(), this->size());
+  const std::size_t first_part =
+      std::min(count, this->max_size() - this->head_);
+  T *first = this->slot(this->head_);
+  std::move(first, first + first_part, out.begin());
+  std::destroy_n(first, first_part);
+  std::move(this->slot(0), this->slot(count - first_part),
+            out.begin() + first_part);
+  std::destroy_n(this->slot(0), count - first_part);
+  this->head_ = this->wrap(this->head_ + count);
+  this->grow(-count);
+  return count;
 }
 
 template <typename T, std::size_t Capacity>
@@ -110,7 +336,7 @@ T *CircularQueue<T, Capacity>::front() {
   if (this->is_empty()) {
     return nullptr;
   }
-  return &this->queue_[this->head_];
+  return this->slot(this->head_);
 }
 
 template <typename T, std::size_t Capacity>
@@ -119,8 +345,9 @@ void CircularQueue<T, Capacity>::pop() {
   if (this->is_empty()) {
     return;
   }
-  this->head_ = (this->head_ + 1) % Capacity;
-  this->space_used_--;
+  std::destroy_at(this->slot(this->head_));
+  this->head_ = this->wrap(this->head_ + 1);
+  this->grow(-1);
   return;
 }
 } // namespace chx::buffered
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#define CHX_HAS_MMAP 1
+#else
+#define CHX_HAS_MMAP 0
+#endif
+
+namespace chx {
+
+/**
+ *  @brief Pages backing the buffer of a runtime sized channel.
+ * */
+enum class PageBacking : uint8_t {
+  /// Regular pages.
+  standard,
+  /// Huge pages if the system has them available, regular pages otherwise.
+  huge,
+};
+
+namespace buffered {
+
+/**
+ *  @brief Uninitialized memory for the ring of a runtime sized queue.
+ *
+ *  Small rings come from the heap. Rings of at least `mmap_threshold` bytes
+ *  are mapped straight from the kernel without reserving swap, so their pages
+ *  are only committed once the queue first writes to them: a large channel
+ *  costs nothing until it is actually filled.
+ *
+ *  A ring given a `std::pmr::memory_resource` always comes from it instead,
+ *  whatever its size, so it lives in the arena chosen by the caller.
+ * */
+class RingMemory {
+public:
+  static constexpr std::size_t mmap_threshold = std::size_t{1} << 20;
+  static constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+
+  /**
+   *  @brief Allocates `bytes` bytes aligned to `alignment`, from `resource`
+   *  if it is not null.
+   *  @throws std::bad_alloc if the memory could not be obtained.
+   * */
+  RingMemory(std::size_t bytes, std::size_t alignment, PageBacking pages,
+             std::pmr::memory_resource *resource = nullptr);
+  ~RingMemory();
+
+  RingMemory(const RingMemory &) = delete;
+  RingMemory &operator=(const RingMemory &) = delete;
+
+  void *data() const { return this->data_; }
+
+  /**
+   *  @returns True if the memory is mapped (and so lazily committed) instead
+   *  of allocated from the heap.
+   * */
+  bool is_mapped() const { return this->mapped_size_ != 0; }
+
+private:
+#if CHX_HAS_MMAP
+  /**
+   *  @returns The mapping, or nullptr if `bytes` could not be mapped.
+   * */
+  void *map(std::size_t bytes, PageBacking pages);
+#endif
+
+  void *data_ = nullptr;
+  std::size_t bytes_;
+  std::size_t alignment_;
+  std::size_t mapped_size_ = 0;
+  std::pmr::memory_resource *resource_;
+};
+
+inline RingMemory::RingMemory(std::size_t bytes, std::size_t alignment,
+                              PageBacking pages,
+                              std::pmr::memory_resource *resource)
+    : bytes_(bytes), alignment_(alignment), resource_(resource) {
+  if (this->resource_ != nullptr) {
+    this->data_ = this->resource_->allocate(bytes, alignment);
+    return;
+  }
+#if CHX_HAS_MMAP
+  if (bytes >= mmap_threshold) {
+    this->data_ = this->map(bytes, pages);
+    if (this->data_ != nullptr) {
+      return;
+    }
+  }
+#else
+  (void)pages;
+#endif
+  this->data_ = ::operator new(bytes, std::align_val_t{alignment});
+}
+
+inline RingMemory::~RingMemory() {
+  if (this->resource_ != nullptr) {
+    this->resource_->deallocate(this->data_, this->bytes_, this->alignment_);
+    return;
+  }
+#if CHX_HAS_MMAP
+  if (this->is_mapped()) {
+    ::munmap(this->data_, this->mapped_size_);
+    return;
+  }
+#endif
+  ::operator delete(this->data_, std::align_val_t{this->alignment_});
+}
+
+#if CHX_HAS_MMAP
+inline void *RingMemory::map(std::size_t bytes, PageBacking pages) {
+  constexpr int prot = PROT_READ | PROT_WRITE;
+  constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  void *memory = MAP_FAILED;
+  std::size_t size = bytes;
+#ifdef MAP_HUGETLB
+  if (pages == PageBacking::huge) {
+    // Explicit huge pages only exist if the administrator reserved them. They
+    // are reserved up front (no MAP_NORESERVE), so the mapping fails here
+    // instead of faulting on first use when the pool is empty.
+    size = (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+    memory = ::mmap(nullptr, size, prot, flags | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (memory == MAP_FAILED) {
+    size = bytes;
+    memory = ::mmap(nullptr, size, prot, flags | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+      return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    if (pages == PageBacking::huge) {
+      // Fall back to transparent huge pages.
+      ::madvise(memory, size, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  this->mapped_size_ = size;
+  return memory;
+}
+#endif
+
+} // namespace buffered
+} // namespace chx
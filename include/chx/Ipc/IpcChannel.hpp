@@ -0,0 +1,601 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include "chx/cache_line.hpp"
+#include "chx/channel.hpp"
+#include "chx/channelCore.hpp"
+#include "chx/futex.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace chx::ipc {
+
+/**
+ *  @brief Bounded channel whose ring lives in shared memory, so that several
+ *  processes can send and receive through it: a named POSIX shared memory
+ *  object (`shm_open`) or an anonymous file (`memfd_create`) handed to the
+ *  other processes by `fork` or over a UNIX socket.
+ *
+ *  The ring is the same as the one of `mpmc::Channel` (a sequence number per
+ *  slot), so any number of senders and receivers, in any process, only
+ *  contend on a CAS of their own cursor. Blocked threads wait on futexes
+ *  that live in the mapping, and `close` is seen by every process.
+ *
+ *  Objects are copied byte by byte between address spaces, so `T` must be
+ *  trivially copyable, and every process must agree on its layout. The
+ *  channel checks its size and alignment when it is opened.
+ *
+ *  A process that dies in the middle of a `send` may leave its slot claimed
+ *  but never filled, which blocks the receivers once they reach it.
+ *  `select` and the coroutines only learn about the operations made by this
+ *  process, and dropping every handle of a process does not close the
+ *  channel: it has to be closed explicitly.
+ * */
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+class Channel final : public chx::ChannelCore<T> {
+public:
+  /**
+   *  @brief Creates a channel of (at least) `capacity` objects in a new
+   *  shared memory object called `name` (such as "/jobs"), which must not
+   *  exist yet. It outlives the process until `unlink(name)`.
+   *  @throws std::system_error if the object could not be created.
+   *  @throws std::length_error if `capacity` is above `max_capacity()`.
+   * */
+  static std::shared_ptr<Channel> create(const std::string &name,
+                                         std::size_t capacity) {
+    const int fd =
+        ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    try {
+      return std::shared_ptr<Channel>(new Channel(fd, capacity));
+    } catch (...) {
+      ::shm_unlink(name.c_str());
+      throw;
+    }
+  }
+
+  /**
+   *  @brief Creates a channel of (at least) `capacity` objects in an
+   *  anonymous file. Other processes get it through `fork`, or by receiving
+   *  `fd()` over a UNIX socket and calling `open(fd)`.
+   *  @throws std::system_error if the file could not be created.
+   *  @throws std::length_error if `capacity` is above `max_capacity()`.
+   * */
+  static std::shared_ptr<Channel> create(std::size_t capacity) {
+    const int fd = ::memfd_create("chx", MFD_CLOEXEC);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "memfd_create");
+    }
+    return std::shared_ptr<Channel>(new Channel(fd, capacity));
+  }
+
+  /**
+   *  @brief Opens the channel created as `name` by another process.
+   *  @throws std::system_error if it does not exist, or is not a channel of
+   *  `T` (yet).
+   * */
+  static std::shared_ptr<Channel> open(const std::string &name) {
+    const int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    return std::shared_ptr<Channel>(new Channel(fd));
+  }
+
+  /**
+   *  @brief Opens the channel stored in the file `fd`. The channel keeps its
+   *  own duplicate of `fd`.
+   *  @throws std::system_error if `fd` is not a channel of `T`.
+   * */
+  static std::shared_ptr<Channel> open(int fd) {
+    const int own = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (own < 0) {
+      throw std::system_error(errno, std::generic_category(), "fcntl");
+    }
+    return std::shared_ptr<Channel>(new Channel(own));
+  }
+
+  /**
+   *  @brief Removes the name of a shared memory object. The processes that
+   *  opened it keep using it.
+   * */
+  static void unlink(const std::string &name) { ::shm_unlink(name.c_str()); }
+
+  /**
+   *  @returns The largest capacity a channel can be created with. It is a
+   *  power of two, so rounding a smaller capacity up never passes it, and
+   *  the mapping of its slots fits in a `std::size_t`.
+   * */
+  static constexpr std::size_t max_capacity() {
+    return std::bit_floor(
+        (std::numeric_limits<std::size_t>::max() - slots_offset) /
+        sizeof(Slot));
+  }
+
+  ~Channel() {
+    ::munmap(this->header, this->bytes);
+    ::close(this->fd_);
+  }
+
+  Channel(const Channel &) = delete;
+  Channel &operator=(const Channel &) = delete;
+
+  /**
+   *  @returns The file descriptor of the shared memory, to pass it to other
+   *  processes.
+   * */
+  int fd() const { return this->fd_; }
+
+  std::expected<void, Error> send(const T &value) override {
+    return this->send_(value, no_deadline);
+  }
+  std::expected<void, Error> send(T &&value) override {
+    return this->send_(value, no_deadline);
+  }
+  std::expected<void, Error> try_send(T &&value) override {
+    return this->try_send(std::as_const(value));
+  }
+  std::expected<void, Error> try_send(const T &value) override;
+
+  std::expected<T, Error> receive() override {
+    return this->receive_(no_deadline);
+  }
+  std::expected<T, Error> try_receive() override;
+
+  std::expected<void, Error> send_until(T &&value,
+                                        Deadline deadline) override {
+    return this->send_(value, deadline);
+  }
+  std::expected<void, Error> send_until(const T &value,
+                                        Deadline deadline) override {
+    return this->send_(value, deadline);
+  }
+  std::expected<T, Error> receive_until(Deadline deadline) override {
+    return this->receive_(deadline);
+  }
+
+  void close() override;
+  bool is_closed() const override {
+    return this->header->closed.load(std::memory_order_acquire) != 0;
+  }
+
+  std::size_t size() const override {
+    // The dequeue cursor never passes the enqueue one, so reading it first
+    // never underflows.
+    const std::uint64_t head =
+        this->header->dequeue_pos.load(std::memory_order_acquire);
+    const std::uint64_t tail =
+        this->header->enqueue_pos.load(std::memory_order_acquire);
+    return std::min<std::uint64_t>(tail - head, this->header->capacity);
+  }
+  std::size_t capacity() const override { return this->header->capacity; }
+
+  // Senders of the other processes are not counted, so the receivers can not
+  // tell when the channel is drained: it closes right away.
+  void close_sending() override { this->close(); }
+
+protected:
+  // Handles are only counted in this process, while other processes may
+  // still send and receive: dropping them never closes the channel.
+  void disconnect_senders() override {}
+  void disconnect_receivers() override {}
+
+private:
+  static constexpr std::uint64_t magic = 0x6368782d69706331; // "chx-ipc1"
+
+  struct Slot {
+    std::atomic<std::uint64_t> sequence;
+    T value;
+  };
+
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                "shared cursors must be lock-free");
+
+  /**
+   *  @brief Layout of the start of the mapping; the slots follow it. Every
+   *  field is either written once before `magic` is published, or an atomic.
+   * */
+  struct Header {
+    std::atomic<std::uint64_t> magic;
+    std::uint64_t capacity;
+    std::uint32_t slot_size;
+    std::uint32_t slot_alignment;
+
+    alignas(cache_line_size) std::atomic<std::uint64_t> enqueue_pos;
+    alignas(cache_line_size) std::atomic<std::uint64_t> dequeue_pos;
+
+    // Futex words, bumped to wake the threads parked on them.
+    alignas(cache_line_size) std::atomic<std::uint32_t> readable;
+    std::atomic<std::uint32_t> writable;
+    std::atomic<std::uint32_t> receivers_waiting;
+    std::atomic<std::uint32_t> senders_waiting;
+    std::atomic<std::uint32_t> closed;
+  };
+
+  static constexpr std::size_t slots_offset =
+      (sizeof(Header) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+  /**
+   *  @brief Builds a new channel in the empty file `fd`, which it owns.
+   * */
+  Channel(int fd, std::size_t capacity);
+
+  /**
+   *  @brief Maps the channel already stored in `fd`, which it owns.
+   * */
+  explicit Channel(int fd);
+
+  void map(std::size_t bytes);
+  [[noreturn]] void fail(int error, const char *what);
+
+  bool try_push(const T &value);
+  std::optional<T> try_pop();
+  bool has_space() const;
+  bool has_value() const;
+
+  std::expected<void, Error> send_(const T &value, Deadline deadline);
+  std::expected<T, Error> receive_(Deadline deadline);
+
+  /**
+   *  @brief Slow path: blocks the calling thread on the futex `word` until
+   *  `ready` holds or `deadline` expires, and returns the last value of
+   *  `ready`. `waiting` counts the parked threads of every process.
+   * */
+  template <typename Predicate>
+  bool park(std::atomic<std::uint32_t> &word,
+            std::atomic<std::uint32_t> &waiting, detail::Side side,
+            Deadline deadline, Predicate ready);
+  void wake(std::atomic<std::uint32_t> &word,
+            std::atomic<std::uint32_t> &waiting);
+
+  Slot &slot(std::uint64_t pos) const { return this->slots[pos & this->mask]; }
+
+  int fd_;
+  std::size_t bytes = 0;
+  Header *header = nullptr;
+  Slot *slots = nullptr;
+  std::uint64_t mask = 0;
+};
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+Channel<T>::Channel(int fd, std::size_t capacity)
+    : chx::ChannelCore<T>(), fd_(fd) {
+  if (capacity > max_capacity()) {
+    ::close(fd);
+    throw std::length_error("chx::ipc::Channel: capacity is too large");
+  }
+  capacity = std::bit_ceil(std::max<std::size_t>(capacity, 2));
+  const std::size_t bytes = slots_offset + capacity * sizeof(Slot);
+  if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+    this->fail(errno, "ftruncate");
+  }
+  this->map(bytes);
+  std::construct_at(this->header);
+  this->header->capacity = capacity;
+  this->header->slot_size = sizeof(Slot);
+  this->header->slot_alignment = alignof(Slot);
+  this->mask = capacity - 1;
+  for (std::uint64_t i = 0; i < capacity; ++i) {
+    ::new (static_cast<void *>(&this->slots[i])) Slot;
+    this->slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  // Openers only trust the header once they see the magic number.
+  this->header->magic.store(magic, std::memory_order_release);
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+Channel<T>::Channel(int fd) : chx::ChannelCore<T>(), fd_(fd) {
+  struct stat status {};
+  if (::fstat(fd, &status) != 0) {
+    this->fail(errno, "fstat");
+  }
+  const auto bytes = static_cast<std::size_t>(status.st_size);
+  if (bytes < slots_offset) {
+    this->fail(EINVAL, "chx::ipc::Channel: not a channel");
+  }
+  this->map(bytes);
+  const Header &header = *this->header;
+  if (header.magic.load(std::memory_order_acquire) != magic ||
+      header.slot_size != sizeof(Slot) ||
+      header.slot_alignment != alignof(Slot) ||
+      !std::has_single_bit(header.capacity) ||
+      header.capacity > (bytes - slots_offset) / sizeof(Slot)) {
+    ::munmap(this->header, bytes);
+    this->fail(EINVAL, "chx::ipc::Channel: not a channel of this type");
+  }
+  this->mask = header.capacity - 1;
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+void Channel<T>::map(std::size_t bytes) {
+  void *address =
+      ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd_, 0);
+  if (address == MAP_FAILED) {
+    this->fail(errno, "mmap");
+  }
+  this->bytes = bytes;
+  this->header = static_cast<Header *>(address);
+  this->slots = reinterpret_cast<Slot *>(static_cast<char *>(address) +
+                                         slots_offset);
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+void Channel<T>::fail(int error, const char *what) {
+  ::close(this->fd_);
+  throw std::system_error(error, std::generic_category(), what);
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+void Channel<T>::close() {
+  this->header->closed.store(1, std::memory_order_release);
+  this->metrics_.closed();
+  this->header->readable.fetch_add(1, std::memory_order_release);
+  this->header->writable.fetch_add(1, std::memory_order_release);
+  detail::futex_wake_all(this->header->readable, detail::FutexScope::shared);
+  detail::futex_wake_all(this->header->writable, detail::FutexScope::shared);
+  this->notify_waiters(WaitEvent::closed);
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+std::expected<void, Error> Channel<T>::try_send(const T &value) {
+  if (this->is_closed()) {
+    return std::unexpected(Error::closed);
+  }
+  if (!this->try_push(value)) {
+    this->metrics_.try_failed(detail::Side::send);
+    return std::unexpected(Error::would_block);
+  }
+  return {};
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+std::expected<T, Error> Channel<T>::try_receive() {
+  if (this->is_closed()) {
+    return std::unexpected(Error::closed);
+  }
+  if (auto value = this->try_pop()) {
+    return *value;
+  }
+  this->metrics_.try_failed(detail::Side::receive);
+  return std::unexpected(Error::would_block);
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+bool Channel<T>::try_push(const T &value) {
+  auto &enqueue_pos = this->header->enqueue_pos;
+  std::uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+  Slot *slot;
+  for (;;) {
+    slot = &this->slot(pos);
+    const std::uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+    const auto diff =
+        static_cast<std::int64_t>(seq) - static_cast<std::int64_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+  slot->value = value;
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  this->record_sent(1);
+  this->wake(this->header->readable, this->header->receivers_waiting);
+  this->notify_waiters(WaitEvent::readable);
+  return true;
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+std::optional<T> Channel<T>::try_pop() {
+  auto &dequeue_pos = this->header->dequeue_pos;
+  std::uint64_t pos = dequeue_pos.load(std::memory_order_relaxed);
+  Slot *slot;
+  for (;;) {
+    slot = &this->slot(pos);
+    const std::uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+    const auto diff =
+        static_cast<std::int64_t>(seq) - static_cast<std::int64_t>(pos + 1);
+    if (diff == 0) {
+      if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return std::nullopt;
+    } else {
+      pos = dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+  std::optional<T> value(slot->value);
+  slot->sequence.store(pos + this->header->capacity,
+                       std::memory_order_release);
+  this->metrics_.received(1);
+  this->wake(this->header->writable, this->header->senders_waiting);
+  this->notify_waiters(WaitEvent::writable);
+  return value;
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+bool Channel<T>::has_space() const {
+  const std::uint64_t pos =
+      this->header->enqueue_pos.load(std::memory_order_relaxed);
+  const std::uint64_t seq =
+      this->slot(pos).sequence.load(std::memory_order_acquire);
+  return static_cast<std::int64_t>(seq) - static_cast<std::int64_t>(pos) >= 0;
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+bool Channel<T>::has_value() const {
+  const std::uint64_t pos =
+      this->header->dequeue_pos.load(std::memory_order_relaxed);
+  const std::uint64_t seq =
+      this->slot(pos).sequence.load(std::memory_order_acquire);
+  return static_cast<std::int64_t>(seq) -
+             static_cast<std::int64_t>(pos + 1) >=
+         0;
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+template <typename Predicate>
+bool Channel<T>::park(std::atomic<std::uint32_t> &word,
+                      std::atomic<std::uint32_t> &waiting, detail::Side side,
+                      Deadline deadline, Predicate ready) {
+  [[maybe_unused]] auto blocked = this->metrics_.block(side);
+  for (;;) {
+    const std::uint32_t epoch = word.load(std::memory_order_acquire);
+    waiting.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence in `wake`: either the waker sees our counter (and
+    // bumps the word, so the futex does not sleep), or we see the sequence
+    // number it has just published.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const bool done = ready();
+    if (!done) {
+      detail::futex_wait(word, epoch, deadline, detail::FutexScope::shared);
+    }
+    waiting.fetch_sub(1, std::memory_order_relaxed);
+    if (done || ready()) {
+      return true;
+    }
+    if (deadline != no_deadline &&
+        std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+  }
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+void Channel<T>::wake(std::atomic<std::uint32_t> &word,
+                      std::atomic<std::uint32_t> &waiting) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  word.fetch_add(1, std::memory_order_release);
+  detail::futex_wake(word, 1, detail::FutexScope::shared);
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+std::expected<void, Error> Channel<T>::send_(const T &value,
+                                             Deadline deadline) {
+  for (;;) {
+    if (this->is_closed()) {
+      return std::unexpected(Error::closed);
+    }
+    if (this->try_push(value)) {
+      return {};
+    }
+    if (!this->park(this->header->writable, this->header->senders_waiting,
+                    detail::Side::send, deadline, [&] {
+                      return this->has_space() || this->is_closed();
+                    })) {
+      return std::unexpected(Error::timeout);
+    }
+  }
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+std::expected<T, Error> Channel<T>::receive_(Deadline deadline) {
+  for (;;) {
+    if (this->is_closed()) {
+      return std::unexpected(Error::closed);
+    }
+    if (auto value = this->try_pop()) {
+      return *value;
+    }
+    if (!this->park(this->header->readable, this->header->receivers_waiting,
+                    detail::Side::receive, deadline, [&] {
+                      return this->has_value() || this->is_closed();
+                    })) {
+      return std::unexpected(Error::timeout);
+    }
+  }
+}
+
+} // namespace chx::ipc
+
+namespace chx {
+
+/**
+ *  @brief Creates a channel of (at least) `capacity` objects shared between
+ *  processes through the POSIX shared memory object `name`. Other processes
+ *  open it with `OpenSharedChannel<T>(name)`, and use it as any other
+ *  channel, through its senders and receivers.
+ *  @throws std::system_error if the object could not be created.
+ *  @throws std::length_error if `capacity` is above
+ *  `ipc::Channel<T>::max_capacity()`.
+ * */
+template <typename T>
+Channel<T, ipc::Channel<T>> CreateSharedChannel(const std::string &name,
+                                                std::size_t capacity) {
+  return Channel<T, ipc::Channel<T>>(ipc::Channel<T>::create(name, capacity));
+}
+
+/**
+ *  @brief Creates a channel of (at least) `capacity` objects in an anonymous
+ *  shared file, inherited by the processes forked afterwards.
+ * */
+template <typename T>
+Channel<T, ipc::Channel<T>> CreateSharedChannel(std::size_t capacity) {
+  return Channel<T, ipc::Channel<T>>(ipc::Channel<T>::create(capacity));
+}
+
+/**
+ *  @brief Opens a channel created by another process with
+ *  `CreateSharedChannel<T>(name, capacity)`.
+ *  @throws std::system_error if it does not exist, or is not a channel of
+ *  `T`.
+ * */
+template <typename T>
+Channel<T, ipc::Channel<T>> OpenSharedChannel(const std::string &name) {
+  return Channel<T, ipc::Channel<T>>(ipc::Channel<T>::open(name));
+}
+
+/**
+ *  @brief Opens the channel stored in the shared file `fd` (see
+ *  `ipc::Channel::fd`).
+ * */
+template <typename T> Channel<T, ipc::Channel<T>> OpenSharedChannel(int fd) {
+  return Channel<T, ipc::Channel<T>>(ipc::Channel<T>::open(fd));
+}
+
+} // namespace chx
+
+#endif
@@ -0,0 +1,439 @@
+#pragma once
+
+#include "chx/cache_line.hpp"
+#include "chx/channelCore.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace chx::mpmc {
+
+/**
+ *  @brief Bounded buffered channel for any number of senders and receivers.
+ *  Every slot of the ring carries a sequence number (Vyukov's bounded queue),
+ *  so senders and receivers only contend on a CAS of their own cursor. The
+ *  mutex is only taken to park a thread when the ring is full (or empty).
+ *  Objects are constructed in their slot when pushed and destroyed when
+ *  popped.
+ *
+ *  The ring needs at least two slots to tell a full slot from a free one.
+ * */
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+class Channel final : public chx::ChannelCore<T> {
+public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  Channel() : Channel(std::allocator_arg, allocator_type()) {}
+  /**
+   *  @brief Builds a channel whose waiter list is allocated from `alloc` (see
+   *  `CreateChannel`).
+   * */
+  Channel(std::allocator_arg_t, const allocator_type &alloc);
+  ~Channel();
+
+  std::expected<void, Error> send(const T &value) override;
+  std::expected<void, Error> send(T &&value) override;
+  std::expected<void, Error> try_send(T &&value) override;
+  std::expected<void, Error> try_send(const T &value) override;
+
+  std::expected<T, Error> receive() override;
+  std::expected<T, Error> try_receive() override;
+
+  std::expected<void, Error> send_until(T &&value,
+                                        Deadline deadline) override;
+  std::expected<void, Error> send_until(const T &value,
+                                        Deadline deadline) override;
+  std::expected<T, Error> receive_until(Deadline deadline) override;
+
+  virtual void close() override;
+  virtual bool is_closed() const override;
+
+  std::size_t size() const override;
+  std::size_t capacity() const override { return Capacity; }
+
+  Channel<T, Capacity> &operator=(const Channel<T, Capacity> &ch) = delete;
+
+protected:
+  void disconnect_senders() override;
+
+private:
+  struct Slot {
+    std::atomic<std::size_t> sequence;
+    alignas(T) std::byte storage[sizeof(T)];
+
+    T *value() { return reinterpret_cast<T *>(this->storage); }
+  };
+
+  /**
+   *  @returns The slot of the (unwrapped) cursor `pos`. Power of two
+   *  capacities use a mask instead of a division.
+   * */
+  Slot &slot(std::size_t pos) { return this->buffer[wrap(pos)]; }
+  const Slot &slot(std::size_t pos) const { return this->buffer[wrap(pos)]; }
+  static constexpr std::size_t wrap(std::size_t pos) {
+    if constexpr (std::has_single_bit(Capacity)) {
+      return pos & (Capacity - 1);
+    } else {
+      return pos % Capacity;
+    }
+  }
+
+  template <typename U>
+    requires std::constructible_from<T, U &&>
+  std::expected<void, Error> send_(U &&value, Deadline deadline);
+
+  std::expected<T, Error> receive_(Deadline deadline);
+
+  /**
+   *  @brief Claims the slot at the enqueue cursor and stores `value` in it.
+   *  `value` is left untouched if the ring is full.
+   *  @returns True if the value was stored. False if the ring is full.
+   * */
+  template <typename U> bool try_push(U &&value);
+
+  /**
+   *  @brief Claims the slot at the dequeue cursor and moves its value out.
+   *  @returns The value, or `std::nullopt` if the ring is empty.
+   * */
+  std::optional<T> try_pop();
+
+  bool has_space() const;
+  bool has_value() const;
+
+  /**
+   *  @brief Slow path: blocks the calling thread on `cv` until `ready` holds
+   *  or `deadline` expires, and returns the last value of `ready`.
+   *  `waiting` counts the parked threads so that the fast path can skip the
+   *  mutex when there is nobody to wake. The time spent blocked is recorded
+   *  as `side`.
+   * */
+  template <typename Predicate>
+  bool park(std::condition_variable &cv, std::atomic<std::size_t> &waiting,
+            detail::Side side, Deadline deadline, Predicate ready);
+  void wake(std::condition_variable &cv, std::atomic<std::size_t> &waiting);
+
+  /**
+   *  @returns True if the last sender was dropped and everything it sent was
+   *  received: receivers get `Error::closed` from then on.
+   * */
+  bool drained() const { return this->senders_gone() && !this->has_value(); }
+
+  alignas(cache_line_size) std::atomic<std::size_t> enqueue_pos{0};
+  alignas(cache_line_size) std::atomic<std::size_t> dequeue_pos{0};
+
+  alignas(cache_line_size) std::atomic<bool> closed{false};
+  std::atomic<std::size_t> senders_waiting{0};
+  std::atomic<std::size_t> receivers_waiting{0};
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+
+  alignas(cache_line_size) std::array<Slot, Capacity> buffer;
+};
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+Channel<T, Capacity>::Channel(std::allocator_arg_t,
+                              const allocator_type &alloc)
+    : chx::ChannelCore<T>(alloc.resource()) {
+  for (std::size_t i = 0; i < Capacity; i++) {
+    this->buffer[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+Channel<T, Capacity>::~Channel() {
+  // Nobody else uses the channel anymore, so every claim was published.
+  const std::size_t tail = this->enqueue_pos.load(std::memory_order_relaxed);
+  for (std::size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+       pos != tail; pos++) {
+    std::destroy_at(this->slot(pos).value());
+  }
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+void Channel<T, Capacity>::close() {
+  this->closed.store(true, std::memory_order_release);
+  this->metrics_.closed();
+  std::lock_guard lock(this->mutex);
+  this->not_empty.notify_all();
+  this->not_full.notify_all();
+  this->notify_waiters(WaitEvent::closed);
+  return;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+bool Channel<T, Capacity>::is_closed() const {
+  return this->closed.load(std::memory_order_acquire) || this->drained();
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+void Channel<T, Capacity>::disconnect_senders() {
+  // Parked receivers check `senders_gone` under the mutex.
+  std::lock_guard lock(this->mutex);
+  this->not_empty.notify_all();
+  this->notify_waiters(WaitEvent::closed);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::expected<void, Error> Channel<T, Capacity>::send(const T &value) {
+  return this->send_(value, no_deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::expected<void, Error> Channel<T, Capacity>::send(T &&value) {
+  return this->send_(std::move(value), no_deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::expected<void, Error> Channel<T, Capacity>::send_until(const T &value,
+                                                            Deadline deadline) {
+  return this->send_(value, deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::expected<void, Error> Channel<T, Capacity>::send_until(T &&value,
+                                                            Deadline deadline) {
+  return this->send_(std::move(value), deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::expected<T, Error> Channel<T, Capacity>::receive() {
+  return this->receive_(no_deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::expected<T, Error> Channel<T, Capacity>::receive_until(Deadline deadline) {
+  return this->receive_(deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::expected<void, Error> Channel<T, Capacity>::try_send(const T &value) {
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  if (!this->try_push(value)) {
+    this->metrics_.try_failed(detail::Side::send);
+    return std::unexpected(Error::would_block);
+  }
+  return {};
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::expected<void, Error> Channel<T, Capacity>::try_send(T &&value) {
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  if (!this->try_push(std::move(value))) {
+    this->metrics_.try_failed(detail::Side::send);
+    return std::unexpected(Error::would_block);
+  }
+  return {};
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+template <typename U>
+bool Channel<T, Capacity>::try_push(U &&value) {
+  std::size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+  Slot *slot;
+  for (;;) {
+    slot = &this->slot(pos);
+    const std::size_t seq = slot->sequence.load(std::memory_order_acquire);
+    const auto diff =
+        static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+    if (diff == 0) {
+      if (this->enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                  std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = this->enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+  std::construct_at(slot->value(), std::forward<U>(value));
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  this->record_sent(1);
+  this->wake(this->not_empty, this->receivers_waiting);
+  this->notify_waiters(WaitEvent::readable);
+  return true;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::optional<T> Channel<T, Capacity>::try_pop() {
+  std::size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+  Slot *slot;
+  for (;;) {
+    slot = &this->slot(pos);
+    const std::size_t seq = slot->sequence.load(std::memory_order_acquire);
+    const auto diff =
+        static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+    if (diff == 0) {
+      if (this->dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                  std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return std::nullopt;
+    } else {
+      pos = this->dequeue_pos.load(std::memory_order_relaxed);
+    }
+  }
+  std::optional<T> value(std::move(*slot->value()));
+  std::destroy_at(slot->value());
+  slot->sequence.store(pos + Capacity, std::memory_order_release);
+  this->metrics_.received(1);
+  this->wake(this->not_full, this->senders_waiting);
+  this->notify_waiters(WaitEvent::writable);
+  return value;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::size_t Channel<T, Capacity>::size() const {
+  // Claimed slots count as stored. The dequeue cursor never passes the
+  // enqueue one, so reading it first never underflows.
+  const std::size_t head = this->dequeue_pos.load(std::memory_order_acquire);
+  const std::size_t tail = this->enqueue_pos.load(std::memory_order_acquire);
+  return std::min(tail - head, Capacity);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+bool Channel<T, Capacity>::has_space() const {
+  const std::size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+  const std::size_t seq =
+      this->slot(pos).sequence.load(std::memory_order_acquire);
+  return static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos) >=
+         0;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+bool Channel<T, Capacity>::has_value() const {
+  const std::size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+  const std::size_t seq =
+      this->slot(pos).sequence.load(std::memory_order_acquire);
+  return static_cast<std::intptr_t>(seq) -
+             static_cast<std::intptr_t>(pos + 1) >=
+         0;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+template <typename Predicate>
+bool Channel<T, Capacity>::park(std::condition_variable &cv,
+                                std::atomic<std::size_t> &waiting,
+                                detail::Side side, Deadline deadline,
+                                Predicate ready) {
+  [[maybe_unused]] auto blocked = this->metrics_.block(side);
+  std::unique_lock lock(this->mutex);
+  waiting.fetch_add(1, std::memory_order_relaxed);
+  // Pairs with the fence in `wake`: either the waker sees our counter, or we
+  // see the sequence number it has just published.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const bool result = detail::wait_until(cv, lock, deadline, ready);
+  waiting.fetch_sub(1, std::memory_order_relaxed);
+  return result;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+void Channel<T, Capacity>::wake(std::condition_variable &cv,
+                                std::atomic<std::size_t> &waiting) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  std::lock_guard lock(this->mutex);
+  cv.notify_one();
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+template <typename U>
+  requires std::constructible_from<T, U &&>
+std::expected<void, Error> Channel<T, Capacity>::send_(U &&value,
+                                                       Deadline deadline) {
+  for (;;) {
+    if (this->closed.load(std::memory_order_acquire)) {
+      return std::unexpected(Error::closed);
+    }
+    if (this->try_push(std::forward<U>(value))) {
+      return {};
+    }
+    if (!this->park(this->not_full, this->senders_waiting, detail::Side::send,
+                    deadline, [&] {
+                      return this->has_space() ||
+                             this->closed.load(std::memory_order_acquire);
+                    })) {
+      return std::unexpected(Error::timeout);
+    }
+  }
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::expected<T, Error> Channel<T, Capacity>::receive_(Deadline deadline) {
+  for (;;) {
+    if (this->closed.load(std::memory_order_acquire)) {
+      return std::unexpected(Error::closed);
+    }
+    if (auto value = this->try_pop()) {
+      return std::move(*value);
+    }
+    if (this->drained()) {
+      return std::unexpected(Error::closed);
+    }
+    if (!this->park(this->not_empty, this->receivers_waiting,
+                    detail::Side::receive, deadline, [&] {
+                      return this->has_value() ||
+                             this->closed.load(std::memory_order_acquire) ||
+                             this->senders_gone();
+                    })) {
+      return std::unexpected(Error::timeout);
+    }
+  }
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 1)
+std::expected<T, Error> Channel<T, Capacity>::try_receive() {
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  if (auto value = this->try_pop()) {
+    return std::move(*value);
+  }
+  if (this->drained()) {
+    return std::unexpected(Error::closed);
+  }
+  this->metrics_.try_failed(detail::Side::receive);
+  return std::unexpected(Error::would_block);
+}
+} // namespace chx::mpmc
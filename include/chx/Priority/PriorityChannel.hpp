@@ -0,0 +1,493 @@
+#pragma once
+
+#include "chx/Buffered/circular_queue.hpp"
+#include "chx/channelCore.hpp"
+#include "chx/wait_strategy.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <utility>
+
+namespace chx::priority {
+
+/**
+ *  @brief Buffered channel with `Lanes` FIFO lanes of `LaneCapacity` objects
+ *  each, protected by one mutex. Lane 0 has the highest priority: `receive`
+ *  always takes from the highest priority lane that is not empty, so a
+ *  control message sent through lane 0 overtakes the bulk data queued behind
+ *  it. All the lanes share the same receivers (and `select` waiters), while
+ *  senders only block when their own lane is full.
+ *
+ *  `send_to(lane, value)` chooses the lane. The operations of `ChannelCore`
+ *  (and so the type-erased handles, `select` and the coroutines) send through
+ *  the lowest priority lane, `Lanes - 1`.
+ *
+ *  Strict priority can starve the lower lanes. `weights[lane]` bounds the
+ *  number of objects received in a row from `lane` while a lower priority
+ *  lane has objects: once it is reached, the next lower lane that is not
+ *  empty is served once. A weight of 0 (the default) keeps strict priority.
+ * */
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait = wait::Blocking>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+class Channel final : public chx::ChannelCore<T> {
+public:
+  /// Lane used by the operations that do not name one.
+  static constexpr std::size_t default_lane = Lanes - 1;
+
+  using Weights = std::array<std::size_t, Lanes>;
+
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  explicit Channel(Weights weights = {})
+      : chx::ChannelCore<T>(), weights_(weights) {}
+  /**
+   *  @brief Builds a channel whose waiter list is allocated from `alloc` (see
+   *  `CreateChannel`).
+   * */
+  Channel(std::allocator_arg_t, const allocator_type &alloc,
+          Weights weights = {})
+      : chx::ChannelCore<T>(alloc.resource()), weights_(weights) {}
+  ~Channel() = default;
+
+  std::expected<void, Error> send(const T &value) override {
+    return this->send_(default_lane, no_deadline, value);
+  }
+  std::expected<void, Error> send(T &&value) override {
+    return this->send_(default_lane, no_deadline, std::move(value));
+  }
+  std::expected<void, Error> try_send(T &&value) override {
+    return this->try_send_(default_lane, std::move(value));
+  }
+  std::expected<void, Error> try_send(const T &value) override {
+    return this->try_send_(default_lane, value);
+  }
+
+  std::expected<T, Error> receive() override {
+    return this->receive_(no_deadline);
+  }
+  std::expected<T, Error> try_receive() override;
+
+  std::expected<void, Error> send_until(T &&value,
+                                        Deadline deadline) override {
+    return this->send_(default_lane, deadline, std::move(value));
+  }
+  std::expected<void, Error> send_until(const T &value,
+                                        Deadline deadline) override {
+    return this->send_(default_lane, deadline, value);
+  }
+  std::expected<T, Error> receive_until(Deadline deadline) override {
+    return this->receive_(deadline);
+  }
+
+  /**
+   *  @brief Sends an object through `lane` (0 is the highest priority). This
+   *  method blocks the thread while that lane is full. Lanes past the last
+   *  one are the last one.
+   * */
+  std::expected<void, Error> send_to(std::size_t lane, T &&value) {
+    return this->send_(lane, no_deadline, std::move(value));
+  }
+  std::expected<void, Error> send_to(std::size_t lane, const T &value) {
+    return this->send_(lane, no_deadline, value);
+  }
+
+  /**
+   *  @brief Sends an object through `lane` without blocking the thread.
+   *  @returns `Error::would_block` if that lane is full, even if other lanes
+   *  have room.
+   * */
+  std::expected<void, Error> try_send_to(std::size_t lane, T &&value) {
+    return this->try_send_(lane, std::move(value));
+  }
+  std::expected<void, Error> try_send_to(std::size_t lane, const T &value) {
+    return this->try_send_(lane, value);
+  }
+
+  /**
+   *  @brief Same as `send_to`, but the operation gives up at `deadline`.
+   * */
+  std::expected<void, Error> send_to_until(std::size_t lane, T &&value,
+                                           Deadline deadline) {
+    return this->send_(lane, deadline, std::move(value));
+  }
+  std::expected<void, Error> send_to_until(std::size_t lane, const T &value,
+                                           Deadline deadline) {
+    return this->send_(lane, deadline, value);
+  }
+
+  /**
+   *  @brief Sends an object constructed from `args` directly in its slot of
+   *  the lowest priority lane. This method blocks the thread until there is
+   *  room for it.
+   * */
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  std::expected<void, Error> emplace_send(Args &&...args) {
+    return this->send_(default_lane, no_deadline, std::forward<Args>(args)...);
+  }
+
+  std::expected<std::size_t, Error> send_many(std::span<T> values) override;
+  std::expected<std::size_t, Error>
+  try_send_many(std::span<T> values) override;
+  std::expected<std::size_t, Error>
+  receive_many(std::span<T> out, std::size_t min, std::size_t max) override;
+  std::expected<std::size_t, Error>
+  try_receive_many(std::span<T> out) override {
+    auto received = this->receive_many(out, 0, out.size());
+    if (!received.has_value() && received.error() == Error::would_block) {
+      this->metrics_.try_failed(detail::Side::receive);
+    }
+    return received;
+  }
+
+  void close() override;
+  bool is_closed() const override;
+
+  std::size_t size() const override {
+    std::size_t size = 0;
+    for (const auto &lane : this->lanes) {
+      size += lane.size();
+    }
+    return size;
+  }
+  std::size_t capacity() const override { return Lanes * LaneCapacity; }
+
+  /**
+   *  @returns The number of objects stored in `lane`.
+   * */
+  std::size_t size(std::size_t lane) const {
+    return this->lanes[clamp(lane)].size();
+  }
+
+  Channel &operator=(const Channel &ch) = delete;
+
+protected:
+  void disconnect_senders() override;
+
+private:
+  static constexpr std::size_t clamp(std::size_t lane) {
+    return std::min(lane, default_lane);
+  }
+
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  std::expected<void, Error> send_(std::size_t lane, Deadline deadline,
+                                   Args &&...args);
+
+  template <typename U>
+    requires std::constructible_from<T, U &&>
+  std::expected<void, Error> try_send_(std::size_t lane, U &&value);
+
+  std::expected<T, Error> receive_(Deadline deadline);
+
+  /**
+   *  @returns True if some lane stores an object.
+   * */
+  bool has_values() const {
+    for (const auto &lane : this->lanes) {
+      if (!lane.is_empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   *  @brief Chooses the lane of the next object received, applying the
+   *  weights. Must be called with the mutex held, and only if some lane
+   *  stores an object.
+   * */
+  std::size_t next_lane();
+
+  /**
+   *  @brief Takes the next object out of the lanes and wakes a sender blocked
+   *  on its lane. Must be called with the mutex held, and only if some lane
+   *  stores an object.
+   * */
+  T pop();
+
+  /**
+   *  @brief Waits on `cv` until `ready` holds or `deadline` expires, and
+   *  returns the last value of `ready`. The time spent blocked is recorded as
+   *  `side`.
+   * */
+  template <typename Predicate>
+  bool wait(std::unique_lock<std::mutex> &lock, typename Wait::Condition &cv,
+            detail::Side side, Deadline deadline, Predicate ready) {
+    if (ready()) {
+      return true;
+    }
+    [[maybe_unused]] auto blocked = this->metrics_.block(side);
+    return cv.wait_until(lock, deadline, ready);
+  }
+
+  /**
+   *  @brief Wakes the threads waiting on `cv`, and the registered waiters,
+   *  after `count` elements (or free slots) were made available. Must be
+   *  called with the mutex held.
+   * */
+  void notify(typename Wait::Condition &cv, std::size_t count,
+              WaitEvent event) {
+    if (count == 0) {
+      return;
+    }
+    if (count == 1) {
+      cv.notify_one();
+    } else {
+      cv.notify_all();
+    }
+    this->notify_waiters(event);
+  }
+
+  /**
+   *  @returns True if receivers get `Error::closed`: the channel was closed,
+   *  or its last sender was dropped and everything it sent was received.
+   * */
+  bool receive_closed() const {
+    return this->closed || (!this->has_values() && this->senders_gone());
+  }
+
+  mutable std::mutex mutex;
+  typename Wait::Condition not_empty;
+  std::array<typename Wait::Condition, Lanes> not_full;
+  std::array<buffered::CircularQueue<T, LaneCapacity>, Lanes> lanes;
+  // Objects received in a row from each lane while a lower one was waiting.
+  std::array<std::size_t, Lanes> streaks{};
+  Weights weights_;
+  bool closed = false;
+};
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+void Channel<T, Lanes, LaneCapacity, Wait>::close() {
+  std::lock_guard lock(this->mutex);
+  this->closed = true;
+  this->metrics_.closed();
+  this->not_empty.notify_all();
+  for (auto &cv : this->not_full) {
+    cv.notify_all();
+  }
+  this->notify_waiters(WaitEvent::closed);
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+bool Channel<T, Lanes, LaneCapacity, Wait>::is_closed() const {
+  std::lock_guard lock(this->mutex);
+  return this->receive_closed();
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+void Channel<T, Lanes, LaneCapacity, Wait>::disconnect_senders() {
+  std::lock_guard lock(this->mutex);
+  // The receivers take what is left, and then find the channel closed.
+  this->not_empty.notify_all();
+  this->notify_waiters(WaitEvent::closed);
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+template <typename... Args>
+  requires std::constructible_from<T, Args &&...>
+std::expected<void, Error>
+Channel<T, Lanes, LaneCapacity, Wait>::send_(std::size_t lane,
+                                             Deadline deadline,
+                                             Args &&...args) {
+  lane = clamp(lane);
+  auto &queue = this->lanes[lane];
+  std::unique_lock lock(this->mutex);
+  if (!this->wait(lock, this->not_full[lane], detail::Side::send, deadline,
+                  [&] { return !queue.is_full() || this->closed; })) {
+    return std::unexpected(Error::timeout);
+  }
+  if (this->closed) {
+    return std::unexpected(Error::closed);
+  }
+  queue.emplace(std::forward<Args>(args)...);
+  this->record_sent(1);
+  this->notify(this->not_empty, 1, WaitEvent::readable);
+  return {};
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+template <typename U>
+  requires std::constructible_from<T, U &&>
+std::expected<void, Error>
+Channel<T, Lanes, LaneCapacity, Wait>::try_send_(std::size_t lane,
+                                                 U &&value) {
+  auto &queue = this->lanes[clamp(lane)];
+  std::unique_lock lock(this->mutex);
+  if (this->closed) {
+    return std::unexpected(Error::closed);
+  }
+  if (queue.is_full()) {
+    this->metrics_.try_failed(detail::Side::send);
+    return std::unexpected(Error::would_block);
+  }
+  queue.push(std::forward<U>(value));
+  this->record_sent(1);
+  this->notify(this->not_empty, 1, WaitEvent::readable);
+  return {};
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+std::size_t Channel<T, Lanes, LaneCapacity, Wait>::next_lane() {
+  std::size_t lane = 0;
+  while (this->lanes[lane].is_empty()) {
+    lane++;
+  }
+  std::size_t lower = lane + 1;
+  while (lower < Lanes && this->lanes[lower].is_empty()) {
+    lower++;
+  }
+  if (lower == Lanes) {
+    // Nobody is waiting behind this lane.
+    this->streaks[lane] = 0;
+    return lane;
+  }
+  const std::size_t weight = this->weights_[lane];
+  if (weight != 0 && this->streaks[lane] >= weight) {
+    this->streaks[lane] = 0;
+    return lower;
+  }
+  this->streaks[lane]++;
+  return lane;
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+T Channel<T, Lanes, LaneCapacity, Wait>::pop() {
+  const std::size_t lane = this->next_lane();
+  auto &queue = this->lanes[lane];
+  T value = std::move(*queue.front());
+  queue.pop();
+  this->notify(this->not_full[lane], 1, WaitEvent::writable);
+  return value;
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+std::expected<T, Error>
+Channel<T, Lanes, LaneCapacity, Wait>::receive_(Deadline deadline) {
+  std::unique_lock lock(this->mutex);
+  if (!this->wait(lock, this->not_empty, detail::Side::receive, deadline, [&] {
+        return this->has_values() || this->receive_closed();
+      })) {
+    return std::unexpected(Error::timeout);
+  }
+  if (this->receive_closed()) {
+    return std::unexpected(Error::closed);
+  }
+  T value = this->pop();
+  this->metrics_.received(1);
+  return value;
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+std::expected<T, Error> Channel<T, Lanes, LaneCapacity, Wait>::try_receive() {
+  std::unique_lock lock(this->mutex);
+  if (this->receive_closed()) {
+    return std::unexpected(Error::closed);
+  }
+  if (!this->has_values()) {
+    this->metrics_.try_failed(detail::Side::receive);
+    return std::unexpected(Error::would_block);
+  }
+  T value = this->pop();
+  this->metrics_.received(1);
+  return value;
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+std::expected<std::size_t, Error>
+Channel<T, Lanes, LaneCapacity, Wait>::send_many(std::span<T> values) {
+  auto &queue = this->lanes[default_lane];
+  std::unique_lock lock(this->mutex);
+  std::size_t sent = 0;
+  while (sent < values.size()) {
+    this->wait(lock, this->not_full[default_lane], detail::Side::send,
+               no_deadline, [&] { return !queue.is_full() || this->closed; });
+    if (this->closed) {
+      break;
+    }
+    const std::size_t pushed = queue.push_many(values.subspan(sent));
+    sent += pushed;
+    this->record_sent(pushed);
+    this->notify(this->not_empty, pushed, WaitEvent::readable);
+  }
+  if (sent == 0 && this->closed) {
+    return std::unexpected(Error::closed);
+  }
+  return sent;
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+std::expected<std::size_t, Error>
+Channel<T, Lanes, LaneCapacity, Wait>::try_send_many(std::span<T> values) {
+  auto &queue = this->lanes[default_lane];
+  std::unique_lock lock(this->mutex);
+  if (this->closed) {
+    return std::unexpected(Error::closed);
+  }
+  const std::size_t sent = queue.push_many(values);
+  if (sent == 0 && !values.empty()) {
+    this->metrics_.try_failed(detail::Side::send);
+    return std::unexpected(Error::would_block);
+  }
+  this->record_sent(sent);
+  this->notify(this->not_empty, sent, WaitEvent::readable);
+  return sent;
+}
+
+template <typename T, std::size_t Lanes, std::size_t LaneCapacity,
+          typename Wait>
+  requires(Lanes > 0 && LaneCapacity > 0 && LaneCapacity != dynamic_capacity)
+std::expected<std::size_t, Error>
+Channel<T, Lanes, LaneCapacity, Wait>::receive_many(std::span<T> out,
+                                                    std::size_t min,
+                                                    std::size_t max) {
+  max = std::min(max, out.size());
+  min = std::min(min, max);
+  std::unique_lock lock(this->mutex);
+  std::size_t received = 0;
+  while (received < max) {
+    if (received < min) {
+      this->wait(lock, this->not_empty, detail::Side::receive, no_deadline,
+                 [&] { return this->has_values() || this->receive_closed(); });
+    }
+    if (this->receive_closed() || !this->has_values()) {
+      break;
+    }
+    // One object at a time, so the batch keeps the priority order.
+    out[received++] = this->pop();
+    this->metrics_.received(1);
+  }
+  if (received == 0 && max != 0) {
+    return std::unexpected(this->receive_closed() ? Error::closed
+                                                  : Error::would_block);
+  }
+  return received;
+}
+
+} // namespace chx::priority
@@ -1,26 +1,113 @@
 #pragma once
 
 #include "channel.hpp"
+#include <limits>
 
 namespace chx {
 
-template <typename T> class ReceiverChannel {
+template <typename T, typename Impl> class ReceiverChannel {
 public:
+  using value_type = T;
+  using core_type = Impl;
+
   ReceiverChannel() = delete;
+  template <typename Other>
+    requires(!std::same_as<Other, Impl> && std::derived_from<Other, Impl>)
+  ReceiverChannel(const ReceiverChannel<T, Other> &other)
+      : core_(detail::HandleAccess::core(other)), count_(core_) {}
   ~ReceiverChannel() = default;
 
-  std::expected<T, Error> receive() { return this->core_->receive(); }
-  std::expected<T, Error> try_receive() { return this->core_->try_receive(); }
+  std::expected<T, Error> receive() {
+    return this->buffer_.take_or([&] { return this->core_->receive(); });
+  }
+  std::expected<T, Error> try_receive() {
+    return this->buffer_.take_or([&] { return this->core_->try_receive(); });
+  }
+
+  template <typename Rep, typename Period>
+  std::expected<T, Error>
+  receive_for(const std::chrono::duration<Rep, Period> &timeout) {
+    return this->buffer_.take_or([&] {
+      return this->core_->receive_until(detail::deadline_after(timeout));
+    });
+  }
+  template <typename Clock, typename Duration>
+  std::expected<T, Error>
+  receive_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+    return this->buffer_.take_or([&] {
+      return this->core_->receive_until(detail::to_deadline(deadline));
+    });
+  }
+
+  std::expected<ReceiveView<T, Impl>, Error> acquire()
+    requires detail::ClaimingCore<Impl, T>
+  {
+    auto value = this->core_->acquire(no_deadline);
+    if (!value.has_value()) {
+      return std::unexpected(value.error());
+    }
+    return ReceiveView<T, Impl>(this->core_, *value);
+  }
+  std::expected<ReceiveView<T, Impl>, Error> try_acquire()
+    requires detail::ClaimingCore<Impl, T>
+  {
+    auto value = this->core_->try_acquire();
+    if (!value.has_value()) {
+      return std::unexpected(value.error());
+    }
+    return ReceiveView<T, Impl>(this->core_, *value);
+  }
+
+  ReceiveAwaitable<T> async_receive(Executor &executor = default_executor()) {
+    if (!this->buffer_.empty()) {
+      return ReceiveAwaitable<T>(this->core_, executor,
+                                 this->buffer_.take_front());
+    }
+    return ReceiveAwaitable<T>(this->core_, executor);
+  }
+
+  std::expected<std::size_t, Error>
+  receive_many(std::span<T> out, std::size_t min = 1,
+               std::size_t max = std::numeric_limits<std::size_t>::max()) {
+    return this->buffer_.receive_many(*this->core_, out, min, max);
+  }
+  std::expected<std::size_t, Error> try_receive_many(std::span<T> out) {
+    return this->buffer_.try_receive_many(*this->core_, out);
+  }
 
   void close() { this->core_->close(); }
   bool is_closed() { return this->core_->is_closed(); }
 
-  friend Channel<T>;
+  std::size_t size() const { return this->core_->size(); }
+  std::size_t capacity() const { return this->core_->capacity(); }
+  ChannelMetrics metrics() const { return this->core_->metrics(); }
+
+  /**
+   *  @brief Receives objects until the channel is closed (see
+   *  `ReceiveIterator`), so the receiver is an input range. The objects a
+   *  loop took from the channel but did not reach are kept by the handle,
+   *  for its next receive operations.
+   * */
+  ReceiveIterator<T, Impl> begin() {
+    return ReceiveIterator<T, Impl>(this->core_.get(), &this->buffer_);
+  }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+
+  friend Channel<T, Impl>;
+  friend detail::HandleAccess;
 
 private:
-  explicit ReceiverChannel(std::shared_ptr<ChannelCore<T>> core)
-      : core_(core) {}
-  std::shared_ptr<ChannelCore<T>> core_;
+  explicit ReceiverChannel(std::shared_ptr<Impl> core)
+      : core_(core), count_(core_) {}
+  std::shared_ptr<Impl> core_;
+  detail::HandleCount<T, false, true> count_;
+  // Objects taken by range loops, and not reached yet.
+  detail::ReceiveBuffer<T> buffer_;
 };
 
 } // namespace chx
+
+// `size()` counts the objects stored now, not the ones a loop will receive.
+template <typename T, typename Impl>
+inline constexpr bool
+    std::ranges::disable_sized_range<chx::ReceiverChannel<T, Impl>> = true;
@@ -5,9 +5,16 @@
 #include <memory>
 
 namespace chx {
-template <typename T> class SenderChannel {
+template <typename T, typename Impl> class SenderChannel {
 public:
+  using value_type = T;
+  using core_type = Impl;
+
   SenderChannel() = delete;
+  template <typename Other>
+    requires(!std::same_as<Other, Impl> && std::derived_from<Other, Impl>)
+  SenderChannel(const SenderChannel<T, Other> &other)
+      : core_(detail::HandleAccess::core(other)), count_(core_) {}
   ~SenderChannel() = default;
 
   std::expected<void, Error> send(T &&value) {
@@ -15,6 +22,12 @@ public:
   }
   std::expected<void, Error> send(const T &value) { return core_->send(value); }
 
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  std::expected<void, Error> emplace_send(Args &&...args) {
+    return detail::emplace_send<T>(*core_, std::forward<Args>(args)...);
+  }
+
   std::expected<void, Error> try_send(T &&value) {
     return core_->try_send(std::move(value));
   }
@@ -22,14 +35,115 @@ public:
     return core_->try_send(value);
   }
 
+  std::expected<void, Error> send_to(std::size_t lane, T &&value)
+    requires detail::LanedCore<Impl, T>
+  {
+    return core_->send_to(lane, std::move(value));
+  }
+  std::expected<void, Error> send_to(std::size_t lane, const T &value)
+    requires detail::LanedCore<Impl, T>
+  {
+    return core_->send_to(lane, value);
+  }
+  std::expected<void, Error> try_send_to(std::size_t lane, T &&value)
+    requires detail::LanedCore<Impl, T>
+  {
+    return core_->try_send_to(lane, std::move(value));
+  }
+  std::expected<void, Error> try_send_to(std::size_t lane, const T &value)
+    requires detail::LanedCore<Impl, T>
+  {
+    return core_->try_send_to(lane, value);
+  }
+  template <typename Rep, typename Period>
+    requires detail::LanedCore<Impl, T>
+  std::expected<void, Error>
+  send_to_for(std::size_t lane, T value,
+              const std::chrono::duration<Rep, Period> &timeout) {
+    return core_->send_to_until(lane, std::move(value),
+                                detail::deadline_after(timeout));
+  }
+  template <typename... Args>
+    requires detail::ClaimingCore<Impl, T> &&
+             std::constructible_from<T, Args &&...>
+  std::expected<SendSlot<T, Impl>, Error> claim(Args &&...args) {
+    auto value = core_->claim(no_deadline, std::forward<Args>(args)...);
+    if (!value.has_value()) {
+      return std::unexpected(value.error());
+    }
+    return SendSlot<T, Impl>(core_, *value);
+  }
+  template <typename... Args>
+    requires detail::ClaimingCore<Impl, T> &&
+             std::constructible_from<T, Args &&...>
+  std::expected<SendSlot<T, Impl>, Error> try_claim(Args &&...args) {
+    auto value = core_->try_claim(std::forward<Args>(args)...);
+    if (!value.has_value()) {
+      return std::unexpected(value.error());
+    }
+    return SendSlot<T, Impl>(core_, *value);
+  }
+
+  template <typename Rep, typename Period>
+  std::expected<void, Error>
+  send_for(T &&value, const std::chrono::duration<Rep, Period> &timeout) {
+    return core_->send_until(std::move(value), detail::deadline_after(timeout));
+  }
+  template <typename Rep, typename Period>
+  std::expected<void, Error>
+  send_for(const T &value, const std::chrono::duration<Rep, Period> &timeout) {
+    return core_->send_until(value, detail::deadline_after(timeout));
+  }
+
+  template <typename Clock, typename Duration>
+  std::expected<void, Error>
+  send_until(T &&value,
+             const std::chrono::time_point<Clock, Duration> &deadline) {
+    return core_->send_until(std::move(value), detail::to_deadline(deadline));
+  }
+  template <typename Clock, typename Duration>
+  std::expected<void, Error>
+  send_until(const T &value,
+             const std::chrono::time_point<Clock, Duration> &deadline) {
+    return core_->send_until(value, detail::to_deadline(deadline));
+  }
+
+  SendAwaitable<T> async_send(T value,
+                              Executor &executor = default_executor()) {
+    return SendAwaitable<T>(core_, std::move(value), executor);
+  }
+
+  std::expected<std::size_t, Error> send_many(std::span<T> values) {
+    return core_->send_many(values);
+  }
+  template <std::input_iterator It, std::sentinel_for<It> Sentinel>
+  std::expected<std::size_t, Error> send_many(It first, Sentinel last) {
+    return detail::send_range<T>(*core_, first, last);
+  }
+  std::expected<std::size_t, Error> try_send_many(std::span<T> values) {
+    return core_->try_send_many(values);
+  }
+
   void close() { this->core_->close(); }
+  /**
+   *  @brief Closes the channel once receivers took the objects it stores
+   *  (see `ChannelCore::close_sending`).
+   * */
+  void close_sending() { this->core_->close_sending(); }
   bool is_closed() { return this->core_->is_closed(); }
 
-  friend Channel<T>;
+  std::size_t size() const { return this->core_->size(); }
+  std::size_t capacity() const { return this->core_->capacity(); }
+  ChannelMetrics metrics() const { return this->core_->metrics(); }
+
+  friend Channel<T, Impl>;
+  friend detail::HandleAccess;
 
 private:
-  explicit SenderChannel(std::shared_ptr<ChannelCore<T>> core) : core_(core) {}
-  std::shared_ptr<chx::ChannelCore<T>> core_;
+  explicit SenderChannel(std::shared_ptr<Impl> core)
+      : core_(core), count_(core_) {}
+  std::shared_ptr<Impl> core_;
+  detail::HandleCount<T, true, false> count_;
 };
 
 } // namespace chx
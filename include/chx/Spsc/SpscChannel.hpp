@@ -0,0 +1,383 @@
+#pragma once
+
+#include "chx/Buffered/circular_queue.hpp"
+#include "chx/cache_line.hpp"
+#include "chx/channelCore.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <utility>
+
+namespace chx::spsc {
+
+/**
+ *  @brief Buffered channel for exactly one sender thread and one receiver
+ *  thread. Each side owns one index of the ring and keeps a cached copy of the
+ *  other one, so no lock is taken while the buffer is neither full nor empty.
+ *  The mutex is only used to park a side when the ring is really full (or
+ *  empty). Slots are uninitialized: objects are constructed when pushed and
+ *  destroyed when popped.
+ * */
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+class Channel final : public chx::ChannelCore<T> {
+public:
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  Channel() : chx::ChannelCore<T>() {}
+  /**
+   *  @brief Builds a channel whose waiter list is allocated from `alloc` (see
+   *  `CreateChannel`).
+   * */
+  Channel(std::allocator_arg_t, const allocator_type &alloc)
+      : chx::ChannelCore<T>(alloc.resource()) {}
+  ~Channel();
+
+  std::expected<void, Error> send(const T &value) override;
+  std::expected<void, Error> send(T &&value) override;
+  std::expected<void, Error> try_send(T &&value) override;
+  std::expected<void, Error> try_send(const T &value) override;
+
+  std::expected<T, Error> receive() override;
+  std::expected<T, Error> try_receive() override;
+
+  std::expected<void, Error> send_until(T &&value,
+                                        Deadline deadline) override;
+  std::expected<void, Error> send_until(const T &value,
+                                        Deadline deadline) override;
+  std::expected<T, Error> receive_until(Deadline deadline) override;
+
+  virtual void close() override;
+  virtual bool is_closed() const override;
+
+  std::size_t size() const override;
+  std::size_t capacity() const override { return Capacity; }
+
+  Channel<T, Capacity> &operator=(const Channel<T, Capacity> &ch) = delete;
+
+protected:
+  void disconnect_senders() override;
+
+private:
+  template <typename U>
+    requires std::constructible_from<T, U &&>
+  std::expected<void, Error> send_(U &&value, Deadline deadline);
+
+  std::expected<T, Error> receive_(Deadline deadline);
+
+  template <typename U>
+    requires std::constructible_from<T, U &&>
+  std::expected<void, Error> try_send_(U &&value);
+
+  /**
+   *  @brief Sender side only. Checks for a free slot, refreshing the cached
+   *  receiver index only when the cached one says the ring is full.
+   * */
+  bool can_push();
+
+  /**
+   *  @brief Receiver side only. Checks for a stored element, refreshing the
+   *  cached sender index only when the cached one says the ring is empty.
+   * */
+  bool can_pop();
+
+  template <typename U> void push(U &&value);
+  T pop();
+
+  /**
+   *  @returns The slot of the (unwrapped) ring index `index`. Power of two
+   *  capacities use a mask instead of a division.
+   * */
+  T *slot(std::size_t index) { return this->buffer.data() + wrap(index); }
+  static constexpr std::size_t wrap(std::size_t index) {
+    if constexpr (std::has_single_bit(Capacity)) {
+      return index & (Capacity - 1);
+    } else {
+      return index % Capacity;
+    }
+  }
+
+  /**
+   *  @brief Slow path: blocks the calling side on `cv` until `ready` holds or
+   *  `deadline` expires, and returns the last value of `ready`.
+   *  `waiting` tells the other side that it has to take the mutex to wake us.
+   *  The time spent blocked is recorded as `side`.
+   * */
+  template <typename Predicate>
+  bool park(std::condition_variable &cv, std::atomic<bool> &waiting,
+            detail::Side side, Deadline deadline, Predicate ready);
+  void wake(std::condition_variable &cv, std::atomic<bool> &waiting);
+
+  // Receiver cache line.
+  alignas(cache_line_size) std::atomic<std::size_t> head{0};
+  std::size_t cached_tail = 0;
+
+  // Sender cache line.
+  alignas(cache_line_size) std::atomic<std::size_t> tail{0};
+  std::size_t cached_head = 0;
+
+  alignas(cache_line_size) std::atomic<bool> closed{false};
+  std::atomic<bool> sender_waiting{false};
+  std::atomic<bool> receiver_waiting{false};
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+
+  alignas(cache_line_size) buffered::InlineRing<T, Capacity> buffer;
+};
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+Channel<T, Capacity>::~Channel() {
+  const std::size_t t = this->tail.load(std::memory_order_relaxed);
+  for (std::size_t h = this->head.load(std::memory_order_relaxed); h != t;
+       ++h) {
+    std::destroy_at(this->slot(h));
+  }
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+void Channel<T, Capacity>::close() {
+  this->closed.store(true, std::memory_order_release);
+  this->metrics_.closed();
+  std::lock_guard lock(this->mutex);
+  this->not_empty.notify_all();
+  this->not_full.notify_all();
+  this->notify_waiters(WaitEvent::closed);
+  return;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+bool Channel<T, Capacity>::is_closed() const {
+  return this->closed.load(std::memory_order_acquire) ||
+         (this->senders_gone() && this->size() == 0);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+void Channel<T, Capacity>::disconnect_senders() {
+  // The parked receiver checks `senders_gone` under the mutex.
+  std::lock_guard lock(this->mutex);
+  this->not_empty.notify_all();
+  this->notify_waiters(WaitEvent::closed);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::expected<void, Error> Channel<T, Capacity>::send(const T &value) {
+  return this->send_(value, no_deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::expected<void, Error> Channel<T, Capacity>::send(T &&value) {
+  return this->send_(std::move(value), no_deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::expected<void, Error> Channel<T, Capacity>::send_until(const T &value,
+                                                            Deadline deadline) {
+  return this->send_(value, deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::expected<void, Error> Channel<T, Capacity>::send_until(T &&value,
+                                                            Deadline deadline) {
+  return this->send_(std::move(value), deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::expected<T, Error> Channel<T, Capacity>::receive() {
+  return this->receive_(no_deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::expected<T, Error> Channel<T, Capacity>::receive_until(Deadline deadline) {
+  return this->receive_(deadline);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::expected<void, Error> Channel<T, Capacity>::try_send(const T &value) {
+  return this->try_send_(value);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::expected<void, Error> Channel<T, Capacity>::try_send(T &&value) {
+  return this->try_send_(std::move(value));
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::size_t Channel<T, Capacity>::size() const {
+  // The head never passes the tail, so reading it first never underflows.
+  const std::size_t h = this->head.load(std::memory_order_acquire);
+  const std::size_t t = this->tail.load(std::memory_order_acquire);
+  return std::min(t - h, Capacity);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+bool Channel<T, Capacity>::can_push() {
+  const std::size_t t = this->tail.load(std::memory_order_relaxed);
+  if (t - this->cached_head < Capacity) {
+    return true;
+  }
+  this->cached_head = this->head.load(std::memory_order_acquire);
+  return t - this->cached_head < Capacity;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+bool Channel<T, Capacity>::can_pop() {
+  const std::size_t h = this->head.load(std::memory_order_relaxed);
+  if (h != this->cached_tail) {
+    return true;
+  }
+  this->cached_tail = this->tail.load(std::memory_order_acquire);
+  return h != this->cached_tail;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+template <typename U>
+void Channel<T, Capacity>::push(U &&value) {
+  const std::size_t t = this->tail.load(std::memory_order_relaxed);
+  std::construct_at(this->slot(t), std::forward<U>(value));
+  this->tail.store(t + 1, std::memory_order_release);
+  this->record_sent(1);
+  this->wake(this->not_empty, this->receiver_waiting);
+  this->notify_waiters(WaitEvent::readable);
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+T Channel<T, Capacity>::pop() {
+  const std::size_t h = this->head.load(std::memory_order_relaxed);
+  T *slot = this->slot(h);
+  T value = std::move(*slot);
+  std::destroy_at(slot);
+  this->head.store(h + 1, std::memory_order_release);
+  this->metrics_.received(1);
+  this->wake(this->not_full, this->sender_waiting);
+  this->notify_waiters(WaitEvent::writable);
+  return value;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+template <typename Predicate>
+bool Channel<T, Capacity>::park(std::condition_variable &cv,
+                                std::atomic<bool> &waiting, detail::Side side,
+                                Deadline deadline, Predicate ready) {
+  [[maybe_unused]] auto blocked = this->metrics_.block(side);
+  std::unique_lock lock(this->mutex);
+  waiting.store(true, std::memory_order_relaxed);
+  // Pairs with the fence in `wake`: either the other side sees `waiting`, or
+  // we see the index it has just published.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const bool result = detail::wait_until(cv, lock, deadline, ready);
+  waiting.store(false, std::memory_order_relaxed);
+  return result;
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+void Channel<T, Capacity>::wake(std::condition_variable &cv,
+                                std::atomic<bool> &waiting) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!waiting.load(std::memory_order_relaxed)) {
+    return;
+  }
+  std::lock_guard lock(this->mutex);
+  cv.notify_one();
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+template <typename U>
+  requires std::constructible_from<T, U &&>
+std::expected<void, Error> Channel<T, Capacity>::send_(U &&value,
+                                                       Deadline deadline) {
+  if (!this->can_push()) {
+    if (!this->park(this->not_full, this->sender_waiting, detail::Side::send,
+                    deadline, [&] {
+                      return this->can_push() ||
+                             this->closed.load(std::memory_order_acquire);
+                    })) {
+      return std::unexpected(Error::timeout);
+    }
+  }
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  this->push(std::forward<U>(value));
+  return {};
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+template <typename U>
+  requires std::constructible_from<T, U &&>
+std::expected<void, Error> Channel<T, Capacity>::try_send_(U &&value) {
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  if (!this->can_push()) {
+    this->metrics_.try_failed(detail::Side::send);
+    return std::unexpected(Error::would_block);
+  }
+  this->push(std::forward<U>(value));
+  return {};
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::expected<T, Error> Channel<T, Capacity>::receive_(Deadline deadline) {
+  if (!this->can_pop()) {
+    if (!this->park(this->not_empty, this->receiver_waiting,
+                    detail::Side::receive, deadline, [&] {
+                      return this->can_pop() ||
+                             this->closed.load(std::memory_order_acquire) ||
+                             this->senders_gone();
+                    })) {
+      return std::unexpected(Error::timeout);
+    }
+  }
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  if (!this->can_pop()) {
+    // Woken up because the sender is gone, and the ring is drained.
+    return std::unexpected(Error::closed);
+  }
+  return this->pop();
+}
+
+template <typename T, std::size_t Capacity>
+  requires(Capacity > 0)
+std::expected<T, Error> Channel<T, Capacity>::try_receive() {
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  if (!this->can_pop()) {
+    if (this->senders_gone() && !this->can_pop()) {
+      return std::unexpected(Error::closed);
+    }
+    this->metrics_.try_failed(detail::Side::receive);
+    return std::unexpected(Error::would_block);
+  }
+  return this->pop();
+}
+} // namespace chx::spsc
@@ -0,0 +1,508 @@
+#pragma once
+
+#include "chx/backoff.hpp"
+#include "chx/cache_line.hpp"
+#include "chx/channelCore.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace chx::unbounded {
+
+/**
+ *  @brief Channel without capacity limit: `send` never blocks. Elements are
+ *  stored in a linked list of fixed size segments that grows with the
+ *  backlog. Senders and receivers claim slots with a CAS on their own cursor,
+ *  so neither of them takes a lock while the channel has elements; the mutex
+ *  is only used to park receivers when it is empty.
+ *
+ *  Spent segments are kept in a pool and reused, so in steady state the
+ *  channel does not allocate at all. The segments come from the memory
+ *  resource of its allocator.
+ * */
+template <typename T> class Channel final : public chx::ChannelCore<T> {
+public:
+  /// Number of elements stored in each segment.
+  static constexpr std::size_t segment_size = 31;
+
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  Channel() : Channel(std::allocator_arg, allocator_type()) {}
+
+  /**
+   *  @brief Builds a channel whose segments and waiter list are allocated
+   *  from `alloc` (see `CreateChannel`).
+   * */
+  Channel(std::allocator_arg_t, const allocator_type &alloc);
+  ~Channel();
+
+  std::expected<void, Error> send(const T &value) override;
+  std::expected<void, Error> send(T &&value) override;
+  std::expected<void, Error> try_send(T &&value) override;
+  std::expected<void, Error> try_send(const T &value) override;
+
+  std::expected<T, Error> receive() override;
+  std::expected<T, Error> try_receive() override;
+
+  std::expected<void, Error> send_until(T &&value,
+                                        Deadline deadline) override;
+  std::expected<void, Error> send_until(const T &value,
+                                        Deadline deadline) override;
+  std::expected<T, Error> receive_until(Deadline deadline) override;
+
+  virtual void close() override;
+  virtual bool is_closed() const override;
+
+  std::size_t size() const override;
+
+  /// The channel has no capacity limit.
+  std::size_t capacity() const override {
+    return std::numeric_limits<std::size_t>::max();
+  }
+
+  Channel<T> &operator=(const Channel<T> &ch) = delete;
+
+  /**
+   *  @returns The number of segments allocated so far (in use or pooled).
+   * */
+  std::size_t segments_allocated() const {
+    return this->allocated.load(std::memory_order_relaxed);
+  }
+
+protected:
+  void disconnect_senders() override;
+
+private:
+  // Cursors count positions shifted by `shift`. A position is `lap` wide per
+  // segment: offsets [0, segment_size) are slots, and offset `segment_size`
+  // means that the next segment is being installed.
+  static constexpr std::size_t lap = segment_size + 1;
+  static constexpr std::size_t shift = 1;
+  // Set in the head cursor when the head segment is not the tail one.
+  static constexpr std::size_t has_next = 1;
+
+  // Slot states.
+  static constexpr unsigned slot_written = 1;
+  static constexpr unsigned slot_read = 2;
+  static constexpr unsigned slot_destroy = 4;
+
+  struct Slot {
+    std::atomic<unsigned> state{0};
+    alignas(T) std::byte storage[sizeof(T)];
+
+    T *value() { return reinterpret_cast<T *>(this->storage); }
+  };
+
+  struct Segment {
+    std::atomic<Segment *> next{nullptr};
+    std::array<Slot, segment_size> slots;
+    Segment *next_free = nullptr;
+
+    /**
+     *  @brief Waits until the sender that filled the last slot installs the
+     *  next segment.
+     * */
+    Segment *wait_next();
+  };
+
+  template <typename U>
+    requires std::constructible_from<T, U &&>
+  std::expected<void, Error> send_(U &&value);
+
+  std::expected<T, Error> receive_(Deadline deadline);
+
+  template <typename U> void push(U &&value);
+  std::optional<T> pop();
+  bool has_value() const;
+
+  /**
+   *  @returns True if the last sender was dropped and everything it sent was
+   *  received: receivers get `Error::closed` from then on.
+   * */
+  bool drained() const { return this->senders_gone() && !this->has_value(); }
+
+  /**
+   *  @brief Hands the segment back to the pool once the slots from `start` on
+   *  were read. If one of them is still being read, its reader finishes the
+   *  job instead.
+   * */
+  void release(Segment *segment, std::size_t start);
+
+  Segment *acquire_segment();
+  void recycle(Segment *segment);
+
+  void wake();
+
+  alignas(cache_line_size) std::atomic<std::size_t> head_index{0};
+  std::atomic<Segment *> head_segment;
+
+  alignas(cache_line_size) std::atomic<std::size_t> tail_index{0};
+  std::atomic<Segment *> tail_segment;
+
+  alignas(cache_line_size) std::atomic<bool> closed{false};
+  std::atomic<std::size_t> receivers_waiting{0};
+  std::mutex mutex;
+  std::condition_variable not_empty;
+
+  std::mutex pool_mutex;
+  allocator_type allocator;
+  Segment *free_segments = nullptr;
+  std::atomic<std::size_t> allocated{0};
+};
+
+template <typename T>
+typename Channel<T>::Segment *Channel<T>::Segment::wait_next() {
+  detail::Backoff backoff;
+  for (;;) {
+    if (Segment *segment = this->next.load(std::memory_order_acquire)) {
+      return segment;
+    }
+    backoff.snooze();
+  }
+}
+
+template <typename T>
+Channel<T>::Channel(std::allocator_arg_t, const allocator_type &alloc)
+    : chx::ChannelCore<T>(alloc.resource()), allocator(alloc) {
+  Segment *first = this->acquire_segment();
+  this->head_segment.store(first, std::memory_order_relaxed);
+  this->tail_segment.store(first, std::memory_order_relaxed);
+}
+
+template <typename T> Channel<T>::~Channel() {
+  std::size_t head = this->head_index.load(std::memory_order_relaxed) &
+                     ~has_next;
+  const std::size_t tail = this->tail_index.load(std::memory_order_relaxed);
+  Segment *segment = this->head_segment.load(std::memory_order_relaxed);
+  while (head != tail) {
+    const std::size_t offset = (head >> shift) % lap;
+    if (offset < segment_size) {
+      std::destroy_at(segment->slots[offset].value());
+    } else {
+      Segment *next = segment->next.load(std::memory_order_relaxed);
+      this->allocator.delete_object(segment);
+      segment = next;
+    }
+    head += std::size_t{1} << shift;
+  }
+  this->allocator.delete_object(segment);
+  while (this->free_segments != nullptr) {
+    Segment *next = this->free_segments->next_free;
+    this->allocator.delete_object(this->free_segments);
+    this->free_segments = next;
+  }
+}
+
+template <typename T>
+typename Channel<T>::Segment *Channel<T>::acquire_segment() {
+  {
+    std::lock_guard lock(this->pool_mutex);
+    if (Segment *segment = this->free_segments) {
+      this->free_segments = segment->next_free;
+      return segment;
+    }
+  }
+  this->allocated.fetch_add(1, std::memory_order_relaxed);
+  return this->allocator.template new_object<Segment>();
+}
+
+template <typename T> void Channel<T>::recycle(Segment *segment) {
+  segment->next.store(nullptr, std::memory_order_relaxed);
+  for (Slot &slot : segment->slots) {
+    slot.state.store(0, std::memory_order_relaxed);
+  }
+  std::lock_guard lock(this->pool_mutex);
+  segment->next_free = this->free_segments;
+  this->free_segments = segment;
+}
+
+template <typename T>
+void Channel<T>::release(Segment *segment, std::size_t start) {
+  // The last slot is never marked: its reader is the one that calls
+  // `release(segment, 0)`.
+  for (std::size_t i = start; i < segment_size - 1; i++) {
+    Slot &slot = segment->slots[i];
+    if ((slot.state.load(std::memory_order_acquire) & slot_read) != 0) {
+      continue;
+    }
+    const unsigned state =
+        slot.state.fetch_or(slot_destroy, std::memory_order_acq_rel);
+    if ((state & slot_read) == 0) {
+      return;
+    }
+  }
+  this->recycle(segment);
+}
+
+template <typename T>
+template <typename U>
+void Channel<T>::push(U &&value) {
+  detail::Backoff backoff;
+  std::size_t tail = this->tail_index.load(std::memory_order_acquire);
+  Segment *segment = this->tail_segment.load(std::memory_order_acquire);
+  Segment *next_segment = nullptr;
+  for (;;) {
+    const std::size_t offset = (tail >> shift) % lap;
+    if (offset == segment_size) {
+      // Another sender is installing the next segment.
+      backoff.snooze();
+      tail = this->tail_index.load(std::memory_order_acquire);
+      segment = this->tail_segment.load(std::memory_order_acquire);
+      continue;
+    }
+    // Get the next segment ready before claiming the last slot, so the
+    // others only wait for a couple of stores.
+    if (offset + 1 == segment_size && next_segment == nullptr) {
+      next_segment = this->acquire_segment();
+    }
+    const std::size_t new_tail = tail + (std::size_t{1} << shift);
+    if (this->tail_index.compare_exchange_weak(tail, new_tail,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_acquire)) {
+      if (offset + 1 == segment_size) {
+        this->tail_segment.store(next_segment, std::memory_order_release);
+        this->tail_index.store(new_tail + (std::size_t{1} << shift),
+                               std::memory_order_release);
+        segment->next.store(next_segment, std::memory_order_release);
+        next_segment = nullptr;
+      }
+      Slot &slot = segment->slots[offset];
+      std::construct_at(slot.value(), std::forward<U>(value));
+      slot.state.fetch_or(slot_written, std::memory_order_release);
+      break;
+    }
+    segment = this->tail_segment.load(std::memory_order_acquire);
+    backoff.spin();
+  }
+  if (next_segment != nullptr) {
+    this->recycle(next_segment);
+  }
+  this->record_sent(1);
+  this->wake();
+  this->notify_waiters(WaitEvent::readable);
+}
+
+template <typename T> std::optional<T> Channel<T>::pop() {
+  detail::Backoff backoff;
+  std::size_t head = this->head_index.load(std::memory_order_acquire);
+  Segment *segment = this->head_segment.load(std::memory_order_acquire);
+  for (;;) {
+    const std::size_t offset = (head >> shift) % lap;
+    if (offset == segment_size) {
+      // Another receiver is moving to the next segment.
+      backoff.snooze();
+      head = this->head_index.load(std::memory_order_acquire);
+      segment = this->head_segment.load(std::memory_order_acquire);
+      continue;
+    }
+    std::size_t new_head = head + (std::size_t{1} << shift);
+    if ((new_head & has_next) == 0) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const std::size_t tail = this->tail_index.load(std::memory_order_relaxed);
+      if (head >> shift == tail >> shift) {
+        return std::nullopt;
+      }
+      if ((head >> shift) / lap != (tail >> shift) / lap) {
+        new_head |= has_next;
+      }
+    }
+    if (this->head_index.compare_exchange_weak(head, new_head,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_acquire)) {
+      if (offset + 1 == segment_size) {
+        Segment *next = segment->wait_next();
+        std::size_t next_index =
+            (new_head & ~has_next) + (std::size_t{1} << shift);
+        if (next->next.load(std::memory_order_relaxed) != nullptr) {
+          next_index |= has_next;
+        }
+        this->head_segment.store(next, std::memory_order_release);
+        this->head_index.store(next_index, std::memory_order_release);
+      }
+      Slot &slot = segment->slots[offset];
+      detail::Backoff wait_write;
+      while ((slot.state.load(std::memory_order_acquire) & slot_written) ==
+             0) {
+        wait_write.snooze();
+      }
+      std::optional<T> value(std::move(*slot.value()));
+      std::destroy_at(slot.value());
+      this->metrics_.received(1);
+      if (offset + 1 == segment_size) {
+        this->release(segment, 0);
+      } else if (slot.state.fetch_or(slot_read, std::memory_order_acq_rel) &
+                 slot_destroy) {
+        this->release(segment, offset + 1);
+      }
+      return value;
+    }
+    segment = this->head_segment.load(std::memory_order_acquire);
+    backoff.spin();
+  }
+}
+
+template <typename T> std::size_t Channel<T>::size() const {
+  constexpr std::size_t step = std::size_t{1} << shift;
+  for (;;) {
+    std::size_t tail = this->tail_index.load(std::memory_order_seq_cst);
+    std::size_t head = this->head_index.load(std::memory_order_seq_cst);
+    // Retry until both cursors are read while the tail stays put.
+    if (this->tail_index.load(std::memory_order_seq_cst) != tail) {
+      continue;
+    }
+    tail &= ~(step - 1);
+    head &= ~(step - 1);
+    // A cursor at the end of a segment is about to move to the next one.
+    if ((tail >> shift) % lap == segment_size) {
+      tail += step;
+    }
+    if ((head >> shift) % lap == segment_size) {
+      head += step;
+    }
+    // Rotate both cursors so the head falls into the first segment; every
+    // segment the tail is ahead of it then has one position that is no slot.
+    const std::size_t rotation = ((head >> shift) / lap) * lap;
+    tail = (tail >> shift) - rotation;
+    head = (head >> shift) - rotation;
+    return tail - head - tail / lap;
+  }
+}
+
+template <typename T> bool Channel<T>::has_value() const {
+  const std::size_t head = this->head_index.load(std::memory_order_acquire);
+  const std::size_t tail = this->tail_index.load(std::memory_order_acquire);
+  return head >> shift != tail >> shift;
+}
+
+template <typename T> void Channel<T>::wake() {
+  // Pairs with the fence taken by a receiver before it parks.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->receivers_waiting.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  std::lock_guard lock(this->mutex);
+  this->not_empty.notify_one();
+}
+
+template <typename T> void Channel<T>::close() {
+  this->closed.store(true, std::memory_order_release);
+  this->metrics_.closed();
+  std::lock_guard lock(this->mutex);
+  this->not_empty.notify_all();
+  this->notify_waiters(WaitEvent::closed);
+  return;
+}
+
+template <typename T> bool Channel<T>::is_closed() const {
+  return this->closed.load(std::memory_order_acquire) || this->drained();
+}
+
+template <typename T> void Channel<T>::disconnect_senders() {
+  // Parked receivers check `senders_gone` under the mutex.
+  std::lock_guard lock(this->mutex);
+  this->not_empty.notify_all();
+  this->notify_waiters(WaitEvent::closed);
+}
+
+template <typename T>
+template <typename U>
+  requires std::constructible_from<T, U &&>
+std::expected<void, Error> Channel<T>::send_(U &&value) {
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  this->push(std::forward<U>(value));
+  return {};
+}
+
+template <typename T>
+std::expected<void, Error> Channel<T>::send(const T &value) {
+  return this->send_(value);
+}
+
+template <typename T> std::expected<void, Error> Channel<T>::send(T &&value) {
+  return this->send_(std::move(value));
+}
+
+template <typename T>
+std::expected<void, Error> Channel<T>::try_send(const T &value) {
+  return this->send_(value);
+}
+
+template <typename T>
+std::expected<void, Error> Channel<T>::try_send(T &&value) {
+  return this->send_(std::move(value));
+}
+
+template <typename T>
+std::expected<void, Error> Channel<T>::send_until(const T &value, Deadline) {
+  return this->send_(value);
+}
+
+template <typename T>
+std::expected<void, Error> Channel<T>::send_until(T &&value, Deadline) {
+  return this->send_(std::move(value));
+}
+
+template <typename T> std::expected<T, Error> Channel<T>::receive() {
+  return this->receive_(no_deadline);
+}
+
+template <typename T>
+std::expected<T, Error> Channel<T>::receive_until(Deadline deadline) {
+  return this->receive_(deadline);
+}
+
+template <typename T>
+std::expected<T, Error> Channel<T>::receive_(Deadline deadline) {
+  for (;;) {
+    if (this->closed.load(std::memory_order_acquire)) {
+      return std::unexpected(Error::closed);
+    }
+    if (auto value = this->pop()) {
+      return std::move(*value);
+    }
+    if (this->drained()) {
+      return std::unexpected(Error::closed);
+    }
+    [[maybe_unused]] auto blocked =
+        this->metrics_.block(detail::Side::receive);
+    std::unique_lock lock(this->mutex);
+    this->receivers_waiting.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence in `wake`: either the sender sees our counter, or
+    // we see the cursor it has just moved.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const bool ready =
+        detail::wait_until(this->not_empty, lock, deadline, [&] {
+          return this->has_value() ||
+                 this->closed.load(std::memory_order_acquire) ||
+                 this->senders_gone();
+        });
+    this->receivers_waiting.fetch_sub(1, std::memory_order_relaxed);
+    if (!ready) {
+      return std::unexpected(Error::timeout);
+    }
+  }
+}
+
+template <typename T> std::expected<T, Error> Channel<T>::try_receive() {
+  if (this->closed.load(std::memory_order_acquire)) {
+    return std::unexpected(Error::closed);
+  }
+  if (auto value = this->pop()) {
+    return std::move(*value);
+  }
+  if (this->drained()) {
+    return std::unexpected(Error::closed);
+  }
+  this->metrics_.try_failed(detail::Side::receive);
+  return std::unexpected(Error::would_block);
+}
+} // namespace chx::unbounded
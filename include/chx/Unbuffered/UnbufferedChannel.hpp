@@ -1,17 +1,39 @@
 #pragma once
 
 #include "chx/channelCore.hpp"
-#include <condition_variable>
+#include "chx/wait_node.hpp"
+#include "chx/wait_strategy.hpp"
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <optional>
 #include <utility>
 
 namespace chx::unbuffered {
-template <typename T> class Channel : public chx::ChannelCore<T> {
+/**
+ *  @brief Channel without buffer: a sender blocks until a receiver takes its
+ *  value. `Wait` chooses how blocked threads wait (see `chx::wait`).
+ *
+ *  Every blocked sender (or receiver) queues a node of its own, which holds
+ *  the value being transferred. Its counterpart moves the value straight
+ *  from (or into) that node and wakes only that thread, so there is no
+ *  shared slot and any number of pairs can meet back to back. Suspended
+ *  coroutines and `select` cases queue nodes in the same queues, so they
+ *  meet threads, coroutines and other `select` calls alike.
+ * */
+template <typename T, typename Wait = wait::Blocking>
+class Channel final : public chx::ChannelCore<T> {
 public:
-  Channel()
-      : chx::ChannelCore<T>(), value_set(false), closed(false),
-        receivers_waiting(0) {}
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  Channel() : chx::ChannelCore<T>() {}
+  /**
+   *  @brief Builds a channel whose waiter list is allocated from `alloc` (see
+   *  `CreateChannel`).
+   * */
+  Channel(std::allocator_arg_t, const allocator_type &alloc)
+      : chx::ChannelCore<T>(alloc.resource()) {}
   ~Channel() = default;
 
   std::expected<void, Error> send(const T &value) override;
@@ -22,135 +44,313 @@ public:
   std::expected<T, Error> receive() override;
   std::expected<T, Error> try_receive() override;
 
+  std::expected<void, Error> send_until(T &&value,
+                                        Deadline deadline) override;
+  std::expected<void, Error> send_until(const T &value,
+                                        Deadline deadline) override;
+  std::expected<T, Error> receive_until(Deadline deadline) override;
+
+  detail::AsyncStart start_async_send(detail::WaitNode<T> &node) override;
+  detail::AsyncStart start_async_receive(detail::WaitNode<T> &node) override;
+  detail::SelectStart start_select(detail::Side side,
+                                   detail::WaitNode<T> &node) override;
+  void cancel_async(detail::Side side, detail::WaitNode<T> &node) override;
+
   virtual void close() override;
   virtual bool is_closed() const override;
 
-  Channel<T> &operator=(const Channel<T> &ch) = delete;
+  /// Values are never stored: they go straight from sender to receiver.
+  std::size_t size() const override { return 0; }
+  std::size_t capacity() const override { return 0; }
+
+  Channel &operator=(const Channel &ch) = delete;
 
 private:
+  using NodeState = detail::NodeState;
+  using NodeQueue = detail::NodeQueue<T>;
+
+  /**
+   *  @brief A blocked thread.
+   * */
+  struct Node final : detail::WaitNode<T> {
+    typename Wait::Condition ready;
+
+    void wake() override { this->ready.notify_one(); }
+  };
+
   template <typename U>
     requires std::constructible_from<T, U &&>
-  std::expected<void, Error> send_(U &&value);
+  std::expected<void, Error> send_(U &&value, Deadline deadline);
 
   template <typename U>
     requires std::constructible_from<T, U &&>
   std::expected<void, Error> try_send_(U &&value);
 
+  std::expected<T, Error> receive_(Deadline deadline);
+
+  /**
+   *  @brief Moves `value` into the first waiting receiver and wakes it up.
+   *  Must be called with the mutex held.
+   *  @returns False if there is no blocked receiver.
+   * */
+  template <typename U> bool hand_over(U &&value);
+
+  /**
+   *  @brief Takes the value of the first waiting sender and wakes it up. Must
+   *  be called with the mutex held.
+   * */
+  std::optional<T> take_over();
+
+  /**
+   *  @brief Queues `self` in `queue` and waits for a counterpart to complete
+   *  it. If `deadline` expires first, `self` leaves the queue. The time spent
+   *  blocked is recorded as `side`.
+   * */
+  std::expected<void, Error> park(std::unique_lock<std::mutex> &lock,
+                                  NodeQueue &queue, Node &self,
+                                  detail::Side side, Deadline deadline);
+
   mutable std::mutex mutex;
-  std::condition_variable sender_entrance;
-  std::condition_variable sender_exit;
-  std::condition_variable receiver_entrance;
-  bool value_set = false;
-  std::optional<T> slot;
+  NodeQueue senders;
+  NodeQueue receivers;
   bool closed = false;
-  unsigned int receivers_waiting = 0;
 };
 
-template <typename T> void Channel<T>::close() {
+template <typename T, typename Wait> void Channel<T, Wait>::close() {
   std::lock_guard lock(this->mutex);
   this->closed = true;
-  this->receiver_entrance.notify_all();
-  this->sender_entrance.notify_all();
+  this->metrics_.closed();
+  this->senders.complete_all(NodeState::closed);
+  this->receivers.complete_all(NodeState::closed);
+  this->notify_waiters(WaitEvent::closed);
   return;
 }
 
-template <typename T> bool Channel<T>::is_closed() const {
+template <typename T, typename Wait> bool Channel<T, Wait>::is_closed() const {
   std::lock_guard lock(this->mutex);
   return this->closed == true;
 }
 
-template <typename T>
-std::expected<void, Error> Channel<T>::send(const T &value) {
-  return this->send_(value);
+template <typename T, typename Wait>
+std::expected<void, Error> Channel<T, Wait>::send(const T &value) {
+  return this->send_(value, no_deadline);
+}
+
+template <typename T, typename Wait>
+std::expected<void, Error> Channel<T, Wait>::send(T &&value) {
+  return this->send_(std::move(value), no_deadline);
+}
+
+template <typename T, typename Wait>
+std::expected<void, Error> Channel<T, Wait>::send_until(const T &value,
+                                                        Deadline deadline) {
+  return this->send_(value, deadline);
 }
 
-template <typename T> std::expected<void, Error> Channel<T>::send(T &&value) {
-  return this->send_(std::move(value));
+template <typename T, typename Wait>
+std::expected<void, Error> Channel<T, Wait>::send_until(T &&value,
+                                                        Deadline deadline) {
+  return this->send_(std::move(value), deadline);
 }
 
-template <typename T>
-std::expected<void, Error> Channel<T>::try_send(const T &value) {
+template <typename T, typename Wait>
+std::expected<void, Error> Channel<T, Wait>::try_send(const T &value) {
   return this->try_send_(value);
 }
 
-template <typename T>
-std::expected<void, Error> Channel<T>::try_send(T &&value) {
+template <typename T, typename Wait>
+std::expected<void, Error> Channel<T, Wait>::try_send(T &&value) {
   return this->try_send_(std::move(value));
 }
 
-template <typename T>
+template <typename T, typename Wait>
 template <typename U>
-  requires std::constructible_from<T, U &&>
-std::expected<void, Error> Channel<T>::send_(U &&value) {
-  std::unique_lock lock(this->mutex);
-  this->sender_entrance.wait(lock,
-                             [&] { return !this->value_set || this->closed; });
-  if (this->closed) {
-    return std::unexpected("channel closed");
+bool Channel<T, Wait>::hand_over(U &&value) {
+  detail::WaitNode<T> *receiver = this->receivers.pop_claimed();
+  if (receiver == nullptr) {
+    return false;
   }
-  this->slot.emplace(std::forward<U>(value));
-  this->value_set = true;
-  this->receiver_entrance.notify_one();
+  receiver->value.emplace(std::forward<U>(value));
+  receiver->state = NodeState::done;
+  this->metrics_.received(1);
+  receiver->wake();
+  return true;
+}
 
-  this->sender_exit.wait(lock);
-  this->sender_entrance.notify_one();
+template <typename T, typename Wait>
+std::optional<T> Channel<T, Wait>::take_over() {
+  detail::WaitNode<T> *sender = this->senders.pop_claimed();
+  if (sender == nullptr) {
+    return std::nullopt;
+  }
+  std::optional<T> value(std::move(*sender->value));
+  sender->state = NodeState::done;
+  this->record_sent(1);
+  sender->wake();
+  return value;
+}
 
-  return {};
+template <typename T, typename Wait>
+std::expected<void, Error>
+Channel<T, Wait>::park(std::unique_lock<std::mutex> &lock, NodeQueue &queue,
+                       Node &self, detail::Side side, Deadline deadline) {
+  [[maybe_unused]] auto blocked = this->metrics_.block(side);
+  queue.push_back(&self);
+  self.ready.wait_until(lock, deadline,
+                        [&] { return self.state != NodeState::waiting; });
+  switch (self.state) {
+  case NodeState::done:
+    return {};
+  case NodeState::closed:
+    return std::unexpected(Error::closed);
+  case NodeState::waiting:
+  case NodeState::dropped: // Only `select` cases are dropped.
+    break;
+  }
+  // Nobody completed the node: it is still queued, so withdraw it.
+  queue.remove(&self);
+  return std::unexpected(Error::timeout);
 }
 
-template <typename T>
+template <typename T, typename Wait>
 template <typename U>
   requires std::constructible_from<T, U &&>
-std::expected<void, Error> Channel<T>::try_send_(U &&value) {
+std::expected<void, Error> Channel<T, Wait>::send_(U &&value,
+                                                 Deadline deadline) {
   std::unique_lock lock(this->mutex);
-  if (this->value_set) {
-    return std::unexpected("cannot send instantly");
-  }
   if (this->closed) {
-    return std::unexpected("channel closed");
+    return std::unexpected(Error::closed);
   }
-  if (this->receivers_waiting == 0) {
-    return std::unexpected("cannot send instantly");
+  if (this->hand_over(std::forward<U>(value))) {
+    this->record_sent(1);
+    return {};
   }
-  this->slot.emplace(std::forward<U>(value));
-  this->value_set = true;
-  this->receiver_entrance.notify_one();
+  Node self;
+  self.value.emplace(std::forward<U>(value));
+  this->notify_waiters(WaitEvent::readable);
+  // The receiver that takes the value records it as sent.
+  return this->park(lock, this->senders, self, detail::Side::send, deadline);
+}
 
-  this->sender_exit.wait(lock);
-  this->sender_entrance.notify_one();
+template <typename T, typename Wait>
+template <typename U>
+  requires std::constructible_from<T, U &&>
+std::expected<void, Error> Channel<T, Wait>::try_send_(U &&value) {
+  std::unique_lock lock(this->mutex);
+  if (this->closed) {
+    return std::unexpected(Error::closed);
+  }
+  if (!this->hand_over(std::forward<U>(value))) {
+    this->metrics_.try_failed(detail::Side::send);
+    return std::unexpected(Error::would_block);
+  }
+  this->record_sent(1);
   return {};
 }
 
-template <typename T> std::expected<T, Error> Channel<T>::receive() {
-  std::unique_lock lk(this->mutex);
-  this->receivers_waiting++;
-  this->receiver_entrance.wait(lk,
-                               [&] { return this->value_set || this->closed; });
-  this->receivers_waiting--;
-  if (this->closed && !this->value_set) {
-    return std::unexpected("channel closed");
+template <typename T, typename Wait>
+std::expected<T, Error> Channel<T, Wait>::receive() {
+  return this->receive_(no_deadline);
+}
+
+template <typename T, typename Wait>
+std::expected<T, Error> Channel<T, Wait>::receive_until(Deadline deadline) {
+  return this->receive_(deadline);
+}
+
+template <typename T, typename Wait>
+std::expected<T, Error> Channel<T, Wait>::receive_(Deadline deadline) {
+  std::unique_lock lock(this->mutex);
+  if (this->closed) {
+    return std::unexpected(Error::closed);
+  }
+  if (auto value = this->take_over()) {
+    this->metrics_.received(1);
+    return std::move(*value);
+  }
+  Node self;
+  this->notify_waiters(WaitEvent::writable);
+  auto result =
+      this->park(lock, this->receivers, self, detail::Side::receive, deadline);
+  if (!result.has_value()) {
+    return std::unexpected(result.error());
+  }
+  // The sender that handed the value over recorded it as received.
+  return std::move(*self.value);
+}
+
+template <typename T, typename Wait>
+std::expected<T, Error> Channel<T, Wait>::try_receive() {
+  std::unique_lock lock(this->mutex);
+  if (this->closed) {
+    return std::unexpected(Error::closed);
+  }
+  if (auto value = this->take_over()) {
+    this->metrics_.received(1);
+    return std::move(*value);
   }
+  this->metrics_.try_failed(detail::Side::receive);
+  return std::unexpected(Error::would_block);
+}
 
-  T value_read = std::move(*this->slot);
-  this->slot.reset();
-  this->value_set = false;
-  this->sender_exit.notify_one();
-  return value_read;
+template <typename T, typename Wait>
+detail::AsyncStart
+Channel<T, Wait>::start_async_send(detail::WaitNode<T> &node) {
+  std::unique_lock lock(this->mutex);
+  if (this->closed) {
+    node.state = NodeState::closed;
+    return detail::AsyncStart::done;
+  }
+  if (this->hand_over(std::move(*node.value))) {
+    this->record_sent(1);
+    node.state = NodeState::done;
+    return detail::AsyncStart::done;
+  }
+  this->senders.push_back(&node);
+  this->notify_waiters(WaitEvent::readable);
+  return detail::AsyncStart::queued;
 }
 
-template <typename T> std::expected<T, Error> Channel<T>::try_receive() {
+template <typename T, typename Wait>
+detail::AsyncStart
+Channel<T, Wait>::start_async_receive(detail::WaitNode<T> &node) {
   std::unique_lock lock(this->mutex);
   if (this->closed) {
-    return std::unexpected("channel closed");
+    node.state = NodeState::closed;
+    return detail::AsyncStart::done;
   }
-  if (!this->value_set) {
-    return std::unexpected("cannot receive instantly");
+  if (auto value = this->take_over()) {
+    this->metrics_.received(1);
+    node.value.emplace(std::move(*value));
+    node.state = NodeState::done;
+    return detail::AsyncStart::done;
   }
+  this->receivers.push_back(&node);
+  this->notify_waiters(WaitEvent::writable);
+  return detail::AsyncStart::queued;
+}
 
-  T value_read = std::move(this->slot.value());
-  this->slot.reset();
-  this->value_set = false;
-  this->sender_exit.notify_one();
-  return value_read;
+template <typename T, typename Wait>
+detail::SelectStart Channel<T, Wait>::start_select(detail::Side side,
+                                                   detail::WaitNode<T> &node) {
+  std::unique_lock lock(this->mutex);
+  const bool send = side == detail::Side::send;
+  if (this->closed ||
+      (send ? this->receivers : this->senders).has_counterpart(node.group)) {
+    return detail::SelectStart::ready;
+  }
+  (send ? this->senders : this->receivers).push_back(&node);
+  this->notify_waiters(send ? WaitEvent::readable : WaitEvent::writable);
+  return detail::SelectStart::queued;
+}
+
+template <typename T, typename Wait>
+void Channel<T, Wait>::cancel_async(detail::Side side,
+                                    detail::WaitNode<T> &node) {
+  std::unique_lock lock(this->mutex);
+  if (node.state == NodeState::waiting) {
+    (side == detail::Side::send ? this->senders : this->receivers)
+        .remove(&node);
+  }
 }
 } // namespace chx::unbuffered
@@ -0,0 +1,338 @@
+#pragma once
+
+#include "chx/channelCore.hpp"
+#include "chx/executor.hpp"
+#include "chx/wait_node.hpp"
+#include "chx/waiter.hpp"
+#include <atomic>
+#include <coroutine>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace chx {
+
+namespace detail {
+
+/**
+ *  @brief Node of a coroutine suspended in the queue of a channel core. The
+ *  counterpart that completes it resumes the coroutine on the executor.
+ * */
+template <typename T> class AsyncNode final : public WaitNode<T> {
+public:
+  explicit AsyncNode(Executor &executor) : executor_(executor) {}
+
+  void wake() override {
+    std::coroutine_handle<> handle = this->handle;
+    this->executor_.post([handle] { handle.resume(); });
+  }
+
+  std::coroutine_handle<> handle;
+
+private:
+  Executor &executor_;
+};
+
+class AsyncWaiter;
+
+/**
+ *  @brief Waiter that drives a suspended channel operation on the cores that
+ *  do not queue coroutines (see `ChannelCore::start_async_send`). When its
+ *  channel notifies it, it posts a retry of the operation to its executor,
+ *  and the retry resumes the coroutine once the operation is done. Only one
+ *  retry is in flight at a time; notifications arriving meanwhile make it try
+ *  again.
+ *
+ *  It is shared with the retries it posts, so it outlives the awaitable: once
+ *  the awaitable is cancelled, pending retries do nothing.
+ * */
+class AsyncRetry final : public Waiter,
+                         public std::enable_shared_from_this<AsyncRetry> {
+public:
+  AsyncRetry(AsyncWaiter &operation, Executor &executor,
+             std::coroutine_handle<> handle)
+      : operation_(&operation), executor_(executor), handle_(handle) {}
+
+  void notify(WaitEvent) override {
+    const unsigned previous =
+        this->state_.fetch_or(running | pending, std::memory_order_acq_rel);
+    if ((previous & running) == 0) {
+      this->executor_.post([retry = this->shared_from_this()] {
+        if (retry->drive()) {
+          retry->handle_.resume();
+        }
+      });
+    }
+  }
+
+  /**
+   *  @brief Attempts the operation until it is done, or until it would block
+   *  and no notification arrived meanwhile. In the latter case the retry goes
+   *  idle, and the awaitable must not be touched anymore: another thread may
+   *  resume (and destroy) the coroutine right away.
+   *  @returns True if the operation is done.
+   * */
+  bool drive();
+
+  /**
+   *  @brief Detaches the retry from its awaitable, waiting for the attempt in
+   *  flight (if any) to finish. No attempt starts afterwards.
+   * */
+  void cancel() {
+    std::lock_guard lock(this->mutex_);
+    this->operation_ = nullptr;
+  }
+
+private:
+  static constexpr unsigned idle = 0;
+  static constexpr unsigned running = 1 << 0;
+  static constexpr unsigned pending = 1 << 1;
+
+  std::mutex mutex_;
+  AsyncWaiter *operation_;
+  Executor &executor_;
+  std::coroutine_handle<> handle_;
+  std::atomic<unsigned> state_{running};
+};
+
+/**
+ *  @brief Base of the awaitables: the fallback of the cores that do not queue
+ *  coroutines, where a suspended operation is retried by an `AsyncRetry`.
+ * */
+class AsyncWaiter {
+public:
+  AsyncWaiter(const AsyncWaiter &) = delete;
+  AsyncWaiter &operator=(const AsyncWaiter &) = delete;
+
+protected:
+  explicit AsyncWaiter(Executor &executor) : executor_(executor) {}
+  ~AsyncWaiter() = default;
+
+  /**
+   *  @brief Tries the operation without blocking and stores its result.
+   *  @returns False if it would block.
+   * */
+  virtual bool attempt() = 0;
+  virtual void add_to_core(Waiter &waiter) = 0;
+  virtual void remove_from_core(Waiter &waiter) = 0;
+
+  /**
+   *  @brief Registers a retry and makes a first attempt.
+   *  @returns True if the coroutine must stay suspended.
+   * */
+  bool suspend(std::coroutine_handle<> handle) {
+    this->retry_ = std::make_shared<AsyncRetry>(*this, this->executor_, handle);
+    this->add_to_core(*this->retry_);
+    // Pairs with the channels publishing their state before notifying.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return !this->retry_->drive();
+  }
+
+  /**
+   *  @brief Called once resumed: the retry already left the core.
+   * */
+  void resumed() { this->retry_.reset(); }
+
+  /**
+   *  @brief Withdraws the retry of a coroutine destroyed while suspended.
+   *  Called by the destructor of the awaitable.
+   * */
+  void cancel() {
+    if (this->retry_ == nullptr) {
+      return;
+    }
+    this->remove_from_core(*this->retry_);
+    this->retry_->cancel();
+    this->retry_.reset();
+  }
+
+private:
+  friend class AsyncRetry;
+
+  Executor &executor_;
+  std::shared_ptr<AsyncRetry> retry_;
+};
+
+inline bool AsyncRetry::drive() {
+  for (;;) {
+    this->state_.fetch_and(~pending, std::memory_order_acq_rel);
+    {
+      std::lock_guard lock(this->mutex_);
+      if (this->operation_ == nullptr) {
+        // The coroutine was destroyed.
+        return false;
+      }
+      if (this->operation_->attempt()) {
+        this->operation_->remove_from_core(*this);
+        return true;
+      }
+    }
+    unsigned expected = running;
+    if (this->state_.compare_exchange_strong(expected, idle,
+                                             std::memory_order_acq_rel)) {
+      return false;
+    }
+  }
+}
+
+} // namespace detail
+
+/**
+ *  @brief Awaitable returned by `async_send`. `co_await` yields the
+ *  `std::expected<void, Error>` of the send operation. The coroutine is only
+ *  suspended if the value cannot be sent inmediately: it then waits in the
+ *  queue of the core, like a blocked thread, until a receiver (a thread or
+ *  another coroutine) takes the value.
+ * */
+template <typename T> class SendAwaitable final : private detail::AsyncWaiter {
+public:
+  SendAwaitable(std::shared_ptr<ChannelCore<T>> core, T value,
+                Executor &executor)
+      : detail::AsyncWaiter(executor), core_(std::move(core)),
+        node_(executor) {
+    this->node_.value.emplace(std::move(value));
+  }
+  ~SendAwaitable() {
+    // The coroutine was destroyed while suspended.
+    if (this->queued_) {
+      this->core_->cancel_async(detail::Side::send, this->node_);
+    }
+    this->cancel();
+  }
+
+  bool await_ready() { return false; }
+  bool await_suspend(std::coroutine_handle<> handle) {
+    this->node_.handle = handle;
+    // Set first: once queued, the coroutine may be resumed at any time.
+    this->queued_ = true;
+    switch (this->core_->start_async_send(this->node_)) {
+    case detail::AsyncStart::queued:
+      return true;
+    case detail::AsyncStart::done:
+      this->queued_ = false;
+      return false;
+    case detail::AsyncStart::unsupported:
+      break;
+    }
+    this->queued_ = false;
+    return this->suspend(handle);
+  }
+  std::expected<void, Error> await_resume() {
+    this->queued_ = false;
+    this->resumed();
+    if (this->result_.has_value()) {
+      return *this->result_;
+    }
+    if (this->node_.state != detail::NodeState::done) {
+      return std::unexpected(Error::closed);
+    }
+    return {};
+  }
+
+private:
+  bool attempt() override {
+    auto result = this->core_->try_send(std::move(*this->node_.value));
+    if (!result.has_value() && result.error() == Error::would_block) {
+      return false;
+    }
+    this->result_.emplace(result);
+    return true;
+  }
+  void add_to_core(Waiter &waiter) override {
+    this->core_->add_waiter(waiter);
+  }
+  void remove_from_core(Waiter &waiter) override {
+    this->core_->remove_waiter(waiter);
+  }
+
+  std::shared_ptr<ChannelCore<T>> core_;
+  detail::AsyncNode<T> node_;
+  bool queued_ = false;
+  // Result of the retries, on the cores that do not queue coroutines.
+  std::optional<std::expected<void, Error>> result_;
+};
+
+/**
+ *  @brief Awaitable returned by `async_receive`. `co_await` yields the
+ *  `std::expected<T, Error>` of the receive operation. The coroutine is only
+ *  suspended if no value can be received inmediately: it then waits in the
+ *  queue of the core, like a blocked thread, until a sender (a thread or
+ *  another coroutine) hands a value over.
+ * */
+template <typename T>
+class ReceiveAwaitable final : private detail::AsyncWaiter {
+public:
+  ReceiveAwaitable(std::shared_ptr<ChannelCore<T>> core, Executor &executor)
+      : detail::AsyncWaiter(executor), core_(std::move(core)),
+        node_(executor) {}
+  /**
+   *  @brief Awaitable that is ready right away with `value`, which the
+   *  handle had already taken from the channel.
+   * */
+  ReceiveAwaitable(std::shared_ptr<ChannelCore<T>> core, Executor &executor,
+                   T value)
+      : ReceiveAwaitable(std::move(core), executor) {
+    this->result_.emplace(std::move(value));
+  }
+  ~ReceiveAwaitable() {
+    // The coroutine was destroyed while suspended.
+    if (this->queued_) {
+      this->core_->cancel_async(detail::Side::receive, this->node_);
+    }
+    this->cancel();
+  }
+
+  bool await_ready() { return this->result_.has_value(); }
+  bool await_suspend(std::coroutine_handle<> handle) {
+    this->node_.handle = handle;
+    // Set first: once queued, the coroutine may be resumed at any time.
+    this->queued_ = true;
+    switch (this->core_->start_async_receive(this->node_)) {
+    case detail::AsyncStart::queued:
+      return true;
+    case detail::AsyncStart::done:
+      this->queued_ = false;
+      return false;
+    case detail::AsyncStart::unsupported:
+      break;
+    }
+    this->queued_ = false;
+    return this->suspend(handle);
+  }
+  std::expected<T, Error> await_resume() {
+    this->queued_ = false;
+    this->resumed();
+    if (this->result_.has_value()) {
+      return std::move(*this->result_);
+    }
+    if (this->node_.state != detail::NodeState::done) {
+      return std::unexpected(Error::closed);
+    }
+    return std::move(*this->node_.value);
+  }
+
+private:
+  bool attempt() override {
+    auto result = this->core_->try_receive();
+    if (!result.has_value() && result.error() == Error::would_block) {
+      return false;
+    }
+    this->result_.emplace(std::move(result));
+    return true;
+  }
+  void add_to_core(Waiter &waiter) override {
+    this->core_->add_waiter(waiter);
+  }
+  void remove_from_core(Waiter &waiter) override {
+    this->core_->remove_waiter(waiter);
+  }
+
+  std::shared_ptr<ChannelCore<T>> core_;
+  detail::AsyncNode<T> node_;
+  bool queued_ = false;
+  // Result of the retries, on the cores that do not queue coroutines.
+  std::optional<std::expected<T, Error>> result_;
+};
+
+} // namespace chx
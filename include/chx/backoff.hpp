@@ -0,0 +1,58 @@
+#pragma once
+
+#include <thread>
+
+namespace chx::detail {
+
+/**
+ *  @brief Tells the CPU that the calling thread is busy waiting.
+ * */
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+/**
+ *  @brief Exponential backoff for the retry loops of the lock-free cores.
+ * */
+class Backoff {
+public:
+  /**
+   *  @brief Backs off after losing a race (a failed CAS). Only spins.
+   * */
+  void spin() noexcept {
+    for (unsigned i = 0; i < (1u << this->step_); i++) {
+      cpu_relax();
+    }
+    if (this->step_ <= spin_limit) {
+      this->step_++;
+    }
+  }
+
+  /**
+   *  @brief Backs off while waiting for another thread to make progress.
+   *  Spins at first, and then yields the processor.
+   * */
+  void snooze() noexcept {
+    if (this->step_ <= spin_limit) {
+      for (unsigned i = 0; i < (1u << this->step_); i++) {
+        cpu_relax();
+      }
+    } else {
+      std::this_thread::yield();
+    }
+    if (this->step_ <= yield_limit) {
+      this->step_++;
+    }
+  }
+
+private:
+  static constexpr unsigned spin_limit = 6;
+  static constexpr unsigned yield_limit = 10;
+  unsigned step_ = 0;
+};
+
+} // namespace chx::detail
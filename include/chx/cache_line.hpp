@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+namespace chx {
+
+/**
+ *  @brief Size used to pad atomics that are written by different threads, so
+ *  they never share a cache line.
+ * */
+inline constexpr std::size_t cache_line_size = 64;
+
+} // namespace chx
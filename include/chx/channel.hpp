@@ -1,16 +1,53 @@
 #pragma once
 
+#include "chx/async.hpp"
 #include "chx/channelCore.hpp"
+#include "chx/receive_iterator.hpp"
+#include "chx/slot.hpp"
+#include <concepts>
+#include <limits>
 #include <memory>
+#include <ranges>
 
 namespace chx {
 
-template <typename T> class ReceiverChannel;
-template <typename T> class SenderChannel;
+/**
+ *  @brief Channel handles are parameterized on the core they point to. The
+ *  default, `ChannelCore<T>`, erases the implementation and dispatches every
+ *  operation through virtual calls. A concrete core (such as
+ *  `buffered::Channel<T, Capacity>`) lets the compiler call, and inline, its
+ *  methods directly. A statically typed handle converts implicitly into the
+ *  type-erased one.
+ * */
+template <typename T, typename Impl = ChannelCore<T>> class Channel;
+template <typename T, typename Impl = ChannelCore<T>> class ReceiverChannel;
+template <typename T, typename Impl = ChannelCore<T>> class SenderChannel;
+
+namespace detail {
+/**
+ *  @brief Gives the library internals (such as `chx::select`) access to the
+ *  core shared by a channel handle.
+ * */
+struct HandleAccess {
+  template <typename Handle> static auto &core(Handle &handle) {
+    return handle.core_;
+  }
+};
+} // namespace detail
+
+template <typename T, typename Impl> class Channel {
+  static_assert(std::derived_from<Impl, ChannelCore<T>>,
+                "Impl must be a ChannelCore<T>");
 
-template <typename T> class Channel {
 public:
-  Channel(std::shared_ptr<ChannelCore<T>> core) : core_(core) {}
+  using value_type = T;
+  using core_type = Impl;
+
+  Channel(std::shared_ptr<Impl> core) : core_(core), count_(core_) {}
+  template <typename Other>
+    requires(!std::same_as<Other, Impl> && std::derived_from<Other, Impl>)
+  Channel(const Channel<T, Other> &other)
+      : core_(detail::HandleAccess::core(other)), count_(core_) {}
   ~Channel() = default;
 
   /**
@@ -25,6 +62,19 @@ public:
   }
   std::expected<void, Error> send(const T &value) { return core_->send(value); }
 
+  /**
+   *  @brief Sends an object constructed from `args` through the channel.
+   * Buffered channels build it directly in their buffer, with no temporary
+   * object. This method blocks the thread until the operation is done.
+   *  @returns `void` if the operation was successful. An `Error` if the
+   * operation failed.
+   * */
+  template <typename... Args>
+    requires std::constructible_from<T, Args &&...>
+  std::expected<void, Error> emplace_send(Args &&...args) {
+    return detail::emplace_send<T>(*core_, std::forward<Args>(args)...);
+  }
+
   /**
    *  @brief Sends an object through the channel. This method does not block
    * the thread, so an error will be returned if the operation could not be done
@@ -40,13 +90,89 @@ public:
     return core_->try_send(value);
   }
 
+  /**
+   *  @brief Sends an object through `lane` of a channel with priority lanes
+   * (see `priority::Channel`), where 0 is the highest priority. This method
+   * blocks the thread while that lane is full.
+   *  @returns `void` if the operation was successful. An `Error` if the
+   * operation failed.
+   * */
+  std::expected<void, Error> send_to(std::size_t lane, T &&value)
+    requires detail::LanedCore<Impl, T>
+  {
+    return core_->send_to(lane, std::move(value));
+  }
+  std::expected<void, Error> send_to(std::size_t lane, const T &value)
+    requires detail::LanedCore<Impl, T>
+  {
+    return core_->send_to(lane, value);
+  }
+
+  /**
+   *  @brief Sends an object through `lane` without blocking the thread.
+   *  @returns `void` if the operation was successful. `Error::would_block` if
+   * that lane is full, or another `Error` if the operation failed.
+   * */
+  std::expected<void, Error> try_send_to(std::size_t lane, T &&value)
+    requires detail::LanedCore<Impl, T>
+  {
+    return core_->try_send_to(lane, std::move(value));
+  }
+  std::expected<void, Error> try_send_to(std::size_t lane, const T &value)
+    requires detail::LanedCore<Impl, T>
+  {
+    return core_->try_send_to(lane, value);
+  }
+
+  /**
+   *  @brief Same as `send_to`, but the operation gives up after `timeout`.
+   * */
+  template <typename Rep, typename Period>
+    requires detail::LanedCore<Impl, T>
+  std::expected<void, Error>
+  send_to_for(std::size_t lane, T value,
+              const std::chrono::duration<Rep, Period> &timeout) {
+    return core_->send_to_until(lane, std::move(value),
+                                detail::deadline_after(timeout));
+  }
+
+  /**
+   *  @brief Claims the next free slot of a buffered channel, and builds an
+   * object from `args` in it (see `SendSlot`). The object is sent when the
+   * slot is committed, without being moved. This method blocks the thread
+   * until there is room.
+   *  @returns The claimed slot, or an `Error` if the operation failed.
+   * */
+  template <typename... Args>
+    requires detail::ClaimingCore<Impl, T> &&
+             std::constructible_from<T, Args &&...>
+  std::expected<SendSlot<T, Impl>, Error> claim(Args &&...args) {
+    auto value = core_->claim(no_deadline, std::forward<Args>(args)...);
+    if (!value.has_value()) {
+      return std::unexpected(value.error());
+    }
+    return SendSlot<T, Impl>(core_, *value);
+  }
+  template <typename... Args>
+    requires detail::ClaimingCore<Impl, T> &&
+             std::constructible_from<T, Args &&...>
+  std::expected<SendSlot<T, Impl>, Error> try_claim(Args &&...args) {
+    auto value = core_->try_claim(std::forward<Args>(args)...);
+    if (!value.has_value()) {
+      return std::unexpected(value.error());
+    }
+    return SendSlot<T, Impl>(core_, *value);
+  }
+
   /**
    *  @brief Receives an object through the channel. This method blocks the
    * thread until the operation is done.
    *  @returns An object (the one received from the channel), or an `Error` if
    * the operation failed.
    * */
-  std::expected<T, Error> receive() { return core_->receive(); }
+  std::expected<T, Error> receive() {
+    return this->buffer_.take_or([&] { return core_->receive(); });
+  }
 
   /**
    *  @brief Receives an object through the channel. This method does not block
@@ -56,17 +182,223 @@ public:
    *  @returns An object (the one received from the channel), or an `Error` if
    * the operation failed.
    * */
-  std::expected<T, Error> try_receive() { return core_->try_receive(); }
+  std::expected<T, Error> try_receive() {
+    return this->buffer_.take_or([&] { return core_->try_receive(); });
+  }
+
+  /**
+   *  @brief Sends an object through the channel. This method blocks the thread
+   * until the operation is done or `timeout` elapses.
+   *  @returns `void` if the operation was successful. `Error::timeout` if it
+   * timed out (the channel does not keep the object), or another `Error` if
+   * the operation failed.
+   * */
+  template <typename Rep, typename Period>
+  std::expected<void, Error>
+  send_for(T &&value, const std::chrono::duration<Rep, Period> &timeout) {
+    return core_->send_until(std::move(value), detail::deadline_after(timeout));
+  }
+  template <typename Rep, typename Period>
+  std::expected<void, Error>
+  send_for(const T &value, const std::chrono::duration<Rep, Period> &timeout) {
+    return core_->send_until(value, detail::deadline_after(timeout));
+  }
+
+  /**
+   *  @brief Same as `send_for`, but the operation gives up at `deadline`.
+   * */
+  template <typename Clock, typename Duration>
+  std::expected<void, Error>
+  send_until(T &&value,
+             const std::chrono::time_point<Clock, Duration> &deadline) {
+    return core_->send_until(std::move(value), detail::to_deadline(deadline));
+  }
+  template <typename Clock, typename Duration>
+  std::expected<void, Error>
+  send_until(const T &value,
+             const std::chrono::time_point<Clock, Duration> &deadline) {
+    return core_->send_until(value, detail::to_deadline(deadline));
+  }
+
+  /**
+   *  @brief Receives an object through the channel. This method blocks the
+   * thread until the operation is done or `timeout` elapses.
+   *  @returns An object (the one received from the channel).
+   * `Error::timeout` if it timed out, or another `Error` if the operation
+   * failed.
+   * */
+  template <typename Rep, typename Period>
+  std::expected<T, Error>
+  receive_for(const std::chrono::duration<Rep, Period> &timeout) {
+    return this->buffer_.take_or([&] {
+      return core_->receive_until(detail::deadline_after(timeout));
+    });
+  }
+
+  /**
+   *  @brief Same as `receive_for`, but the operation gives up at `deadline`.
+   * */
+  template <typename Clock, typename Duration>
+  std::expected<T, Error>
+  receive_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+    return this->buffer_.take_or(
+        [&] { return core_->receive_until(detail::to_deadline(deadline)); });
+  }
+
+  /**
+   *  @brief Acquires the object at the front of a buffered channel, to read it
+   * in place (see `ReceiveView`). It is removed from the channel when the view
+   * is released. This method blocks the thread until there is an object.
+   *  @returns The acquired object, or an `Error` if the operation failed.
+   * */
+  std::expected<ReceiveView<T, Impl>, Error> acquire()
+    requires detail::ClaimingCore<Impl, T>
+  {
+    auto value = core_->acquire(no_deadline);
+    if (!value.has_value()) {
+      return std::unexpected(value.error());
+    }
+    return ReceiveView<T, Impl>(core_, *value);
+  }
+  std::expected<ReceiveView<T, Impl>, Error> try_acquire()
+    requires detail::ClaimingCore<Impl, T>
+  {
+    auto value = core_->try_acquire();
+    if (!value.has_value()) {
+      return std::unexpected(value.error());
+    }
+    return ReceiveView<T, Impl>(core_, *value);
+  }
+
+  /**
+   *  @brief Sends an object through the channel from a coroutine:
+   * `co_await ch.async_send(value)`. Instead of blocking the thread, the
+   * coroutine is suspended until the operation can be done, and then resumed
+   * on `executor`.
+   *  @returns An awaitable that yields `void` if the operation was successful,
+   * or an `Error` if it failed.
+   * */
+  SendAwaitable<T> async_send(T value,
+                              Executor &executor = default_executor()) {
+    return SendAwaitable<T>(core_, std::move(value), executor);
+  }
+
+  /**
+   *  @brief Receives an object through the channel from a coroutine:
+   * `co_await ch.async_receive()`. Instead of blocking the thread, the
+   * coroutine is suspended until the operation can be done, and then resumed
+   * on `executor`.
+   *  @returns An awaitable that yields the object received, or an `Error` if
+   * the operation failed.
+   * */
+  ReceiveAwaitable<T> async_receive(Executor &executor = default_executor()) {
+    if (!this->buffer_.empty()) {
+      return ReceiveAwaitable<T>(core_, executor, this->buffer_.take_front());
+    }
+    return ReceiveAwaitable<T>(core_, executor);
+  }
+
+  /**
+   *  @brief Sends every object of `values` through the channel, moving them
+   * out. This method blocks the thread until all of them were sent, taking the
+   * channel lock once per batch instead of once per object.
+   *  @returns The number of objects sent (smaller than `values.size()` only if
+   * the channel was closed midway), or an `Error` if none could be sent.
+   * */
+  std::expected<std::size_t, Error> send_many(std::span<T> values) {
+    return core_->send_many(values);
+  }
+  template <std::input_iterator It, std::sentinel_for<It> Sentinel>
+  std::expected<std::size_t, Error> send_many(It first, Sentinel last) {
+    return detail::send_range<T>(*core_, first, last);
+  }
+
+  /**
+   *  @brief Sends as many objects of `values` as possible without blocking
+   * the thread.
+   *  @returns The number of objects sent, or an `Error` if none could be sent.
+   * */
+  std::expected<std::size_t, Error> try_send_many(std::span<T> values) {
+    return core_->try_send_many(values);
+  }
+
+  /**
+   *  @brief Receives several objects through the channel. This method blocks
+   * the thread until at least `min` objects were received, and then takes the
+   * ones already available, up to `max` (and `out.size()`).
+   *  @returns The number of objects moved into `out`, or an `Error` if none
+   * could be received.
+   * */
+  std::expected<std::size_t, Error>
+  receive_many(std::span<T> out, std::size_t min = 1,
+               std::size_t max = std::numeric_limits<std::size_t>::max()) {
+    return this->buffer_.receive_many(*core_, out, min, max);
+  }
+
+  /**
+   *  @brief Receives the objects already available, up to `out.size()`,
+   * without blocking the thread.
+   *  @returns The number of objects moved into `out`, or an `Error` if none
+   * could be received.
+   * */
+  std::expected<std::size_t, Error> try_receive_many(std::span<T> out) {
+    return this->buffer_.try_receive_many(*core_, out);
+  }
 
   void close() { return core_->close(); }
+  /**
+   *  @brief Closes the channel once receivers took the objects it stores
+   * (see `ChannelCore::close_sending`).
+   * */
+  void close_sending() { core_->close_sending(); }
   bool is_closed() const { return core_->is_closed(); }
 
-  ReceiverChannel<T> make_receiver() const {
-    return ReceiverChannel<T>(this->core_);
+  /**
+   *  @returns The number of objects stored in the channel (`len` in Go).
+   * */
+  std::size_t size() const { return core_->size(); }
+
+  /**
+   *  @returns The maximum number of objects the channel stores (`cap` in Go).
+   * */
+  std::size_t capacity() const { return core_->capacity(); }
+
+  /**
+   *  @returns A snapshot of the counters of the channel. They are only kept
+   *  when `CHX_ENABLE_METRICS` is defined (see `chx::metrics_enabled`).
+   * */
+  ChannelMetrics metrics() const { return core_->metrics(); }
+
+  /**
+   *  @returns An iterator over the objects received from the channel, until
+   *  it is closed (see `ReceiveIterator`). With `end()`, it makes the channel
+   *  an input range. The objects a loop took from the channel but did not
+   *  reach are kept by the handle, for its next receive operations.
+   * */
+  ReceiveIterator<T, Impl> begin() {
+    return ReceiveIterator<T, Impl>(this->core_.get(), &this->buffer_);
+  }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+
+  ReceiverChannel<T, Impl> make_receiver() const {
+    return ReceiverChannel<T, Impl>(this->core_);
+  }
+  SenderChannel<T, Impl> make_sender() const {
+    return SenderChannel<T, Impl>(this->core_);
   }
-  SenderChannel<T> make_sender() const { return SenderChannel<T>(this->core_); }
 
 private:
-  std::shared_ptr<ChannelCore<T>> core_;
+  friend detail::HandleAccess;
+  std::shared_ptr<Impl> core_;
+  // Counts as a sender and a receiver: the channel closes once every handle
+  // of a side is dropped (see `ChannelCore::detach`).
+  detail::HandleCount<T, true, true> count_;
+  // Objects taken by range loops, and not reached yet.
+  detail::ReceiveBuffer<T> buffer_;
 };
 } // namespace chx
+
+// `size()` counts the objects stored now, not the ones a loop will receive.
+template <typename T, typename Impl>
+inline constexpr bool std::ranges::disable_sized_range<chx::Channel<T, Impl>> =
+    true;
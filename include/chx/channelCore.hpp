@@ -1,15 +1,64 @@
 #pragma once
 
+#include "chx/deadline.hpp"
+#include "chx/metrics.hpp"
+#include "chx/wait_node.hpp"
+#include "chx/waiter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
 #include <expected>
-#include <string>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <utility>
 
 namespace chx {
 
-typedef std::string Error;
+/**
+ *  @brief Reason why a channel operation could not be done. It is a plain
+ *  enum, so failing (for example, a `try_send` on a full buffer) never
+ *  allocates.
+ * */
+enum class ChannelError : std::uint8_t {
+  closed,      ///< The channel is closed.
+  would_block, ///< A non blocking operation could not be done inmediately.
+  timeout,     ///< The deadline of the operation expired.
+  cancelled,   ///< The operation was cancelled before it could be done.
+};
+
+typedef ChannelError Error;
+
+/**
+ *  @returns A human readable description of `error`, meant for logging.
+ * */
+constexpr std::string_view to_string(ChannelError error) noexcept {
+  switch (error) {
+  case ChannelError::closed:
+    return "channel closed";
+  case ChannelError::would_block:
+    return "operation would block";
+  case ChannelError::timeout:
+    return "operation timed out";
+  case ChannelError::cancelled:
+    return "operation cancelled";
+  }
+  return "unknown channel error";
+}
 
 template <class T> class ChannelCore {
 public:
   ChannelCore() = default;
+
+  /**
+   *  @brief Builds a core whose waiter list (see `select`) is allocated from
+   *  `resource`.
+   * */
+  explicit ChannelCore(std::pmr::memory_resource *resource)
+      : waiters_(resource) {}
   virtual ~ChannelCore() = default;
 
   /**
@@ -51,8 +100,486 @@ public:
    * */
   virtual std::expected<T, Error> try_receive() = 0;
 
+  /**
+   *  @brief Sends an object through the channel. This method blocks the thread
+   * until the operation is done or `deadline` expires.
+   *  @param value The object to be sent through the channel. If the operation
+   * times out, the channel does not keep it.
+   *  @returns `void` if the operation was successful. `Error::timeout` if the
+   * deadline expired, or another `Error` if the operation failed.
+   * */
+  virtual std::expected<void, Error> send_until(T &&value,
+                                                Deadline deadline) = 0;
+  virtual std::expected<void, Error> send_until(const T &value,
+                                                Deadline deadline) = 0;
+
+  /**
+   *  @brief Receives an object through the channel. This method blocks the
+   * thread until the operation is done or `deadline` expires.
+   *  @returns An object (the one received from the channel). `Error::timeout`
+   * if the deadline expired, or another `Error` if the operation failed.
+   * */
+  virtual std::expected<T, Error> receive_until(Deadline deadline) = 0;
+
+  /**
+   *  @brief Same as `send_until`, with a deadline `timeout` from now.
+   * */
+  template <typename Rep, typename Period>
+  std::expected<void, Error>
+  send_for(T &&value, const std::chrono::duration<Rep, Period> &timeout) {
+    return this->send_until(std::move(value), detail::deadline_after(timeout));
+  }
+  template <typename Rep, typename Period>
+  std::expected<void, Error>
+  send_for(const T &value, const std::chrono::duration<Rep, Period> &timeout) {
+    return this->send_until(value, detail::deadline_after(timeout));
+  }
+
+  /**
+   *  @brief Same as `receive_until`, with a deadline `timeout` from now.
+   * */
+  template <typename Rep, typename Period>
+  std::expected<T, Error>
+  receive_for(const std::chrono::duration<Rep, Period> &timeout) {
+    return this->receive_until(detail::deadline_after(timeout));
+  }
+
+  /**
+   *  @brief Sends every object of `values` through the channel, moving them
+   * out of the span. This method blocks the thread until all of them were sent
+   * or the channel is closed.
+   *  @param values The objects to be sent, in order.
+   *  @returns The number of objects sent, which is only smaller than
+   * `values.size()` if the channel was closed midway. An `Error` if none could
+   * be sent.
+   * */
+  virtual std::expected<std::size_t, Error> send_many(std::span<T> values);
+
+  /**
+   *  @brief Sends as many objects of `values` as possible without blocking the
+   * thread, moving them out of the span.
+   *  @param values The objects to be sent, in order.
+   *  @returns The number of objects sent (the first ones of `values`). An
+   * `Error` if none could be sent.
+   * */
+  virtual std::expected<std::size_t, Error> try_send_many(std::span<T> values);
+
+  /**
+   *  @brief Receives several objects through the channel. This method blocks
+   * the thread until at least `min` objects were received, and then takes
+   * the ones that are already available, up to `max`.
+   *  @param out Where the received objects are moved to, in order.
+   *  @param min The number of objects to wait for. Clamped to `max`.
+   *  @param max The maximum number of objects to receive. Clamped to
+   * `out.size()`.
+   *  @returns The number of objects received, which is only smaller than `min`
+   * if the channel was closed midway. An `Error` if none could be received.
+   * */
+  virtual std::expected<std::size_t, Error>
+  receive_many(std::span<T> out, std::size_t min, std::size_t max);
+
+  /**
+   *  @brief Receives the objects that are already available, up to
+   * `out.size()`, without blocking the thread.
+   *  @param out Where the received objects are moved to, in order.
+   *  @returns The number of objects received. An `Error` if none could be
+   * received.
+   * */
+  virtual std::expected<std::size_t, Error> try_receive_many(std::span<T> out);
+
   virtual void close() = 0;
   virtual bool is_closed() const = 0;
+
+  /**
+   *  @brief Tells the channel that nothing more will be sent, as if its last
+   * sender handle was dropped: receivers take the objects still stored, and
+   * then find the channel closed. Unlike `close`, nothing is dropped. No
+   * handle may send afterwards.
+   * */
+  virtual void close_sending() { this->drop_senders(); }
+
+  /**
+   *  @returns The number of objects stored in the channel, like `len` in Go.
+   * It takes no lock, so it is only a snapshot while other threads use the
+   * channel.
+   * */
+  virtual std::size_t size() const = 0;
+
+  /**
+   *  @returns The maximum number of objects the channel stores, like `cap` in
+   * Go: 0 for an unbuffered channel.
+   * */
+  virtual std::size_t capacity() const = 0;
+
+  /**
+   *  @returns A snapshot of the counters of the channel (see
+   * `ChannelMetrics`).
+   * */
+  ChannelMetrics metrics() const {
+    ChannelMetrics metrics = this->metrics_.snapshot();
+    metrics.depth = this->size();
+    return metrics;
+  }
+
+  /**
+   *  @brief Registers `waiter`, so it is notified every time an operation on
+   * this channel may have become possible. Used by `chx::select`. The waiter
+   * must be removed before it is destroyed.
+   * */
+  virtual void add_waiter(Waiter &waiter) { this->waiters_.add(waiter); }
+  virtual void remove_waiter(Waiter &waiter) { this->waiters_.remove(waiter); }
+
+  /**
+   *  @brief Starts sending `node.value` for a coroutine (see `async_send`).
+   * If it can not be done right away, the node is queued like a blocked
+   * sender: a counterpart completes it and calls `node.wake()`, so each
+   * operation wakes exactly one coroutine. Cores that do not queue
+   * coroutines return `AsyncStart::unsupported`, and the coroutine then
+   * retries on the notifications of the waiter list instead.
+   * */
+  virtual detail::AsyncStart start_async_send(detail::WaitNode<T> &node) {
+    (void)node;
+    return detail::AsyncStart::unsupported;
+  }
+
+  /**
+   *  @brief Starts receiving into `node.value` for a coroutine, like
+   * `start_async_send`.
+   * */
+  virtual detail::AsyncStart start_async_receive(detail::WaitNode<T> &node) {
+    (void)node;
+    return detail::AsyncStart::unsupported;
+  }
+
+  /**
+   *  @brief Queues `node`, a case of a `select`, as a waiting sender (or
+   * receiver, as told by `side`). The counterpart that claims its group
+   * completes it like a blocked thread, so that two `select` calls can meet
+   * on the channel. The node is not queued if the case may fire right away.
+   * Cores that do not queue `select` cases return
+   * `SelectStart::unsupported`, and `select` relies on the notifications of
+   * the waiter list instead.
+   * */
+  virtual detail::SelectStart start_select(detail::Side side,
+                                           detail::WaitNode<T> &node) {
+    (void)side;
+    (void)node;
+    return detail::SelectStart::unsupported;
+  }
+
+  /**
+   *  @brief Withdraws a node queued by `start_async_send` (or receive, as
+   * told by `side`) or by `start_select`, if it was not completed yet.
+   * Called when a suspended coroutine is destroyed, and when a `select`
+   * returns.
+   * */
+  virtual void cancel_async(detail::Side side, detail::WaitNode<T> &node) {
+    (void)side;
+    (void)node;
+  }
+
+  /**
+   *  @brief Counts a new handle that sends (or receives) through the channel.
+   *  Called by the handles: one that both sends and receives, like `Channel`,
+   *  counts on both sides.
+   * */
+  void attach(detail::Side side) {
+    this->handles(side).fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   *  @brief Drops a handle counted by `attach`. Dropping the last receiver
+   *  closes the channel, so that senders fail fast instead of filling it.
+   *  Dropping the last sender lets the receivers take the objects still
+   *  stored, and then closes the channel (see `disconnect_senders`).
+   * */
+  void detach(detail::Side side) {
+    if (this->handles(side).fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+    if (side == detail::Side::send) {
+      this->drop_senders();
+    } else {
+      this->disconnect_receivers();
+    }
+  }
+
+  /**
+   *  @returns The number of live handles that send through the channel.
+   * */
+  std::size_t senders() const {
+    return this->senders_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   *  @returns The number of live handles that receive from the channel.
+   * */
+  std::size_t receivers() const {
+    return this->receivers_.load(std::memory_order_relaxed);
+  }
+
+protected:
+  /**
+   *  @brief Called when the last sender handle is dropped. Cores that store
+   *  objects override it so that receivers first take them: they must wake
+   *  every blocked receiver, and make receive operations fail with
+   *  `Error::closed` once they find the channel empty and `senders_gone()`.
+   *  The default closes the channel right away.
+   * */
+  virtual void disconnect_senders() { this->close(); }
+
+  /**
+   *  @brief Called when the last receiver handle is dropped. Nobody can take
+   *  the stored objects anymore, so the default closes the channel.
+   * */
+  virtual void disconnect_receivers() { this->close(); }
+
+  /**
+   *  @returns True once the last sender handle was dropped, or
+   * `close_sending` was called.
+   * */
+  bool senders_gone() const {
+    return this->senders_gone_.load(std::memory_order_seq_cst);
+  }
+
+  /**
+   *  @brief Must be called by every implementation after a change that may
+   * let a pending operation proceed (a value stored, a slot freed, a
+   * counterpart arrived, the channel closed).
+   * */
+  void notify_waiters(WaitEvent event) { this->waiters_.notify(event); }
+
+  /**
+   *  @brief Records `count` objects sent. The depth of the channel is only
+   * read when metrics are enabled.
+   * */
+  void record_sent(std::size_t count) {
+    if constexpr (metrics_enabled) {
+      this->metrics_.sent(count, this->size());
+    }
+  }
+
+  [[no_unique_address]] detail::MetricsRecorder metrics_;
+
+private:
+  std::atomic<std::size_t> &handles(detail::Side side) {
+    return side == detail::Side::send ? this->senders_ : this->receivers_;
+  }
+
+  void drop_senders() {
+    if (!this->senders_gone_.exchange(true, std::memory_order_seq_cst)) {
+      this->disconnect_senders();
+    }
+  }
+
+  detail::WaiterList waiters_;
+  std::atomic<std::size_t> senders_{0};
+  std::atomic<std::size_t> receivers_{0};
+  std::atomic<bool> senders_gone_{false};
+};
+
+namespace detail {
+
+/**
+ *  @brief Counts the handle it belongs to among the senders (`Sends`) and
+ *  receivers (`Receives`) of its core for as long as it lives (see
+ *  `ChannelCore::attach`). Copies count again, and moved-from ones stop
+ *  counting. It shares the ownership of the core, so that the core outlives
+ *  the `detach` of a handle being assigned or destroyed, whatever the order
+ *  of the handle members.
+ * */
+template <class T, bool Sends, bool Receives> class HandleCount {
+public:
+  explicit HandleCount(std::shared_ptr<ChannelCore<T>> core)
+      : core_(std::move(core)) {
+    this->attach();
+  }
+  HandleCount(const HandleCount &other) : core_(other.core_) {
+    this->attach();
+  }
+  HandleCount(HandleCount &&other) noexcept = default;
+  HandleCount &operator=(const HandleCount &other) {
+    if (this != &other) {
+      this->detach();
+      this->core_ = other.core_;
+      this->attach();
+    }
+    return *this;
+  }
+  HandleCount &operator=(HandleCount &&other) noexcept {
+    if (this != &other) {
+      this->detach();
+      this->core_ = std::move(other.core_);
+    }
+    return *this;
+  }
+  ~HandleCount() { this->detach(); }
+
+private:
+  void attach() {
+    if (this->core_ == nullptr) {
+      return;
+    }
+    if constexpr (Sends) {
+      this->core_->attach(Side::send);
+    }
+    if constexpr (Receives) {
+      this->core_->attach(Side::receive);
+    }
+  }
+
+  void detach() {
+    if (this->core_ == nullptr) {
+      return;
+    }
+    if constexpr (Sends) {
+      this->core_->detach(Side::send);
+    }
+    if constexpr (Receives) {
+      this->core_->detach(Side::receive);
+    }
+  }
+
+  std::shared_ptr<ChannelCore<T>> core_;
 };
 
+} // namespace detail
+
+// The default batch operations are built on top of the single element ones,
+// so every core supports them. Cores override them to move a whole batch under
+// one lock acquisition.
+
+template <class T>
+std::expected<std::size_t, Error>
+ChannelCore<T>::send_many(std::span<T> values) {
+  std::size_t sent = 0;
+  for (T &value : values) {
+    auto result = this->send(std::move(value));
+    if (!result.has_value()) {
+      if (sent == 0) {
+        return std::unexpected(result.error());
+      }
+      break;
+    }
+    sent++;
+  }
+  return sent;
+}
+
+template <class T>
+std::expected<std::size_t, Error>
+ChannelCore<T>::try_send_many(std::span<T> values) {
+  std::size_t sent = 0;
+  for (T &value : values) {
+    auto result = this->try_send(std::move(value));
+    if (!result.has_value()) {
+      if (sent == 0) {
+        return std::unexpected(result.error());
+      }
+      break;
+    }
+    sent++;
+  }
+  return sent;
+}
+
+template <class T>
+std::expected<std::size_t, Error>
+ChannelCore<T>::receive_many(std::span<T> out, std::size_t min,
+                             std::size_t max) {
+  max = std::min(max, out.size());
+  min = std::min(min, max);
+  std::size_t received = 0;
+  while (received < max) {
+    auto result = received < min ? this->receive() : this->try_receive();
+    if (!result.has_value()) {
+      if (received == 0) {
+        return std::unexpected(result.error());
+      }
+      break;
+    }
+    out[received++] = std::move(*result);
+  }
+  return received;
+}
+
+template <class T>
+std::expected<std::size_t, Error>
+ChannelCore<T>::try_receive_many(std::span<T> out) {
+  return this->receive_many(out, 0, out.size());
+}
+
+namespace detail {
+
+/**
+ *  @brief Sends the objects of an iterator range through `core`. Contiguous
+ *  ranges of mutable `T` go through one `send_many` call; any other range is
+ *  sent element by element.
+ * */
+template <class T, class Core, std::input_iterator It,
+          std::sentinel_for<It> Sentinel>
+std::expected<std::size_t, Error> send_range(Core &core, It first,
+                                             Sentinel last) {
+  if constexpr (std::contiguous_iterator<It> &&
+                std::same_as<std::iter_reference_t<It>, T &>) {
+    return core.send_many(std::span<T>(first, last));
+  } else {
+    std::size_t sent = 0;
+    for (; first != last; ++first) {
+      auto result = core.send(std::ranges::iter_move(first));
+      if (!result.has_value()) {
+        if (sent == 0) {
+          return std::unexpected(result.error());
+        }
+        break;
+      }
+      sent++;
+    }
+    return sent;
+  }
+}
+
+/**
+ *  @brief Sends an object constructed from `args` through `core`. Cores that
+ *  provide `emplace_send` build it in place; the object is built here and
+ *  moved into any other core.
+ * */
+template <class T, class Core, typename... Args>
+std::expected<void, Error> emplace_send(Core &core, Args &&...args) {
+  if constexpr (requires { core.emplace_send(std::forward<Args>(args)...); }) {
+    return core.emplace_send(std::forward<Args>(args)...);
+  } else {
+    return core.send(T(std::forward<Args>(args)...));
+  }
+}
+
+/**
+ *  @brief Cores with several lanes (see `priority::Channel`), whose senders
+ *  choose the lane of each object.
+ * */
+template <class Core, class T>
+concept LanedCore = requires(Core &core, T &&value, std::size_t lane,
+                             Deadline deadline) {
+  core.send_to(lane, std::move(value));
+  core.try_send_to(lane, std::move(value));
+  core.send_to_until(lane, std::move(value), deadline);
+};
+
+/**
+ *  @brief Cores whose slots can be filled and read in place (see `SendSlot`
+ *  and `ReceiveView`).
+ * */
+template <class Core, class T>
+concept ClaimingCore = requires(Core &core, Deadline deadline) {
+  { core.claim(deadline) } -> std::same_as<std::expected<T *, Error>>;
+  { core.try_claim() } -> std::same_as<std::expected<T *, Error>>;
+  { core.acquire(deadline) } -> std::same_as<std::expected<T *, Error>>;
+  { core.try_acquire() } -> std::same_as<std::expected<T *, Error>>;
+  core.commit_claim();
+  core.cancel_claim();
+  core.release_acquired();
+};
+
+} // namespace detail
+
 } // namespace chx
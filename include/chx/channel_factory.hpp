@@ -1,26 +1,229 @@
 #pragma once
 
+#include "chx/Broadcast/BroadcastChannel.hpp"
 #include "chx/Buffered/BufferedChannel.hpp"
+#include "chx/Mpmc/MpmcChannel.hpp"
+#include "chx/Priority/PriorityChannel.hpp"
+#include "chx/Spsc/SpscChannel.hpp"
+#include "chx/Unbounded/UnboundedChannel.hpp"
 #include "chx/Unbuffered/UnbufferedChannel.hpp"
 #include "chx/channel.hpp"
+#include <concepts>
+#include <memory>
 
 namespace chx {
-template <typename T, std::size_t Capacity = 0>
-Channel<T> CreateChannel()
-  requires(Capacity != 0)
+
+/**
+ *  @brief Tags used by `CreateChannel` to choose the buffered implementation.
+ * */
+namespace policy {
+/// Mutex protected buffer. Any number of senders and receivers.
+struct Locked {};
+/// Lock-free ring. Exactly one sender thread and one receiver thread.
+struct Spsc {};
+/// Lock-free ring. Any number of senders and receivers, `Capacity` > 1.
+struct Mpmc {};
+/// Segmented list without capacity limit: senders never block.
+struct Unbounded {};
+/// `Lanes` mutex protected buffers of `Capacity` objects each, received in
+/// priority order (see `priority::Channel`).
+template <std::size_t Lanes> struct Priority {
+  static constexpr std::size_t lanes = Lanes;
+};
+} // namespace policy
+
+namespace detail {
+template <typename Policy> inline constexpr bool is_priority_policy = false;
+template <std::size_t Lanes>
+inline constexpr bool is_priority_policy<policy::Priority<Lanes>> = true;
+
+/**
+ *  @brief Core built by `CreateChannel<T, Capacity, Policy, Wait>`.
+ * */
+template <typename T, std::size_t Capacity, typename Policy, typename Wait>
+struct CoreFor {
+  using type = buffered::Channel<T, Capacity, Wait>;
+};
+template <typename T, typename Wait>
+struct CoreFor<T, 0, policy::Locked, Wait> {
+  using type = unbuffered::Channel<T, Wait>;
+};
+template <typename T, std::size_t Capacity, typename Wait>
+struct CoreFor<T, Capacity, policy::Spsc, Wait> {
+  using type = spsc::Channel<T, Capacity>;
+};
+template <typename T, std::size_t Capacity, typename Wait>
+struct CoreFor<T, Capacity, policy::Mpmc, Wait> {
+  using type = mpmc::Channel<T, Capacity>;
+};
+template <typename T, std::size_t Capacity, std::size_t Lanes, typename Wait>
+struct CoreFor<T, Capacity, policy::Priority<Lanes>, Wait> {
+  using type = priority::Channel<T, Lanes, Capacity, Wait>;
+};
+} // namespace detail
+
+/**
+ *  @brief Creates a channel. The returned handle knows the concrete core, so
+ *  its operations are not dispatched through virtual calls; it converts into
+ *  a type-erased `Channel<T>` (and its senders and receivers into
+ *  `SenderChannel<T>` and `ReceiverChannel<T>`) when needed.
+ *
+ *  The mutex based channels also take the `Wait` strategy of their blocked
+ *  threads: `wait::Blocking` (CPU-frugal) or `wait::SpinThenPark`
+ *  (latency-optimized).
+ * */
+template <typename T, std::size_t Capacity = 0,
+          typename Policy = policy::Locked, typename Wait = wait::Blocking>
+Channel<T, buffered::Channel<T, Capacity, Wait>> CreateChannel()
+  requires(Capacity != 0 && std::same_as<Policy, policy::Locked>)
+{
+  return Channel<T, buffered::Channel<T, Capacity, Wait>>(
+      std::make_shared<buffered::Channel<T, Capacity, Wait>>());
+}
+
+template <typename T, std::size_t Capacity = 0,
+          typename Policy = policy::Locked>
+Channel<T, spsc::Channel<T, Capacity>> CreateChannel()
+  requires(Capacity != 0 && std::same_as<Policy, policy::Spsc>)
 {
-  std::shared_ptr<ChannelCore<T>> core =
-      std::make_shared<buffered::Channel<T, Capacity>>();
-  return Channel<T>(core);
+  return Channel<T, spsc::Channel<T, Capacity>>(
+      std::make_shared<spsc::Channel<T, Capacity>>());
 }
 
-template <typename T, std::size_t Capacity = 0>
-Channel<T> CreateChannel()
-  requires(Capacity == 0)
+template <typename T, std::size_t Capacity = 0,
+          typename Policy = policy::Locked>
+Channel<T, mpmc::Channel<T, Capacity>> CreateChannel()
+  requires(Capacity != 0 && std::same_as<Policy, policy::Mpmc>)
 {
-  std::shared_ptr<ChannelCore<T>> core =
-      std::make_shared<unbuffered::Channel<T>>();
-  return Channel<T>(core);
+  return Channel<T, mpmc::Channel<T, Capacity>>(
+      std::make_shared<mpmc::Channel<T, Capacity>>());
+}
+
+template <typename T, std::size_t Capacity = 0,
+          typename Policy = policy::Locked, typename Wait = wait::Blocking>
+Channel<T, unbuffered::Channel<T, Wait>> CreateChannel()
+  requires(Capacity == 0 && std::same_as<Policy, policy::Locked>)
+{
+  return Channel<T, unbuffered::Channel<T, Wait>>(
+      std::make_shared<unbuffered::Channel<T, Wait>>());
+}
+
+/**
+ *  @brief Creates a buffered channel whose capacity is chosen at run time, for
+ *  instance from a configuration file. Large buffers are mapped lazily, so
+ *  only the pages actually used are committed.
+ *  @param capacity Size of the buffer. A capacity of 0 is rounded up to 1.
+ *  @param pages Pages backing large buffers.
+ *  @tparam Wait How blocked threads wait (see `chx::wait`).
+ *  @throws std::length_error if `capacity` objects do not fit in the address
+ *  space.
+ * */
+template <typename T, typename Wait = wait::Blocking>
+Channel<T, buffered::Channel<T, dynamic_capacity, Wait>>
+CreateChannel(std::size_t capacity, PageBacking pages = PageBacking::standard) {
+  return Channel<T, buffered::Channel<T, dynamic_capacity, Wait>>(
+      std::make_shared<buffered::Channel<T, dynamic_capacity, Wait>>(capacity,
+                                                                     pages));
+}
+
+/**
+ *  @brief Creates a channel without capacity limit, whose senders never
+ *  block: `CreateChannel<T, chx::policy::Unbounded>()`.
+ * */
+template <typename T, typename Policy>
+Channel<T, unbounded::Channel<T>> CreateChannel()
+  requires std::same_as<Policy, policy::Unbounded>
+{
+  return Channel<T, unbounded::Channel<T>>(
+      std::make_shared<unbounded::Channel<T>>());
+}
+
+/**
+ *  @brief Creates a channel with `Policy::lanes` priority lanes of `Capacity`
+ *  objects each: `CreateChannel<T, Capacity, chx::policy::Priority<2>>()`.
+ *  `send_to(lane, value)` chooses the lane, and `receive` takes from the
+ *  highest priority one (lane 0) that is not empty.
+ *  @param weights Objects received in a row from each lane while a lower
+ *  one waits, before the lower one is served once. 0 means no limit.
+ * */
+template <typename T, std::size_t Capacity, typename Policy,
+          typename Wait = wait::Blocking>
+  requires(Capacity != 0 && detail::is_priority_policy<Policy>)
+Channel<T, priority::Channel<T, Policy::lanes, Capacity, Wait>> CreateChannel(
+    typename priority::Channel<T, Policy::lanes, Capacity, Wait>::Weights
+        weights = {}) {
+  return Channel<T, priority::Channel<T, Policy::lanes, Capacity, Wait>>(
+      std::make_shared<priority::Channel<T, Policy::lanes, Capacity, Wait>>(
+          weights));
+}
+
+/**
+ *  @brief Same as the other `CreateChannel` overloads, but the core is
+ *  allocated with `alloc` instead of the global heap, so a channel can be
+ *  placed in an arena (a per NUMA node pool, a monotonic buffer...):
+ *
+ *  ``` cpp
+ *  std::pmr::unsynchronized_pool_resource arena;
+ *  std::pmr::polymorphic_allocator<> alloc(&arena);
+ *  auto ch = chx::CreateChannel<T, 64>(std::allocator_arg, alloc);
+ *  ```
+ *
+ *  Any allocator places the core and its control block, which hold the
+ *  buffer of the channels with a compile time capacity. A
+ *  `std::pmr::polymorphic_allocator` also serves what the core allocates
+ *  later: the buffer of a runtime sized channel
+ *  (`CreateChannel<T, dynamic_capacity>(std::allocator_arg, alloc, capacity)`)
+ *  and the waiter lists of `select`. The resource must outlive the channel.
+ *  @param args Arguments of the core after the allocator, like the capacity
+ *  of a runtime sized channel or the weights of a priority one.
+ * */
+template <typename T, std::size_t Capacity = 0,
+          typename Policy = policy::Locked, typename Wait = wait::Blocking,
+          typename Alloc, typename... Args>
+  requires(Capacity != 0 || std::same_as<Policy, policy::Locked>)
+Channel<T, typename detail::CoreFor<T, Capacity, Policy, Wait>::type>
+CreateChannel(std::allocator_arg_t, const Alloc &alloc, Args &&...args) {
+  using Impl = typename detail::CoreFor<T, Capacity, Policy, Wait>::type;
+  // `std::pmr::polymorphic_allocator` hands itself to the cores that take an
+  // allocator when it constructs them.
+  return Channel<T, Impl>(
+      std::allocate_shared<Impl>(alloc, std::forward<Args>(args)...));
+}
+
+/**
+ *  @brief Same as `CreateChannel<T, chx::policy::Unbounded>()`, but the core
+ *  is allocated with `alloc`. A `std::pmr::polymorphic_allocator` also
+ *  serves its segments, so the backlog grows inside the arena.
+ * */
+template <typename T, typename Policy, typename Alloc>
+  requires std::same_as<Policy, policy::Unbounded>
+Channel<T, unbounded::Channel<T>> CreateChannel(std::allocator_arg_t,
+                                                const Alloc &alloc) {
+  return Channel<T, unbounded::Channel<T>>(
+      std::allocate_shared<unbounded::Channel<T>>(alloc));
+}
+
+/**
+ *  @brief Creates a broadcast channel, whose ring stores `Capacity` messages
+ *  received by every subscriber (see `broadcast::Channel`). Subscribers are
+ *  made with `subscribe()` on the returned sender, and receive the messages
+ *  sent after that.
+ * */
+template <typename T, std::size_t Capacity>
+broadcast::Sender<T, Capacity> CreateBroadcastChannel() {
+  return broadcast::Sender<T, Capacity>(
+      std::make_shared<broadcast::Channel<T, Capacity>>());
+}
+
+/**
+ *  @brief Same as `CreateBroadcastChannel<T, Capacity>()`, but the channel
+ *  and its ring are allocated with `alloc`.
+ * */
+template <typename T, std::size_t Capacity, typename Alloc>
+broadcast::Sender<T, Capacity> CreateBroadcastChannel(std::allocator_arg_t,
+                                                      const Alloc &alloc) {
+  return broadcast::Sender<T, Capacity>(
+      std::allocate_shared<broadcast::Channel<T, Capacity>>(alloc));
 }
 
 } // namespace chx
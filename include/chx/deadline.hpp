@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <mutex>
+
+namespace chx {
+
+/**
+ *  @brief Absolute point in time at which a timed operation gives up.
+ * */
+using Deadline = std::chrono::steady_clock::time_point;
+
+/**
+ *  @brief Deadline of the operations that wait forever.
+ * */
+inline constexpr Deadline no_deadline = Deadline::max();
+
+namespace detail {
+
+/**
+ *  @returns The deadline that expires after `timeout`, saturated to
+ *  `no_deadline`.
+ * */
+template <typename Rep, typename Period>
+Deadline deadline_after(const std::chrono::duration<Rep, Period> &timeout) {
+  const auto now = std::chrono::steady_clock::now();
+  const auto step = std::chrono::ceil<Deadline::duration>(timeout);
+  if (step > no_deadline - now) {
+    return no_deadline;
+  }
+  return now + step;
+}
+
+/**
+ *  @returns `deadline` as a `Deadline`, converting it from its own clock if
+ *  needed.
+ * */
+template <typename Clock, typename Duration>
+Deadline to_deadline(const std::chrono::time_point<Clock, Duration> &deadline) {
+  if constexpr (std::same_as<Clock, std::chrono::steady_clock>) {
+    return std::chrono::ceil<Deadline::duration>(deadline);
+  } else {
+    return deadline_after(deadline - Clock::now());
+  }
+}
+
+/**
+ *  @brief Waits on `cv` until `ready` holds or `deadline` expires.
+ *  @returns The last value of `ready`.
+ * */
+template <typename Predicate>
+bool wait_until(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+                Deadline deadline, Predicate ready) {
+  if (deadline == no_deadline) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_until(lock, deadline, ready);
+}
+
+} // namespace detail
+} // namespace chx
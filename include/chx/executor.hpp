@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace chx {
+
+/**
+ *  @brief Runs the tasks posted to it. Coroutines suspended on a channel are
+ *  resumed through an executor once the channel can serve them.
+ * */
+class Executor {
+public:
+  virtual ~Executor() = default;
+
+  /**
+   *  @brief Schedules `task` to be run. It must not run `task` inside `post`,
+   *  since the caller may hold a channel lock.
+   * */
+  virtual void post(std::function<void()> task) = 0;
+};
+
+/**
+ *  @brief Executor that runs the posted tasks on a fixed set of threads. On
+ *  destruction, the tasks already posted are run before the threads exit.
+ * */
+class ThreadPoolExecutor final : public Executor {
+public:
+  explicit ThreadPoolExecutor(
+      std::size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+    this->threads_.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++) {
+      this->threads_.emplace_back([this] { this->work(); });
+    }
+  }
+
+  ~ThreadPoolExecutor() {
+    {
+      std::lock_guard lock(this->mutex_);
+      this->stopping_ = true;
+    }
+    this->not_empty_.notify_all();
+    for (auto &thread : this->threads_) {
+      thread.join();
+    }
+  }
+
+  ThreadPoolExecutor(const ThreadPoolExecutor &) = delete;
+  ThreadPoolExecutor &operator=(const ThreadPoolExecutor &) = delete;
+
+  void post(std::function<void()> task) override {
+    {
+      std::lock_guard lock(this->mutex_);
+      this->tasks_.push_back(std::move(task));
+    }
+    this->not_empty_.notify_one();
+  }
+
+  /**
+   *  @returns The number of threads of the pool.
+   * */
+  std::size_t size() const { return this->threads_.size(); }
+
+private:
+  void work() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock lock(this->mutex_);
+        this->not_empty_.wait(
+            lock, [&] { return !this->tasks_.empty() || this->stopping_; });
+        if (this->tasks_.empty()) {
+          return;
+        }
+        task = std::move(this->tasks_.front());
+        this->tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+/**
+ *  @returns The executor used by the `async_*` operations when none is
+ *  given: a thread pool with one thread per hardware thread, created on first
+ *  use.
+ * */
+inline Executor &default_executor() {
+  static ThreadPoolExecutor executor;
+  return executor;
+}
+
+} // namespace chx
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "chx/deadline.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace chx::detail {
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t) &&
+                  std::atomic<std::uint32_t>::is_always_lock_free,
+              "futex words must be plain 32 bit integers");
+
+/**
+ *  @brief Who may wait on a futex word. `local` words are only used by the
+ *  threads of this process, which lets the kernel skip the lookup of the
+ *  backing page. `shared` words live in memory mapped by several processes.
+ * */
+enum class FutexScope : std::uint8_t { local, shared };
+
+#if defined(__linux__)
+/**
+ *  @returns The futex operation `op` for words of `scope`.
+ * */
+constexpr int futex_op(int op, FutexScope scope) {
+  return scope == FutexScope::local ? op | FUTEX_PRIVATE_FLAG : op;
+}
+#endif
+
+/**
+ *  @brief Blocks the calling thread while `word` holds `expected`, until it is
+ *  woken by `futex_wake`, or `deadline` expires. It may also return
+ *  spuriously, so callers must check their condition again.
+ * */
+inline void futex_wait(std::atomic<std::uint32_t> &word,
+                       std::uint32_t expected, Deadline deadline,
+                       FutexScope scope = FutexScope::local) {
+#if defined(__linux__)
+  auto *address = reinterpret_cast<std::uint32_t *>(&word);
+  if (deadline == no_deadline) {
+    ::syscall(SYS_futex, address, futex_op(FUTEX_WAIT, scope), expected,
+              nullptr, nullptr, 0);
+    return;
+  }
+  // steady_clock is CLOCK_MONOTONIC, the clock of FUTEX_WAIT_BITSET.
+  const auto since_epoch = deadline.time_since_epoch();
+  const auto seconds = std::chrono::floor<std::chrono::seconds>(since_epoch);
+  timespec timeout{};
+  timeout.tv_sec = static_cast<std::time_t>(seconds.count());
+  timeout.tv_nsec = static_cast<long>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch -
+                                                           seconds)
+          .count());
+  ::syscall(SYS_futex, address, futex_op(FUTEX_WAIT_BITSET, scope), expected,
+            &timeout, nullptr, FUTEX_BITSET_MATCH_ANY);
+#else
+  (void)scope;
+  if (deadline == no_deadline) {
+    word.wait(expected, std::memory_order_acquire);
+    return;
+  }
+  while (word.load(std::memory_order_acquire) == expected &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+#endif
+}
+
+/**
+ *  @brief Wakes up to `count` threads blocked in `futex_wait` on `word`.
+ * */
+inline void futex_wake(std::atomic<std::uint32_t> &word, int count,
+                       FutexScope scope = FutexScope::local) {
+#if defined(__linux__)
+  ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word),
+            futex_op(FUTEX_WAKE, scope), count, nullptr, nullptr, 0);
+#else
+  (void)scope;
+  if (count == 1) {
+    word.notify_one();
+  } else {
+    word.notify_all();
+  }
+#endif
+}
+
+inline void futex_wake_all(std::atomic<std::uint32_t> &word,
+                           FutexScope scope = FutexScope::local) {
+#if defined(__linux__)
+  futex_wake(word, INT_MAX, scope);
+#else
+  (void)scope;
+  word.notify_all();
+#endif
+}
+
+} // namespace chx::detail
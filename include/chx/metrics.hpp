@@ -0,0 +1,177 @@
+#pragma once
+
+#include "chx/cache_line.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace chx {
+
+/**
+ *  @brief True when the channels keep the counters of `ChannelMetrics`. They
+ *  are compiled in by defining `CHX_ENABLE_METRICS` (the same way in every
+ *  translation unit), for example with the CMake option of the same name.
+ * */
+#if defined(CHX_ENABLE_METRICS)
+inline constexpr bool metrics_enabled = true;
+#else
+inline constexpr bool metrics_enabled = false;
+#endif
+
+/**
+ *  @brief Snapshot of what happened on a channel since it was created. Only
+ *  `depth` is filled in when `metrics_enabled` is false.
+ * */
+struct ChannelMetrics {
+  /// Objects that went through the channel.
+  std::uint64_t sends = 0;
+  std::uint64_t receives = 0;
+  /// Operations that had to wait for room (or for an object), and the total
+  /// time they waited.
+  std::uint64_t blocked_sends = 0;
+  std::uint64_t blocked_receives = 0;
+  std::chrono::nanoseconds send_blocked_time{0};
+  std::chrono::nanoseconds receive_blocked_time{0};
+  /// `try_*` operations that failed because they would have blocked.
+  std::uint64_t try_send_failures = 0;
+  std::uint64_t try_receive_failures = 0;
+  /// Objects stored when the snapshot was taken, and the most ever stored.
+  std::size_t depth = 0;
+  std::size_t high_water = 0;
+  /// Calls to `close`.
+  std::uint64_t closes = 0;
+};
+
+namespace detail {
+
+/**
+ *  @brief Side of the channel an operation is on.
+ * */
+enum class Side : std::uint8_t { send, receive };
+
+#if defined(CHX_ENABLE_METRICS)
+
+/**
+ *  @brief Counters of a channel core. They are relaxed atomics, and the send
+ *  and receive sides live in different cache lines, so recording an event
+ *  never makes both sides contend.
+ * */
+class MetricsRecorder {
+public:
+  /**
+   *  @brief Measures the time a blocked operation waits, from its creation to
+   *  its destruction.
+   * */
+  class BlockTimer {
+  public:
+    BlockTimer(MetricsRecorder &recorder, Side side)
+        : recorder_(recorder), side_(side),
+          start_(std::chrono::steady_clock::now()) {}
+    ~BlockTimer() {
+      this->recorder_.blocked(this->side_,
+                              std::chrono::steady_clock::now() - this->start_);
+    }
+    BlockTimer(const BlockTimer &) = delete;
+    BlockTimer &operator=(const BlockTimer &) = delete;
+
+  private:
+    MetricsRecorder &recorder_;
+    Side side_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  /**
+   *  @brief Records `count` objects sent, leaving `depth` objects stored.
+   * */
+  void sent(std::size_t count, std::size_t depth) {
+    this->send_.operations.fetch_add(count, std::memory_order_relaxed);
+    std::size_t high = this->send_.high_water.load(std::memory_order_relaxed);
+    while (depth > high && !this->send_.high_water.compare_exchange_weak(
+                               high, depth, std::memory_order_relaxed)) {
+    }
+  }
+
+  void received(std::size_t count) {
+    this->receive_.operations.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  void try_failed(Side side) {
+    this->counters(side).try_failures.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void blocked(Side side, std::chrono::steady_clock::duration time) {
+    Counters &counters = this->counters(side);
+    counters.blocked.fetch_add(1, std::memory_order_relaxed);
+    counters.blocked_ns.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(),
+        std::memory_order_relaxed);
+  }
+
+  void closed() { this->closes_.fetch_add(1, std::memory_order_relaxed); }
+
+  BlockTimer block(Side side) { return BlockTimer(*this, side); }
+
+  ChannelMetrics snapshot() const {
+    ChannelMetrics metrics;
+    metrics.sends = this->send_.operations.load(std::memory_order_relaxed);
+    metrics.receives =
+        this->receive_.operations.load(std::memory_order_relaxed);
+    metrics.blocked_sends = this->send_.blocked.load(std::memory_order_relaxed);
+    metrics.blocked_receives =
+        this->receive_.blocked.load(std::memory_order_relaxed);
+    metrics.send_blocked_time = std::chrono::nanoseconds(
+        this->send_.blocked_ns.load(std::memory_order_relaxed));
+    metrics.receive_blocked_time = std::chrono::nanoseconds(
+        this->receive_.blocked_ns.load(std::memory_order_relaxed));
+    metrics.try_send_failures =
+        this->send_.try_failures.load(std::memory_order_relaxed);
+    metrics.try_receive_failures =
+        this->receive_.try_failures.load(std::memory_order_relaxed);
+    metrics.high_water =
+        this->send_.high_water.load(std::memory_order_relaxed);
+    metrics.closes = this->closes_.load(std::memory_order_relaxed);
+    return metrics;
+  }
+
+private:
+  struct alignas(cache_line_size) Counters {
+    std::atomic<std::uint64_t> operations{0};
+    std::atomic<std::uint64_t> blocked{0};
+    std::atomic<std::int64_t> blocked_ns{0};
+    std::atomic<std::uint64_t> try_failures{0};
+    std::atomic<std::size_t> high_water{0};
+  };
+
+  Counters &counters(Side side) {
+    return side == Side::send ? this->send_ : this->receive_;
+  }
+
+  Counters send_;
+  Counters receive_;
+  std::atomic<std::uint64_t> closes_{0};
+};
+
+#else
+
+/**
+ *  @brief Counters of a channel core, compiled out: every call is empty.
+ * */
+class MetricsRecorder {
+public:
+  struct BlockTimer {};
+
+  void sent(std::size_t, std::size_t) {}
+  void received(std::size_t) {}
+  void try_failed(Side) {}
+  void blocked(Side, std::chrono::steady_clock::duration) {}
+  void closed() {}
+  BlockTimer block(Side) { return {}; }
+  ChannelMetrics snapshot() const { return {}; }
+};
+
+#endif
+
+} // namespace detail
+} // namespace chx
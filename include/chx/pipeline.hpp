@@ -0,0 +1,371 @@
+#pragma once
+
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/executor.hpp"
+#include "chx/wait_group.hpp"
+#include "chx/waiter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+/**
+ *  @brief Pipeline stages between channels. Every stage reads from
+ *  `ReceiverChannel` endpoints and writes into `SenderChannel` endpoints, with
+ *  a number of parallel workers. Workers are coroutines run by an `Executor`
+ *  (the shared `default_executor()` unless told otherwise), so a parked
+ *  worker holds no thread, and any number of stages share one pool.
+ *
+ *  Closing flows in both directions:
+ *  - When the input of a stage is closed and its workers finish, the stage
+ *    closes its outputs, once receivers took everything stored in them.
+ *  - When an output of a stage is closed, the stage closes its input, so
+ *    the stages upstream stop too.
+ *
+ *  Since closing a channel drops the objects it stores, a pipeline should be
+ *  fed with `source`, which also waits for its output to drain. The channels
+ *  between stages may be buffered or unbuffered: on an unbuffered channel,
+ *  each worker hands its objects over to a worker of the next stage.
+ * */
+namespace chx::pipeline {
+
+/**
+ *  @brief How a stage runs.
+ * */
+struct Options {
+  /// Number of parallel workers. Stages that keep the order of their objects
+  /// need a single one.
+  std::size_t workers = 1;
+  /// Executor that runs the workers. `nullptr` means `default_executor()`.
+  Executor *executor = nullptr;
+
+  Executor &get_executor() const {
+    return this->executor != nullptr ? *this->executor : default_executor();
+  }
+};
+
+namespace detail {
+
+/**
+ *  @brief Coroutine that is started by posting it to an executor, and frees
+ *  itself when it finishes.
+ * */
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+inline void spawn(Detached task, Executor &executor) {
+  executor.post([handle = task.handle] { handle.resume(); });
+}
+
+/**
+ *  @brief Closes a channel once it stores nothing. It listens to the channel
+ *  as a `Waiter`, and checks its size from the executor every time a receiver
+ *  frees a slot.
+ * */
+template <typename T>
+class DrainCloser final : public Waiter,
+                          public std::enable_shared_from_this<DrainCloser<T>> {
+public:
+  static void start(std::shared_ptr<ChannelCore<T>> core,
+                    Executor &executor) {
+    auto closer = std::shared_ptr<DrainCloser>(
+        new DrainCloser(std::move(core), executor));
+    // Kept alive by itself until the channel is closed.
+    closer->self_ = closer;
+    closer->core_->add_waiter(*closer);
+    closer->notify(WaitEvent::writable);
+  }
+
+  void notify(WaitEvent) override {
+    if (!this->scheduled_.exchange(true, std::memory_order_acq_rel)) {
+      this->executor_.post(
+          [closer = this->shared_from_this()] { closer->check(); });
+    }
+  }
+
+private:
+  DrainCloser(std::shared_ptr<ChannelCore<T>> core, Executor &executor)
+      : core_(std::move(core)), executor_(executor) {}
+
+  void check() {
+    this->scheduled_.store(false, std::memory_order_release);
+    const bool closed = this->core_->is_closed();
+    if (this->core_->size() != 0 && !closed) {
+      return;
+    }
+    if (this->finished_.exchange(true, std::memory_order_acq_rel)) {
+      return;
+    }
+    this->core_->remove_waiter(*this);
+    if (!closed) {
+      this->core_->close();
+    }
+    this->self_.reset();
+  }
+
+  std::shared_ptr<ChannelCore<T>> core_;
+  Executor &executor_;
+  std::atomic<bool> scheduled_{false};
+  std::atomic<bool> finished_{false};
+  std::shared_ptr<DrainCloser> self_;
+};
+
+template <typename T, typename Impl>
+void close_when_drained(const SenderChannel<T, Impl> &channel,
+                        Executor &executor) {
+  DrainCloser<T>::start(chx::detail::HandleAccess::core(channel), executor);
+}
+
+/**
+ *  @brief Counts the running workers of a stage. The last one to finish
+ *  closes the outputs of the stage once they are drained.
+ * */
+template <typename Out, typename OutImpl>
+std::shared_ptr<WaitGroup>
+stage_group(std::size_t workers,
+            std::vector<SenderChannel<Out, OutImpl>> outputs,
+            Executor &executor) {
+  auto group = std::make_shared<WaitGroup>();
+  group->add(static_cast<std::uint32_t>(workers));
+  group->when_done([outputs = std::move(outputs), &executor] {
+    for (const auto &output : outputs) {
+      close_when_drained(output, executor);
+    }
+  });
+  return group;
+}
+
+/**
+ *  @brief Worker of the one-input, one-output stages: receives every object
+ *  of `in`, and sends what `step` makes of it (if anything) to `out`.
+ * */
+template <typename In, typename InImpl, typename Out, typename OutImpl,
+          typename Step>
+Detached forward(ReceiverChannel<In, InImpl> in,
+                 SenderChannel<Out, OutImpl> out, std::shared_ptr<Step> step,
+                 std::shared_ptr<WaitGroup> group, Executor &executor) {
+  for (;;) {
+    auto value = co_await in.async_receive(executor);
+    if (!value.has_value()) {
+      break;
+    }
+    std::optional<Out> result = (*step)(std::move(*value));
+    if (!result.has_value()) {
+      continue;
+    }
+    auto sent = co_await out.async_send(std::move(*result), executor);
+    if (!sent.has_value()) {
+      in.close();
+      break;
+    }
+  }
+  group->done();
+}
+
+template <typename In, typename InImpl, typename Out, typename OutImpl,
+          typename Step>
+void run_forward(std::vector<ReceiverChannel<In, InImpl>> inputs,
+                 SenderChannel<Out, OutImpl> out, Step step,
+                 const Options &options) {
+  Executor &executor = options.get_executor();
+  const std::size_t workers = std::max<std::size_t>(options.workers, 1);
+  auto group = stage_group(workers * inputs.size(),
+                           std::vector<SenderChannel<Out, OutImpl>>{out},
+                           executor);
+  auto shared_step = std::make_shared<Step>(std::move(step));
+  for (const auto &in : inputs) {
+    for (std::size_t i = 0; i < workers; i++) {
+      spawn(forward(in, out, shared_step, group, executor), executor);
+    }
+  }
+}
+
+template <std::ranges::input_range Range, typename T, typename Impl>
+Detached feed(Range values, SenderChannel<T, Impl> out, Executor &executor) {
+  for (auto &&value : values) {
+    auto sent =
+        co_await out.async_send(T(std::forward<decltype(value)>(value)),
+                                executor);
+    if (!sent.has_value()) {
+      co_return;
+    }
+  }
+  close_when_drained(out, executor);
+}
+
+template <typename T, typename InImpl, typename OutImpl>
+Detached batch_worker(ReceiverChannel<T, InImpl> in,
+                      SenderChannel<std::vector<T>, OutImpl> out,
+                      std::size_t size, std::shared_ptr<WaitGroup> group,
+                      Executor &executor) {
+  std::vector<T> batch;
+  batch.reserve(size);
+  for (;;) {
+    auto value = co_await in.async_receive(executor);
+    const bool closed = !value.has_value();
+    if (!closed) {
+      batch.push_back(std::move(*value));
+    }
+    if (batch.size() == size || (closed && !batch.empty())) {
+      auto sent = co_await out.async_send(std::move(batch), executor);
+      batch = {};
+      batch.reserve(size);
+      if (!sent.has_value()) {
+        in.close();
+        break;
+      }
+    }
+    if (closed) {
+      break;
+    }
+  }
+  group->done();
+}
+
+template <typename T, typename InImpl, typename OutImpl>
+Detached fan_out_worker(ReceiverChannel<T, InImpl> in,
+                        std::vector<SenderChannel<T, OutImpl>> outputs,
+                        std::size_t next, std::shared_ptr<WaitGroup> group,
+                        Executor &executor) {
+  for (;;) {
+    auto value = co_await in.async_receive(executor);
+    if (!value.has_value()) {
+      break;
+    }
+    auto &out = outputs[next];
+    next = (next + 1) % outputs.size();
+    auto sent = co_await out.async_send(std::move(*value), executor);
+    if (!sent.has_value()) {
+      in.close();
+      break;
+    }
+  }
+  group->done();
+}
+
+} // namespace detail
+
+/**
+ *  @brief Sends every object of `values` to `out`, and closes `out` once
+ *  they were all received.
+ * */
+template <std::ranges::input_range Range, typename T, typename Impl>
+  requires std::constructible_from<T, std::ranges::range_reference_t<Range>>
+void source(Range values, SenderChannel<T, Impl> out,
+            const Options &options = {}) {
+  Executor &executor = options.get_executor();
+  detail::spawn(detail::feed(std::move(values), std::move(out), executor),
+                executor);
+}
+
+/**
+ *  @brief Sends `f(value)` to `out` for every `value` received from `in`.
+ * */
+template <typename In, typename InImpl, typename Out, typename OutImpl,
+          typename F>
+  requires std::invocable<F &, In &&> &&
+           std::constructible_from<Out, std::invoke_result_t<F &, In &&>>
+void map(ReceiverChannel<In, InImpl> in, SenderChannel<Out, OutImpl> out, F f,
+         const Options &options = {}) {
+  detail::run_forward(
+      std::vector<ReceiverChannel<In, InImpl>>{std::move(in)}, std::move(out),
+      [f = std::move(f)](In &&value) mutable {
+        return std::optional<Out>(std::invoke(f, std::move(value)));
+      },
+      options);
+}
+
+/**
+ *  @brief Sends to `out` the objects received from `in` that satisfy
+ *  `predicate`.
+ * */
+template <typename T, typename InImpl, typename OutImpl, typename Predicate>
+  requires std::predicate<Predicate &, const T &>
+void filter(ReceiverChannel<T, InImpl> in, SenderChannel<T, OutImpl> out,
+            Predicate predicate, const Options &options = {}) {
+  detail::run_forward(
+      std::vector<ReceiverChannel<T, InImpl>>{std::move(in)}, std::move(out),
+      [predicate = std::move(predicate)](T &&value) mutable {
+        if (!std::invoke(predicate, std::as_const(value))) {
+          return std::optional<T>();
+        }
+        return std::optional<T>(std::move(value));
+      },
+      options);
+}
+
+/**
+ *  @brief Groups the objects received from `in` into vectors of `size`
+ *  objects, and sends them to `out`. Each worker fills its own batches; the
+ *  last one may be smaller.
+ * */
+template <typename T, typename InImpl, typename OutImpl>
+void batch(ReceiverChannel<T, InImpl> in,
+           SenderChannel<std::vector<T>, OutImpl> out, std::size_t size,
+           const Options &options = {}) {
+  Executor &executor = options.get_executor();
+  const std::size_t workers = std::max<std::size_t>(options.workers, 1);
+  auto group = detail::stage_group(
+      workers, std::vector<SenderChannel<std::vector<T>, OutImpl>>{out},
+      executor);
+  for (std::size_t i = 0; i < workers; i++) {
+    detail::spawn(detail::batch_worker(in, out, std::max<std::size_t>(size, 1),
+                                       group, executor),
+                  executor);
+  }
+}
+
+/**
+ *  @brief Spreads the objects received from `in` over `outputs`, in turns.
+ * */
+template <typename T, typename InImpl, typename OutImpl>
+void fan_out(ReceiverChannel<T, InImpl> in,
+             std::vector<SenderChannel<T, OutImpl>> outputs,
+             const Options &options = {}) {
+  if (outputs.empty()) {
+    return;
+  }
+  Executor &executor = options.get_executor();
+  const std::size_t workers = std::max<std::size_t>(options.workers, 1);
+  auto group = detail::stage_group(workers, outputs, executor);
+  for (std::size_t i = 0; i < workers; i++) {
+    detail::spawn(detail::fan_out_worker(in, outputs, i % outputs.size(),
+                                         group, executor),
+                  executor);
+  }
+}
+
+/**
+ *  @brief Merges the objects received from every channel of `inputs` into
+ *  `out`, with `options.workers` workers per input. `out` is closed once all
+ *  the inputs are.
+ * */
+template <typename T, typename InImpl, typename OutImpl>
+void fan_in(std::vector<ReceiverChannel<T, InImpl>> inputs,
+            SenderChannel<T, OutImpl> out, const Options &options = {}) {
+  detail::run_forward(
+      std::move(inputs), std::move(out),
+      [](T &&value) { return std::optional<T>(std::move(value)); }, options);
+}
+
+} // namespace chx::pipeline
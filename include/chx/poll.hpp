@@ -0,0 +1,111 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include "chx/channel.hpp"
+#include "chx/channelCore.hpp"
+#include "chx/waiter.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace chx {
+
+/**
+ *  @brief Exposes a channel to an `epoll` or `io_uring` event loop: an
+ *  eventfd that becomes readable when a receive (or, with
+ *  `WaitEvent::writable`, a send) on the channel may have become possible.
+ *
+ *  Notifications are coalesced: once the eventfd is signalled, the channel
+ *  does not touch it again until the loop calls `rearm`, so a burst of sends
+ *  costs a single `write` and a single wakeup. On readiness the loop calls
+ *  `rearm` first, and then drains the channel with `try_receive` until it
+ *  fails with `Error::would_block`:
+ *
+ *      chx::PollHandle poll(rx);
+ *      // epoll_ctl(epoll, EPOLL_CTL_ADD, poll.fd(), ...)
+ *      // on EPOLLIN:
+ *      poll.rearm();
+ *      while (auto v = rx.try_receive()) { use(*v); }
+ *
+ *  Wakeups may be spurious, and the eventfd starts signalled so that objects
+ *  sent before the handle was created are not missed. It works with every
+ *  channel core, through the same hook as `select`; the shared memory
+ *  channel only signals the operations made by this process.
+ * */
+template <typename T> class PollHandle final : public Waiter {
+public:
+  /**
+   *  @param handle The channel to watch (a `Channel`, `SenderChannel` or
+   *  `ReceiverChannel`). The poll handle keeps its core alive, but does not
+   *  count as a sender or a receiver.
+   *  @param events What to wait for: `WaitEvent::readable`,
+   *  `WaitEvent::writable`, or both (`WaitEvent::closed`). Closing the
+   *  channel always signals the eventfd.
+   *  @throws std::system_error if the eventfd could not be created.
+   * */
+  template <typename Handle>
+  explicit PollHandle(Handle &handle, WaitEvent events = WaitEvent::readable)
+      : core_(detail::HandleAccess::core(handle)), events_(events) {
+    this->fd_ = ::eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (this->fd_ < 0) {
+      throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+    this->core_->add_waiter(*this);
+  }
+
+  ~PollHandle() {
+    // No notification runs once the waiter is removed.
+    this->core_->remove_waiter(*this);
+    ::close(this->fd_);
+  }
+
+  PollHandle(const PollHandle &) = delete;
+  PollHandle &operator=(const PollHandle &) = delete;
+
+  /**
+   *  @returns The eventfd to register in the event loop, for reading.
+   * */
+  int fd() const { return this->fd_; }
+
+  /**
+   *  @brief Consumes the pending signal, so that the eventfd stops being
+   *  readable, and lets the next channel operation signal it again. Call it
+   *  before draining the channel: an operation racing with the drain then
+   *  either is seen by it, or signals the eventfd.
+   * */
+  void rearm() {
+    std::uint64_t count;
+    [[maybe_unused]] auto consumed = ::read(this->fd_, &count, sizeof(count));
+    this->armed_.store(true, std::memory_order_seq_cst);
+  }
+
+  void notify(WaitEvent event) override {
+    if (!has_event(event, this->events_) ||
+        !this->armed_.exchange(false, std::memory_order_seq_cst)) {
+      return;
+    }
+    const std::uint64_t one = 1;
+    [[maybe_unused]] auto written = ::write(this->fd_, &one, sizeof(one));
+  }
+
+private:
+  std::shared_ptr<ChannelCore<T>> core_;
+  WaitEvent events_;
+  int fd_ = -1;
+  // False while a signal is pending on the eventfd.
+  std::atomic<bool> armed_{false};
+};
+
+template <typename Handle>
+PollHandle(Handle &, WaitEvent = WaitEvent::readable)
+    -> PollHandle<typename Handle::value_type>;
+
+} // namespace chx
+
+#endif
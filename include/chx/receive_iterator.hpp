@@ -0,0 +1,261 @@
+#pragma once
+
+#include "chx/channelCore.hpp"
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <expected>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace chx {
+
+/**
+ *  @brief Number of objects a `ReceiveIterator` takes from the channel at
+ *  once.
+ * */
+inline constexpr std::size_t receive_batch_size = 32;
+
+namespace detail {
+
+/**
+ *  @brief Objects that a `ReceiveIterator` took from the channel, and that
+ *  the loop did not reach yet. It is kept by the receiving handle, so the
+ *  objects outlive the loop: the next loop, and every receive operation of
+ *  the handle, take them first.
+ *
+ *  A copy of the handle starts with an empty buffer, and assigning a handle
+ *  drops the objects of its buffer. Moving takes them along, but `Channel`
+ *  and `ReceiverChannel` have no move constructor: moving them copies.
+ * */
+template <typename T> class ReceiveBuffer {
+public:
+  ReceiveBuffer() = default;
+  ReceiveBuffer(const ReceiveBuffer &) {}
+  ReceiveBuffer(ReceiveBuffer &&other) noexcept
+      : batch_(std::move(other.batch_)),
+        position_(std::exchange(other.position_, 0)),
+        count_(std::exchange(other.count_, 0)) {}
+  ReceiveBuffer &operator=(const ReceiveBuffer &other) {
+    if (this != &other) {
+      this->position_ = this->count_ = 0;
+    }
+    return *this;
+  }
+  ReceiveBuffer &operator=(ReceiveBuffer &&other) noexcept {
+    if (this != &other) {
+      this->batch_ = std::move(other.batch_);
+      this->position_ = std::exchange(other.position_, 0);
+      this->count_ = std::exchange(other.count_, 0);
+    }
+    return *this;
+  }
+
+  bool empty() const { return this->position_ == this->count_; }
+
+  T &front() {
+    if constexpr (batched) {
+      return this->batch_[this->position_];
+    } else {
+      return *this->batch_;
+    }
+  }
+
+  void pop_front() { this->position_++; }
+
+  /**
+   *  @returns The object removed last by `pop_front`. It stays valid until
+   *  the next `refill`.
+   * */
+  T &back() {
+    if constexpr (batched) {
+      return this->batch_[this->position_ - 1];
+    } else {
+      return *this->batch_;
+    }
+  }
+
+  T take_front() {
+    T value = std::move(this->front());
+    this->pop_front();
+    return value;
+  }
+
+  /**
+   *  @brief Waits for the next objects: a whole batch with one
+   *  `receive_many` call, which takes the objects already stored under a
+   *  single lock. Types that are not default constructible can not fill a
+   *  batch, so they are received one by one.
+   *  @returns False once the channel is closed.
+   * */
+  template <typename Core> bool refill(Core &core) {
+    this->position_ = this->count_ = 0;
+    if constexpr (batched) {
+      if (this->batch_ == nullptr) {
+        this->batch_ = std::make_unique<T[]>(receive_batch_size);
+      }
+      auto received = core.receive_many(
+          std::span<T>(this->batch_.get(), receive_batch_size), 1,
+          receive_batch_size);
+      this->count_ = received.value_or(0);
+    } else {
+      auto received = core.receive();
+      if (received.has_value()) {
+        this->batch_.emplace(std::move(*received));
+        this->count_ = 1;
+      }
+    }
+    return this->count_ != 0;
+  }
+
+  /**
+   *  @returns The first object, if the buffer has one, or else the result of
+   *  `receive`.
+   * */
+  template <typename Receive>
+  std::expected<T, Error> take_or(Receive receive) {
+    if (!this->empty()) {
+      return this->take_front();
+    }
+    return receive();
+  }
+
+  /**
+   *  @brief Like `ChannelCore::receive_many`, but the objects of the buffer
+   *  come first. The channel is only asked for the ones still missing to
+   *  reach `min`.
+   * */
+  template <typename Core>
+  std::expected<std::size_t, Error> receive_many(Core &core, std::span<T> out,
+                                                 std::size_t min,
+                                                 std::size_t max) {
+    out = out.first(std::min(out.size(), max));
+    const std::size_t taken = this->take(out);
+    if (taken == 0) {
+      return core.receive_many(out, min, max);
+    }
+    if (taken >= min || taken == out.size()) {
+      return taken;
+    }
+    return taken + core.receive_many(out.subspan(taken), min - taken,
+                                     max - taken)
+                       .value_or(0);
+  }
+
+  /**
+   *  @brief Like `ChannelCore::try_receive_many`, but the objects of the
+   *  buffer come first.
+   * */
+  template <typename Core>
+  std::expected<std::size_t, Error> try_receive_many(Core &core,
+                                                     std::span<T> out) {
+    const std::size_t taken = this->take(out);
+    if (taken == 0) {
+      return core.try_receive_many(out);
+    }
+    return taken + core.try_receive_many(out.subspan(taken)).value_or(0);
+  }
+
+private:
+  static constexpr bool batched = std::default_initializable<T>;
+
+  /**
+   *  @brief Moves the first objects of the buffer into `out`.
+   *  @returns How many were moved.
+   * */
+  std::size_t take(std::span<T> out) {
+    std::size_t taken = 0;
+    while (taken < out.size() && !this->empty()) {
+      out[taken++] = this->take_front();
+    }
+    return taken;
+  }
+
+  std::conditional_t<batched, std::unique_ptr<T[]>, std::optional<T>> batch_;
+  std::size_t position_ = 0;
+  std::size_t count_ = 0;
+};
+
+} // namespace detail
+
+/**
+ *  @brief Input iterator over the objects received from a channel, until it
+ *  is closed. It makes the receiving handles model
+ *  `std::ranges::input_range`:
+ *
+ *  ``` cpp
+ *  for (auto &&value : rx) { ... }
+ *  ```
+ *
+ *  Objects are taken in batches, with one lock acquisition each, into a
+ *  buffer kept by the handle (see `detail::ReceiveBuffer`). Leaving the loop
+ *  early (`break`, `std::views::take`) leaves the objects not iterated over
+ *  in that buffer, where the next loop or receive operation of the same
+ *  handle finds them. Other handles, `select`, `acquire`, and `size()` do
+ *  not see them, and they are lost if the handle is destroyed. As a loop
+ *  fills the buffer of its handle, a handle being iterated must not be used
+ *  by other threads: give each thread its own copy.
+ *
+ *  Dereferencing gives a mutable reference, so the value can be moved out.
+ *  The iterator points into its handle, which must outlive it.
+ * */
+template <typename T, typename Impl> class ReceiveIterator {
+public:
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+
+  ReceiveIterator() = default;
+  ReceiveIterator(Impl *core, detail::ReceiveBuffer<T> *buffer)
+      : core_(core), buffer_(buffer) {}
+
+  ReceiveIterator(ReceiveIterator &&) = default;
+  ReceiveIterator &operator=(ReceiveIterator &&) = default;
+
+  /**
+   *  @brief Takes the current object out of the buffer, so a loop left right
+   *  after reading it does not see it again.
+   * */
+  T &operator*() const {
+    if (!this->held_ && this->fetch()) {
+      this->buffer_->pop_front();
+      this->held_ = true;
+    }
+    return this->buffer_->back();
+  }
+
+  ReceiveIterator &operator++() {
+    if (this->held_) {
+      this->held_ = false;
+    } else if (this->fetch()) {
+      this->buffer_->pop_front();
+    }
+    return *this;
+  }
+  void operator++(int) { ++*this; }
+
+  friend bool operator==(const ReceiveIterator &it, std::default_sentinel_t) {
+    return !it.held_ && !it.fetch();
+  }
+
+private:
+  /**
+   *  @brief Waits for the current object, unless the buffer has it already.
+   *  Receiving is deferred to the first comparison or dereference, so an
+   *  iterator that is never compared again does not wait.
+   *  @returns False once the channel is closed.
+   * */
+  bool fetch() const {
+    return !this->buffer_->empty() || this->buffer_->refill(*this->core_);
+  }
+
+  Impl *core_ = nullptr;
+  detail::ReceiveBuffer<T> *buffer_ = nullptr;
+  // The current object was dereferenced, and already left the buffer.
+  mutable bool held_ = false;
+};
+
+} // namespace chx
@@ -0,0 +1,415 @@
+#pragma once
+
+#include "chx/channel.hpp"
+#include "chx/channelCore.hpp"
+#include "chx/wait_node.hpp"
+#include "chx/waiter.hpp"
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <tuple>
+#include <utility>
+
+namespace chx {
+
+namespace detail {
+
+/**
+ *  @brief Waiter used by `select` to sleep until one of its channels
+ *  changes.
+ * */
+class SelectWaiter final : public Waiter {
+public:
+  void notify(WaitEvent) override {
+    {
+      std::lock_guard lock(this->mutex_);
+      this->ready_ = true;
+    }
+    this->cv_.notify_one();
+  }
+
+  void wait() {
+    std::unique_lock lock(this->mutex_);
+    this->cv_.wait(lock, [&] { return this->ready_; });
+    this->ready_ = false;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool ready_ = false;
+};
+
+/**
+ *  @brief Node that a `select` case queues in a channel core (see
+ *  `ChannelCore::start_select`). Firing it wakes the `select`.
+ * */
+template <typename T> class SelectNode final : public WaitNode<T> {
+public:
+  SelectNode() = default;
+  /// Only moved with its case, before being queued.
+  SelectNode(SelectNode &&other) { this->value = std::move(other.value); }
+
+  /**
+   *  @brief Makes the node ready to be queued again, as part of `group`.
+   * */
+  void prepare(SelectGroup &group, SelectWaiter &waiter) {
+    this->state = NodeState::waiting;
+    this->group = &group;
+    this->waiter_ = &waiter;
+  }
+
+  void wake() override { this->waiter_->notify(WaitEvent::readable); }
+
+private:
+  SelectWaiter *waiter_ = nullptr;
+};
+
+/**
+ *  @brief What the channel cases of `select` share: the core, the waiter
+ *  registration and the node queued in the core.
+ * */
+template <typename T> class ChannelCase {
+public:
+  static constexpr bool is_default = false;
+
+  void add_waiter(Waiter &waiter) {
+    this->core_->add_waiter(waiter);
+    this->waiter_ = &waiter;
+  }
+  void remove_waiter(Waiter &) {
+    if (this->waiter_ != nullptr) {
+      this->core_->remove_waiter(*this->waiter_);
+      this->waiter_ = nullptr;
+    }
+  }
+
+  /**
+   *  @brief Queues the node of the case in its core, as part of `group`.
+   *  Once queued, the core wakes the node instead of notifying the waiter.
+   * */
+  SelectStart start(SelectGroup &group, SelectWaiter &waiter) {
+    this->node_.prepare(group, waiter);
+    const SelectStart start = this->core_->start_select(this->side_,
+                                                        this->node_);
+    this->queued_ = start == SelectStart::queued;
+    if (this->queued_ && this->waiter_ != nullptr) {
+      this->remove_waiter(*this->waiter_);
+    }
+    return start;
+  }
+
+  /**
+   *  @brief Withdraws the node from its core.
+   *  @returns True if a counterpart completed it before.
+   * */
+  bool withdraw() {
+    if (!std::exchange(this->queued_, false)) {
+      return false;
+    }
+    // Takes the core mutex: the state is final once it returns.
+    this->core_->cancel_async(this->side_, this->node_);
+    return this->node_.state == NodeState::done ||
+           this->node_.state == NodeState::closed;
+  }
+
+protected:
+  ChannelCase(std::shared_ptr<ChannelCore<T>> core, Side side)
+      : core_(std::move(core)), side_(side) {}
+
+  std::shared_ptr<ChannelCore<T>> core_;
+  SelectNode<T> node_;
+
+private:
+  Side side_;
+  Waiter *waiter_ = nullptr;
+  bool queued_ = false;
+};
+
+/**
+ *  @returns A random case index in [0, count), so that no case starves when
+ *  several of them are always ready.
+ * */
+inline std::size_t select_start(std::size_t count) {
+  thread_local std::minstd_rand rng(std::random_device{}());
+  return rng() % count;
+}
+
+template <typename Tuple, typename F, std::size_t... Is>
+bool visit_case(Tuple &cases, std::size_t index, F &&f,
+                std::index_sequence<Is...>) {
+  bool result = false;
+  (void)((Is == index ? (result = f(std::get<Is>(cases)), true) : false) ||
+         ...);
+  return result;
+}
+
+template <typename Handle>
+concept ReceivingHandle = requires(Handle &handle) {
+  typename Handle::value_type;
+  handle.try_receive();
+};
+
+template <typename Handle>
+concept SendingHandle = requires(Handle &handle) {
+  typename Handle::value_type;
+  handle.try_send(std::declval<typename Handle::value_type &&>());
+};
+
+} // namespace detail
+
+/**
+ *  @brief `select` case that receives from a channel. It fires when a value
+ *  was received, or when the channel is closed.
+ * */
+template <typename T, typename Handler>
+class ReceiveCase : public detail::ChannelCase<T> {
+public:
+  ReceiveCase(std::shared_ptr<ChannelCore<T>> core, Handler handler)
+      : detail::ChannelCase<T>(std::move(core), detail::Side::receive),
+        handler_(std::move(handler)) {}
+
+  bool try_run() {
+    auto result = this->core_->try_receive();
+    if (!result.has_value() && result.error() == Error::would_block) {
+      return false;
+    }
+    std::invoke(this->handler_, std::move(result));
+    return true;
+  }
+
+  /**
+   *  @brief Calls the handler with what the counterpart of the withdrawn
+   *  node left in it.
+   * */
+  void run_fired() {
+    if (this->node_.state != detail::NodeState::done) {
+      std::invoke(this->handler_,
+                  std::expected<T, Error>(std::unexpect, Error::closed));
+      return;
+    }
+    std::invoke(this->handler_,
+                std::expected<T, Error>(std::move(*this->node_.value)));
+  }
+
+private:
+  Handler handler_;
+};
+
+/**
+ *  @brief `select` case that sends a value through a channel. It fires when
+ *  the value was sent, or when the channel is closed. The value is only
+ *  moved out if the case fires.
+ * */
+template <typename T, typename Handler>
+class SendCase : public detail::ChannelCase<T> {
+public:
+  SendCase(std::shared_ptr<ChannelCore<T>> core, T value, Handler handler)
+      : detail::ChannelCase<T>(std::move(core), detail::Side::send),
+        handler_(std::move(handler)) {
+    // Kept in the node, which carries it while it is queued.
+    this->node_.value.emplace(std::move(value));
+  }
+
+  bool try_run() {
+    auto result = this->core_->try_send(std::move(*this->node_.value));
+    if (!result.has_value() && result.error() == Error::would_block) {
+      return false;
+    }
+    std::invoke(this->handler_, std::move(result));
+    return true;
+  }
+
+  /**
+   *  @brief Calls the handler once the withdrawn node was completed.
+   * */
+  void run_fired() {
+    if (this->node_.state != detail::NodeState::done) {
+      std::invoke(this->handler_, std::expected<void, Error>(
+                                      std::unexpect, Error::closed));
+      return;
+    }
+    std::invoke(this->handler_, std::expected<void, Error>());
+  }
+
+private:
+  Handler handler_;
+};
+
+/**
+ *  @brief `select` case that fires when no other case can proceed
+ *  inmediately. With it, `select` never blocks.
+ * */
+template <typename Handler> class DefaultCase {
+public:
+  static constexpr bool is_default = true;
+
+  explicit DefaultCase(Handler handler) : handler_(std::move(handler)) {}
+
+  bool try_run() {
+    std::invoke(this->handler_);
+    return true;
+  }
+
+  void add_waiter(Waiter &) {}
+  void remove_waiter(Waiter &) {}
+  detail::SelectStart start(detail::SelectGroup &, detail::SelectWaiter &) {
+    return detail::SelectStart::unsupported;
+  }
+  bool withdraw() { return false; }
+  void run_fired() {}
+
+private:
+  Handler handler_;
+};
+
+/**
+ *  @brief Builds a case that receives from `handle` (a `Channel` or a
+ *  `ReceiverChannel`).
+ *  @param handler Called with the `std::expected<T, Error>` returned by the
+ *  receive operation.
+ * */
+template <detail::ReceivingHandle Handle, typename Handler>
+  requires std::invocable<Handler &,
+                          std::expected<typename Handle::value_type, Error>>
+auto on_receive(const Handle &handle, Handler handler) {
+  using T = typename Handle::value_type;
+  return ReceiveCase<T, Handler>(detail::HandleAccess::core(handle),
+                                 std::move(handler));
+}
+
+/**
+ *  @brief Builds a case that sends `value` through `handle` (a `Channel` or a
+ *  `SenderChannel`).
+ *  @param handler Called with the `std::expected<void, Error>` returned by the
+ *  send operation.
+ * */
+template <detail::SendingHandle Handle, typename U, typename Handler>
+  requires std::constructible_from<typename Handle::value_type, U &&> &&
+           std::invocable<Handler &, std::expected<void, Error>>
+auto on_send(const Handle &handle, U &&value, Handler handler) {
+  using T = typename Handle::value_type;
+  return SendCase<T, Handler>(detail::HandleAccess::core(handle),
+                              T(std::forward<U>(value)), std::move(handler));
+}
+
+/**
+ *  @brief Builds the case that fires when no other case is ready.
+ * */
+template <std::invocable Handler> auto on_default(Handler handler) {
+  return DefaultCase<Handler>(std::move(handler));
+}
+
+/**
+ *  @brief Waits until exactly one of the cases can proceed, runs it and calls
+ *  its handler. If several cases are ready, one of them is chosen at random.
+ *  If there is a default case and no other case is ready, the default case
+ *  runs instead of blocking.
+ *
+ *  The thread sleeps while waiting: `select` registers itself on every
+ *  channel core, and the first channel that changes wakes it up. On
+ *  unbuffered channels, the cases wait in the queues of the core instead,
+ *  like blocked threads, with a node each: the first counterpart to take
+ *  one of them fires its case, and drops the others. Two `select` calls can
+ *  thus meet on an unbuffered channel.
+ *  @returns The position (in the argument list) of the case that fired.
+ * */
+template <typename... Cases> std::size_t select(Cases... cases) {
+  constexpr std::size_t count = sizeof...(Cases);
+  constexpr std::size_t defaults = (std::size_t{Cases::is_default} + ... + 0);
+  static_assert(defaults <= 1, "select accepts at most one default case");
+  static_assert(count > defaults, "select needs at least one channel case");
+  constexpr std::size_t channel_cases = count - defaults;
+
+  constexpr std::array<bool, count> is_default = {Cases::is_default...};
+  std::array<std::size_t, channel_cases> order{};
+  std::size_t default_index = 0;
+  for (std::size_t i = 0, j = 0; i < count; i++) {
+    if (is_default[i]) {
+      default_index = i;
+    } else {
+      order[j++] = i;
+    }
+  }
+
+  std::tuple<Cases...> all(std::move(cases)...);
+  const std::size_t start = detail::select_start(channel_cases);
+  auto poll = [&]() -> std::optional<std::size_t> {
+    for (std::size_t k = 0; k < channel_cases; k++) {
+      const std::size_t index = order[(start + k) % channel_cases];
+      if (detail::visit_case(
+              all, index, [](auto &c) { return c.try_run(); },
+              std::index_sequence_for<Cases...>{})) {
+        return index;
+      }
+    }
+    return std::nullopt;
+  };
+
+  if (auto fired = poll()) {
+    return *fired;
+  }
+  if constexpr (defaults == 1) {
+    detail::visit_case(
+        all, default_index, [](auto &c) { return c.try_run(); },
+        std::index_sequence_for<Cases...>{});
+    return default_index;
+  }
+
+  detail::SelectWaiter waiter;
+  std::apply([&](auto &...c) { (c.add_waiter(waiter), ...); }, all);
+  struct Unregister {
+    std::tuple<Cases...> &all;
+    detail::SelectWaiter &waiter;
+    ~Unregister() {
+      std::apply([&](auto &...c) { (c.remove_waiter(waiter), ...); }, all);
+    }
+  } unregister{all, waiter};
+  // Pairs with the channels publishing their state before notifying: a change
+  // made before the registration is seen by the next poll.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  detail::SelectGroup group;
+  for (;;) {
+    if (auto fired = poll()) {
+      return *fired;
+    }
+    // Queues a node on the cores that take them. A case that may fire right
+    // away stops it: the nodes are withdrawn, and the cases polled again.
+    group.fired.store(false, std::memory_order_relaxed);
+    const bool queued = std::apply(
+        [&](auto &...c) {
+          return (... &&
+                  (c.start(group, waiter) != detail::SelectStart::ready));
+        },
+        all);
+    if (queued) {
+      waiter.wait();
+    }
+    // Fires the group, so that none of its nodes fires from now on. If a
+    // counterpart fired one first, its case won.
+    group.fired.store(true, std::memory_order_release);
+    std::optional<std::size_t> won;
+    [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+      ((std::get<Is>(all).withdraw() ? (void)(won = Is) : (void)0), ...);
+    }(std::index_sequence_for<Cases...>{});
+    if (won.has_value()) {
+      detail::visit_case(
+          all, *won,
+          [](auto &c) {
+            c.run_fired();
+            return true;
+          },
+          std::index_sequence_for<Cases...>{});
+      return *won;
+    }
+  }
+}
+
+} // namespace chx
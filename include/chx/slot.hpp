@@ -0,0 +1,127 @@
+#pragma once
+
+#include "chx/channelCore.hpp"
+#include <memory>
+#include <utility>
+
+namespace chx {
+
+/**
+ *  @brief Slot of a channel claimed by a sender (see `Channel::claim`). The
+ *  object lives in the buffer of the channel, so it is filled in place and
+ *  sent without being moved:
+ *
+ *  ``` cpp
+ *  auto slot = tx.claim();
+ *  fill(**slot);
+ *  slot->commit();
+ *  ```
+ *
+ *  A slot that is not committed is cancelled when it is destroyed. Other
+ *  senders of the channel wait while a slot is claimed, so it should be held
+ *  briefly.
+ * */
+template <typename T, typename Impl> class SendSlot {
+public:
+  SendSlot(std::shared_ptr<Impl> core, T *value)
+      : core_(std::move(core)), value_(value) {}
+
+  SendSlot(SendSlot &&other) noexcept
+      : core_(std::move(other.core_)),
+        value_(std::exchange(other.value_, nullptr)) {}
+  SendSlot &operator=(SendSlot &&other) noexcept {
+    if (this != &other) {
+      this->cancel();
+      this->core_ = std::move(other.core_);
+      this->value_ = std::exchange(other.value_, nullptr);
+    }
+    return *this;
+  }
+  SendSlot(const SendSlot &) = delete;
+  SendSlot &operator=(const SendSlot &) = delete;
+
+  ~SendSlot() { this->cancel(); }
+
+  T &operator*() const { return *this->value_; }
+  T *operator->() const { return this->value_; }
+
+  /**
+   *  @brief Sends the object. The slot is empty afterwards.
+   *  @returns `Error::closed` if the channel was closed meanwhile, in which
+   *  case the object is destroyed.
+   * */
+  std::expected<void, Error> commit() {
+    this->value_ = nullptr;
+    return this->core_->commit_claim();
+  }
+
+  /**
+   *  @brief Destroys the object without sending it, if the slot is not empty.
+   * */
+  void cancel() {
+    if (this->value_ != nullptr) {
+      this->value_ = nullptr;
+      this->core_->cancel_claim();
+    }
+  }
+
+private:
+  std::shared_ptr<Impl> core_;
+  T *value_;
+};
+
+/**
+ *  @brief Object at the front of a channel, acquired by a receiver (see
+ *  `Channel::acquire`). It is read in place, without being moved out of the
+ *  buffer:
+ *
+ *  ``` cpp
+ *  auto view = rx.acquire();
+ *  use(**view);
+ *  view->release();
+ *  ```
+ *
+ *  The object is released when the view is destroyed. Other receivers of the
+ *  channel wait while an object is acquired, so it should be held briefly.
+ * */
+template <typename T, typename Impl> class ReceiveView {
+public:
+  ReceiveView(std::shared_ptr<Impl> core, T *value)
+      : core_(std::move(core)), value_(value) {}
+
+  ReceiveView(ReceiveView &&other) noexcept
+      : core_(std::move(other.core_)),
+        value_(std::exchange(other.value_, nullptr)) {}
+  ReceiveView &operator=(ReceiveView &&other) noexcept {
+    if (this != &other) {
+      this->release();
+      this->core_ = std::move(other.core_);
+      this->value_ = std::exchange(other.value_, nullptr);
+    }
+    return *this;
+  }
+  ReceiveView(const ReceiveView &) = delete;
+  ReceiveView &operator=(const ReceiveView &) = delete;
+
+  ~ReceiveView() { this->release(); }
+
+  T &operator*() const { return *this->value_; }
+  T *operator->() const { return this->value_; }
+
+  /**
+   *  @brief Removes the object from the channel, and frees its slot for the
+   *  senders. The view is empty afterwards.
+   * */
+  void release() {
+    if (this->value_ != nullptr) {
+      this->value_ = nullptr;
+      this->core_->release_acquired();
+    }
+  }
+
+private:
+  std::shared_ptr<Impl> core_;
+  T *value_;
+};
+
+} // namespace chx
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "chx/deadline.hpp"
+#include "chx/futex.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace chx {
+
+/**
+ *  @brief Waits for a group of tasks to finish, like go's `sync.WaitGroup`.
+ *  `add` registers tasks, each of them calls `done` when it finishes, and
+ *  `wait` blocks until every registered task is done.
+ *
+ *  The whole state is one atomic word: the counter plus two flags, one telling
+ *  that some thread sleeps in `wait`, and one telling that the last `done` is
+ *  still running. `add` and `done` are a single atomic operation each (when
+ *  uncontended), and only the `done` that brings the counter to zero makes a
+ *  syscall, and only if somebody is waiting. `wait` returns only once that
+ *  `done` is finished, so the group can be destroyed right after.
+ *
+ *  ``` cpp
+ *  chx::WaitGroup group;
+ *  group.add(workers);
+ *  group.close_when_done(results);
+ *  // Each worker sends to `results` and calls group.done().
+ *  for (auto &&result : results) { ... }
+ *  ```
+ * */
+class WaitGroup {
+public:
+  WaitGroup() = default;
+  WaitGroup(const WaitGroup &) = delete;
+  WaitGroup &operator=(const WaitGroup &) = delete;
+
+  /**
+   *  @brief Adds `count` tasks to the group. Tasks must be added before
+   *  `wait` could see the counter at zero, that is, before the ones already
+   *  added are done.
+   * */
+  void add(std::uint32_t count = 1) {
+    this->state_.fetch_add(count * counter_unit, std::memory_order_relaxed);
+  }
+
+  /**
+   *  @brief Marks one task as done. When it is the last one, the waiting
+   *  threads are woken up and the `close_when_done` actions run. It must not
+   *  be called more times than tasks were added.
+   * */
+  void done() {
+    std::uint32_t state = this->state_.load(std::memory_order_relaxed);
+    for (;;) {
+      const bool last = state / counter_unit == 1;
+      const std::uint32_t next = last ? (state - counter_unit) | finishing
+                                      : state - counter_unit;
+      if (this->state_.compare_exchange_weak(state, next,
+                                             std::memory_order_acq_rel)) {
+        if (!last) {
+          return;
+        }
+        break;
+      }
+    }
+    this->run_actions();
+    state = this->state_.fetch_and(~(finishing | has_waiters),
+                                   std::memory_order_release);
+    // As with `std::latch`, the group may be destroyed by now: the wake-up
+    // only uses the address of the word as a key.
+    if ((state & has_waiters) != 0) {
+      detail::futex_wake_all(this->state_);
+    }
+  }
+
+  /**
+   *  @returns The number of tasks not done yet.
+   * */
+  std::uint32_t pending() const {
+    return this->state_.load(std::memory_order_acquire) / counter_unit;
+  }
+
+  /**
+   *  @brief Blocks the thread until every task is done.
+   * */
+  void wait() { this->wait_until(no_deadline); }
+
+  /**
+   *  @brief Blocks the thread until every task is done or `deadline` expires.
+   *  @returns True if every task is done.
+   * */
+  bool wait_until(Deadline deadline) {
+    std::uint32_t state = this->state_.load(std::memory_order_acquire);
+    for (;;) {
+      if (state == 0) {
+        return true;
+      }
+      if (deadline != no_deadline &&
+          std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
+      if ((state & has_waiters) == 0 &&
+          !this->state_.compare_exchange_weak(state, state | has_waiters,
+                                              std::memory_order_acquire)) {
+        continue;
+      }
+      detail::futex_wait(this->state_, state | has_waiters, deadline);
+      state = this->state_.load(std::memory_order_acquire);
+    }
+  }
+
+  /**
+   *  @brief Same as `wait_until`, with a deadline `timeout` from now.
+   * */
+  template <typename Rep, typename Period>
+  bool wait_for(const std::chrono::duration<Rep, Period> &timeout) {
+    return this->wait_until(detail::deadline_after(timeout));
+  }
+
+  /**
+   *  @brief Closes `channel` (any channel handle) as soon as every task is
+   *  done: right away if none is pending, or else when the last one calls
+   *  `done`. This lets the receivers of a fan-in channel iterate it until all
+   *  the senders finished. Handles that have `close_sending` are closed with
+   *  it, so receivers still get the objects a buffered channel stores.
+   * */
+  template <typename Handle>
+    requires requires(Handle &handle) { handle.close(); }
+  void close_when_done(Handle channel) {
+    this->when_done([channel]() mutable {
+      if constexpr (requires { channel.close_sending(); }) {
+        channel.close_sending();
+      } else {
+        channel.close();
+      }
+    });
+  }
+
+  /**
+   *  @brief Runs `action` as soon as every task is done: right away if none is
+   *  pending, or else in the thread of the last `done`.
+   * */
+  void when_done(std::function<void()> action) {
+    std::unique_lock lock(this->actions_mutex_);
+    if (this->pending() != 0) {
+      this->actions_.push_back(std::move(action));
+      return;
+    }
+    lock.unlock();
+    action();
+  }
+
+private:
+  // The two lowest bits are flags; the counter takes the rest.
+  static constexpr std::uint32_t has_waiters = 1;
+  static constexpr std::uint32_t finishing = 2;
+  static constexpr std::uint32_t counter_unit = 4;
+
+  void run_actions() {
+    std::vector<std::function<void()>> actions;
+    {
+      std::lock_guard lock(this->actions_mutex_);
+      actions.swap(this->actions_);
+    }
+    for (auto &action : actions) {
+      action();
+    }
+  }
+
+  std::atomic<std::uint32_t> state_{0};
+  std::mutex actions_mutex_;
+  std::vector<std::function<void()>> actions_;
+};
+
+} // namespace chx
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+namespace chx::detail {
+
+enum class NodeState : std::uint8_t {
+  waiting,
+  done,
+  closed,
+  dropped, ///< Left the queue unused: another node of its group fired.
+};
+
+/**
+ *  @brief Shared by the nodes that a `select` queues on several channels at
+ *  once. The first counterpart to claim the group completes its node, and
+ *  the other nodes of the group are dropped.
+ * */
+struct SelectGroup {
+  std::atomic<bool> fired{false};
+};
+
+/**
+ *  @brief A sender or receiver waiting in the queue of a channel core: a
+ *  blocked thread, or a suspended coroutine. It lives in the stack of its
+ *  thread (or in the frame of its coroutine), and is only touched by other
+ *  threads with the core mutex held.
+ * */
+template <typename T> class WaitNode {
+public:
+  /// Value to send, or the value received.
+  std::optional<T> value;
+  NodeState state = NodeState::waiting;
+  WaitNode *prev = nullptr;
+  WaitNode *next = nullptr;
+  /// Group of the node, if it is a `select` case.
+  SelectGroup *group = nullptr;
+
+  /**
+   *  @brief Reserves the node for the counterpart about to complete it.
+   *  Called with the core mutex held.
+   *  @returns False if another node of its group fired: it must be dropped.
+   * */
+  bool claim() {
+    return this->group == nullptr ||
+           !this->group->fired.exchange(true, std::memory_order_acq_rel);
+  }
+
+  /**
+   *  @returns False if the node can no longer be claimed.
+   * */
+  bool is_live() const {
+    return this->group == nullptr ||
+           !this->group->fired.load(std::memory_order_acquire);
+  }
+
+  /**
+   *  @brief Called by the counterpart, with the core mutex held, once it set
+   *  `state`. It is the last access of the core to the node: the waiter may
+   *  go on (and destroy the node) as soon as it is called.
+   * */
+  virtual void wake() = 0;
+
+protected:
+  WaitNode() = default;
+  ~WaitNode() = default;
+  WaitNode(const WaitNode &) = delete;
+  WaitNode &operator=(const WaitNode &) = delete;
+};
+
+/**
+ *  @brief Intrusive FIFO of waiting senders (or receivers).
+ * */
+template <typename T> class NodeQueue {
+public:
+  bool empty() const { return this->head_ == nullptr; }
+
+  void push_back(WaitNode<T> *node) {
+    node->prev = this->tail_;
+    node->next = nullptr;
+    if (this->tail_ != nullptr) {
+      this->tail_->next = node;
+    } else {
+      this->head_ = node;
+    }
+    this->tail_ = node;
+  }
+
+  WaitNode<T> *pop_front() {
+    WaitNode<T> *node = this->head_;
+    if (node != nullptr) {
+      this->remove(node);
+    }
+    return node;
+  }
+
+  void remove(WaitNode<T> *node) {
+    if (node->prev != nullptr) {
+      node->prev->next = node->next;
+    } else {
+      this->head_ = node->next;
+    }
+    if (node->next != nullptr) {
+      node->next->prev = node->prev;
+    } else {
+      this->tail_ = node->prev;
+    }
+    node->prev = nullptr;
+    node->next = nullptr;
+  }
+
+  /**
+   *  @brief Pops the first node that can be completed, dropping the ones
+   *  whose group already fired (see `WaitNode::claim`).
+   * */
+  WaitNode<T> *pop_claimed() {
+    while (WaitNode<T> *node = this->pop_front()) {
+      if (node->claim()) {
+        return node;
+      }
+      node->state = NodeState::dropped;
+    }
+    return nullptr;
+  }
+
+  /**
+   *  @returns True if a node that is not part of `group` waits in the
+   *  queue. The dead nodes met on the way are dropped.
+   * */
+  bool has_counterpart(const SelectGroup *group) {
+    WaitNode<T> *node = this->head_;
+    while (node != nullptr) {
+      WaitNode<T> *next = node->next;
+      if (!node->is_live()) {
+        this->remove(node);
+        node->state = NodeState::dropped;
+      } else if (node->group != group) {
+        return true;
+      }
+      node = next;
+    }
+    return false;
+  }
+
+  /**
+   *  @brief Completes every node with `state`.
+   * */
+  void complete_all(NodeState state) {
+    while (WaitNode<T> *node = this->pop_claimed()) {
+      node->state = state;
+      node->wake();
+    }
+  }
+
+private:
+  WaitNode<T> *head_ = nullptr;
+  WaitNode<T> *tail_ = nullptr;
+};
+
+/**
+ *  @brief What a core did with a coroutine operation (see
+ *  `ChannelCore::start_async_send`).
+ * */
+enum class AsyncStart : std::uint8_t {
+  done,        ///< Completed right away: the coroutine goes on.
+  queued,      ///< Queued in the core, which wakes the node once done.
+  unsupported, ///< The core does not queue coroutines.
+};
+
+/**
+ *  @brief What a core did with a `select` case (see
+ *  `ChannelCore::start_select`).
+ * */
+enum class SelectStart : std::uint8_t {
+  ready,       ///< Not queued: the case may fire right away.
+  queued,      ///< Queued in the core, which wakes the node if it fires.
+  unsupported, ///< The core does not queue `select` cases.
+};
+
+} // namespace chx::detail
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "chx/backoff.hpp"
+#include "chx/deadline.hpp"
+#include "chx/futex.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/**
+ *  @brief How the mutex based channels (`buffered::Channel` and
+ *  `unbuffered::Channel`) put a thread to sleep while an operation can not
+ *  proceed. A strategy provides a `Condition`, used in place of a
+ *  `std::condition_variable` protected by the channel mutex:
+ *
+ *  - `wait_until(lock, deadline, ready)` waits until `ready()` holds or
+ *    `deadline` expires, and returns the last value of `ready()`.
+ *  - `notify_one()` / `notify_all()` wake the waiting threads. They are called
+ *    with the channel mutex held, and do nothing if nobody is waiting.
+ * */
+namespace chx::wait {
+
+/**
+ *  @brief CPU-frugal strategy: a thread that has to wait blocks on a condition
+ *  variable right away.
+ * */
+class Blocking {
+public:
+  class Condition {
+  public:
+    template <typename Predicate>
+    bool wait_until(std::unique_lock<std::mutex> &lock, Deadline deadline,
+                    Predicate ready) {
+      if (ready()) {
+        return true;
+      }
+      this->waiters_++;
+      const bool result = detail::wait_until(this->cv_, lock, deadline, ready);
+      this->waiters_--;
+      return result;
+    }
+
+    void notify_one() {
+      if (this->waiters_ != 0) {
+        this->cv_.notify_one();
+      }
+    }
+
+    void notify_all() {
+      if (this->waiters_ != 0) {
+        this->cv_.notify_all();
+      }
+    }
+
+  private:
+    std::condition_variable cv_;
+    // Protected by the channel mutex.
+    std::size_t waiters_ = 0;
+  };
+};
+
+/**
+ *  @brief Latency-optimized strategy: a thread that has to wait releases the
+ *  mutex and spins for a while, so a counterpart arriving shortly after wakes
+ *  it up without any syscall. Only then it parks on a futex. Notifiers only
+ *  pay for a syscall when some thread is actually parked.
+ * */
+class SpinThenPark {
+public:
+  /// Number of `pause` iterations before parking.
+  static constexpr unsigned spin_limit = 2000;
+
+  class Condition {
+  public:
+    template <typename Predicate>
+    bool wait_until(std::unique_lock<std::mutex> &lock, Deadline deadline,
+                    Predicate ready) {
+      for (;;) {
+        if (ready()) {
+          return true;
+        }
+        if (deadline != no_deadline &&
+            std::chrono::steady_clock::now() >= deadline) {
+          return false;
+        }
+        const std::uint32_t epoch =
+            this->epoch_.load(std::memory_order_relaxed);
+        this->waiters_++;
+        lock.unlock();
+        if (!this->spin(epoch)) {
+          this->sleepers_.fetch_add(1, std::memory_order_seq_cst);
+          detail::futex_wait(this->epoch_, epoch, deadline);
+          this->sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        lock.lock();
+        this->waiters_--;
+      }
+    }
+
+    void notify_one() { this->notify(false); }
+    void notify_all() { this->notify(true); }
+
+  private:
+    /**
+     *  @returns True if the epoch moved past `epoch` while spinning.
+     * */
+    bool spin(std::uint32_t epoch) const {
+      for (unsigned i = 0; i < spin_limit; i++) {
+        if (this->epoch_.load(std::memory_order_acquire) != epoch) {
+          return true;
+        }
+        detail::cpu_relax();
+      }
+      return false;
+    }
+
+    void notify(bool all) {
+      if (this->waiters_ == 0) {
+        return;
+      }
+      // Pairs with `sleepers_` being raised before parking: either we see the
+      // sleeper, or its futex sees the new epoch and does not sleep.
+      this->epoch_.fetch_add(1, std::memory_order_seq_cst);
+      if (this->sleepers_.load(std::memory_order_seq_cst) == 0) {
+        return;
+      }
+      if (all) {
+        detail::futex_wake_all(this->epoch_);
+      } else {
+        detail::futex_wake(this->epoch_, 1);
+      }
+    }
+
+    std::atomic<std::uint32_t> epoch_{0};
+    std::atomic<std::uint32_t> sleepers_{0};
+    // Threads spinning or parked. Protected by the channel mutex.
+    std::size_t waiters_ = 0;
+  };
+};
+
+} // namespace chx::wait
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace chx {
+
+/**
+ *  @brief What may have changed on a channel when it notifies its waiters.
+ * */
+enum class WaitEvent : std::uint8_t {
+  readable = 1 << 0, ///< A receive operation may be possible now.
+  writable = 1 << 1, ///< A send operation may be possible now.
+  closed = readable | writable, ///< The channel was closed.
+};
+
+constexpr bool has_event(WaitEvent events, WaitEvent event) noexcept {
+  return (static_cast<std::uint8_t>(events) &
+          static_cast<std::uint8_t>(event)) != 0;
+}
+
+/**
+ *  @brief Something that waits on one or more channels without blocking inside
+ *  them (for example, `chx::select`). Once registered on a channel core, it is
+ *  notified every time an operation on that channel may have become possible.
+ * */
+class Waiter {
+public:
+  virtual ~Waiter() = default;
+
+  /**
+   *  @brief Called by the channel when its state changes. It runs with the
+   *  channel's waiter list locked (and maybe with the channel itself locked),
+   *  so it must be short and must not call back into the channel.
+   *  @param event What may have changed.
+   * */
+  virtual void notify(WaitEvent event) = 0;
+};
+
+namespace detail {
+
+/**
+ *  @brief List of the waiters registered on a channel core. Notifying an
+ *  empty list only costs an atomic load.
+ * */
+class WaiterList {
+public:
+  WaiterList() = default;
+  explicit WaiterList(std::pmr::memory_resource *resource)
+      : waiters_(resource) {}
+
+  void add(Waiter &waiter) {
+    std::lock_guard lock(this->mutex_);
+    this->waiters_.push_back(&waiter);
+    this->count_.fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  void remove(Waiter &waiter) {
+    std::lock_guard lock(this->mutex_);
+    auto it = std::find(this->waiters_.begin(), this->waiters_.end(), &waiter);
+    if (it == this->waiters_.end()) {
+      return;
+    }
+    *it = this->waiters_.back();
+    this->waiters_.pop_back();
+    this->count_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void notify(WaitEvent event) {
+    if (this->count_.load(std::memory_order_seq_cst) == 0) {
+      return;
+    }
+    std::lock_guard lock(this->mutex_);
+    for (Waiter *waiter : this->waiters_) {
+      waiter->notify(event);
+    }
+  }
+
+private:
+  std::atomic<std::size_t> count_{0};
+  std::mutex mutex_;
+  std::pmr::vector<Waiter *> waiters_;
+};
+
+} // namespace detail
+} // namespace chx
@@ -0,0 +1,148 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/channel_factory.hpp"
+#include "doctest.h"
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+
+namespace {
+
+/**
+ *  @brief Resource that counts the bytes it serves from the heap.
+ * */
+class CountingResource : public std::pmr::memory_resource {
+public:
+  std::size_t allocations = 0;
+  std::size_t bytes = 0;
+
+private:
+  void *do_allocate(std::size_t size, std::size_t alignment) override {
+    ++this->allocations;
+    this->bytes += size;
+    return std::pmr::new_delete_resource()->allocate(size, alignment);
+  }
+  void do_deallocate(void *p, std::size_t size,
+                     std::size_t alignment) override {
+    this->bytes -= size;
+    std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+  }
+  bool do_is_equal(const memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+/**
+ *  @brief Standard allocator that counts its allocations.
+ * */
+template <typename T> struct CountingAllocator {
+  using value_type = T;
+
+  explicit CountingAllocator(std::size_t *count) : count(count) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U> &other) : count(other.count) {}
+
+  T *allocate(std::size_t n) {
+    ++*this->count;
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, std::size_t n) { std::allocator<T>().deallocate(p, n); }
+
+  template <typename U> bool operator==(const CountingAllocator<U> &) const {
+    return true;
+  }
+
+  std::size_t *count;
+};
+
+} // namespace
+
+TEST_SUITE("Allocator") {
+  TEST_CASE("a buffered channel lives in the given resource") {
+    CountingResource arena;
+    {
+      std::pmr::polymorphic_allocator<> alloc(&arena);
+      auto ch = chx::CreateChannel<std::array<char, 1024>, 8>(
+          std::allocator_arg, alloc);
+      CHECK(arena.allocations == 1);
+      CHECK(arena.bytes >= 8 * 1024);
+      CHECK(ch.try_send({}).has_value());
+      CHECK(ch.receive().has_value());
+    }
+    CHECK(arena.bytes == 0);
+  }
+
+  TEST_CASE("a runtime sized buffer comes from the resource") {
+    CountingResource arena;
+    {
+      std::pmr::polymorphic_allocator<> alloc(&arena);
+      // Large enough to be mapped without a resource.
+      auto ch = chx::CreateChannel<int, chx::dynamic_capacity>(
+          std::allocator_arg, alloc, std::size_t{1} << 20);
+      CHECK(ch.capacity() == std::size_t{1} << 20);
+      CHECK(arena.allocations == 2);
+      CHECK(arena.bytes >= (std::size_t{1} << 20) * sizeof(int));
+      CHECK(ch.send(1).has_value());
+      CHECK(*ch.receive() == 1);
+    }
+    CHECK(arena.bytes == 0);
+  }
+
+  TEST_CASE("unbounded segments come from the resource") {
+    CountingResource arena;
+    {
+      std::pmr::polymorphic_allocator<> alloc(&arena);
+      auto ch = chx::CreateChannel<std::string, chx::policy::Unbounded>(
+          std::allocator_arg, alloc);
+      const std::size_t initial = arena.allocations;
+      bool sent = true;
+      for (int i = 0; i < 100; ++i) {
+        sent = ch.send(std::to_string(i)).has_value() && sent;
+      }
+      CHECK(sent);
+      CHECK(arena.allocations > initial);
+      auto &core = chx::detail::HandleAccess::core(ch);
+      CHECK(arena.allocations - initial == core->segments_allocated() - 1);
+      bool in_order = true;
+      for (int i = 0; i < 100; ++i) {
+        in_order = *ch.receive() == std::to_string(i) && in_order;
+      }
+      CHECK(in_order);
+    }
+    CHECK(arena.bytes == 0);
+  }
+
+  TEST_CASE("waiters are listed in the resource") {
+    struct NullWaiter : chx::Waiter {
+      void notify(chx::WaitEvent) override {}
+    };
+    CountingResource arena;
+    std::pmr::polymorphic_allocator<> alloc(&arena);
+    auto ch = chx::CreateChannel<int, 0, chx::policy::Locked>(
+        std::allocator_arg, alloc);
+    const std::size_t initial = arena.allocations;
+    NullWaiter waiter;
+    auto &core = chx::detail::HandleAccess::core(ch);
+    core->add_waiter(waiter);
+    CHECK(arena.allocations == initial + 1);
+    core->remove_waiter(waiter);
+  }
+
+  TEST_CASE("other allocators place the core") {
+    std::size_t count = 0;
+    CountingAllocator<int> alloc(&count);
+    auto ch = chx::CreateChannel<int, 4, chx::policy::Mpmc>(
+        std::allocator_arg, alloc);
+    CHECK(count == 1);
+    auto lanes = chx::CreateChannel<int, 4, chx::policy::Priority<2>>(
+        std::allocator_arg, alloc, std::array<std::size_t, 2>{2, 0});
+    CHECK(count == 2);
+    auto tx = chx::CreateBroadcastChannel<int, 4>(std::allocator_arg, alloc);
+    CHECK(count == 3);
+    CHECK(ch.try_send(1).has_value());
+    CHECK(*ch.receive() == 1);
+    CHECK(lanes.send_to(0, 1).has_value());
+    CHECK(*lanes.receive() == 1);
+  }
+}
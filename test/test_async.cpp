@@ -0,0 +1,273 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/async.hpp"
+#include "chx/channel_factory.hpp"
+#include "chx/executor.hpp"
+#include "doctest.h"
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <latch>
+#include <thread>
+#include <vector>
+
+namespace {
+// Minimal fire-and-forget coroutine type for the tests.
+struct Task {
+  struct promise_type {
+    Task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+// Coroutine type whose frame stays alive until it is destroyed explicitly.
+struct Held {
+  struct promise_type {
+    Held get_return_object() {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_never initial_suspend() { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+  std::coroutine_handle<promise_type> handle;
+};
+
+// Counts the coroutines resumed through the wrapped executor.
+class CountingExecutor final : public chx::Executor {
+public:
+  explicit CountingExecutor(chx::Executor &inner) : inner_(inner) {}
+  void post(std::function<void()> task) override {
+    this->posted++;
+    this->inner_.post(std::move(task));
+  }
+  std::atomic<int> posted = 0;
+
+private:
+  chx::Executor &inner_;
+};
+
+// Keeps the posted tasks until the test runs them.
+class ManualExecutor final : public chx::Executor {
+public:
+  void post(std::function<void()> task) override {
+    this->tasks.push_back(std::move(task));
+  }
+  void run() {
+    auto tasks = std::move(this->tasks);
+    for (auto &task : tasks) {
+      task();
+    }
+  }
+  std::vector<std::function<void()>> tasks;
+};
+} // namespace
+
+TEST_SUITE("async") {
+  TEST_CASE("thread pool runs every posted task") {
+    std::atomic<int> ran = 0;
+    {
+      chx::ThreadPoolExecutor pool(3);
+      CHECK(pool.size() == 3);
+      for (int i = 0; i < 100; ++i) {
+        pool.post([&] { ++ran; });
+      }
+    }
+    CHECK(ran == 100);
+  }
+
+  TEST_CASE("coroutines exchange values through a buffered channel") {
+    constexpr int N = 2000;
+    chx::ThreadPoolExecutor pool(2);
+    auto ch = chx::CreateChannel<int, 4>();
+    std::latch done{2};
+    long sum = 0;
+
+    auto producer = [&](chx::SenderChannel<int> tx) -> Task {
+      for (int i = 1; i <= N; ++i) {
+        auto r = co_await tx.async_send(i, pool);
+        REQUIRE(r.has_value());
+      }
+      done.count_down();
+    };
+    auto consumer = [&](chx::ReceiverChannel<int> rx) -> Task {
+      for (int i = 1; i <= N; ++i) {
+        auto v = co_await rx.async_receive(pool);
+        REQUIRE(v.has_value());
+        sum += *v;
+      }
+      done.count_down();
+    };
+
+    consumer(ch.make_receiver());
+    producer(ch.make_sender());
+    done.wait();
+    CHECK(sum == static_cast<long>(N) * (N + 1) / 2);
+  }
+
+  TEST_CASE("thousands of suspended receivers are served by a few threads") {
+    constexpr int N = 5000;
+    chx::ThreadPoolExecutor pool(2);
+    auto ch = chx::CreateChannel<int, 64, chx::policy::Mpmc>();
+    std::latch done{N};
+    std::atomic<long> sum = 0;
+
+    auto consumer = [&]() -> Task {
+      auto v = co_await ch.async_receive(pool);
+      if (v.has_value()) {
+        sum += *v;
+      }
+      done.count_down();
+    };
+    for (int i = 0; i < N; ++i) {
+      consumer();
+    }
+    for (int i = 1; i <= N; ++i) {
+      ch.send(i);
+    }
+    done.wait();
+    CHECK(sum == static_cast<long>(N) * (N + 1) / 2);
+  }
+
+  TEST_CASE("async_receive is resumed with an error when the channel closes") {
+    chx::ThreadPoolExecutor pool(1);
+    auto ch = chx::CreateChannel<int, 1>();
+    std::latch done{1};
+    chx::Error error = chx::Error::would_block;
+
+    auto consumer = [&]() -> Task {
+      auto v = co_await ch.async_receive(pool);
+      error = v.error();
+      done.count_down();
+    };
+    consumer();
+    ch.close();
+    done.wait();
+    CHECK(error == chx::Error::closed);
+  }
+
+  TEST_CASE("async_send meets a blocked receiver on an unbuffered channel") {
+    auto ch = chx::CreateChannel<int>();
+    std::latch done{1};
+    int got = 0;
+    std::thread receiver([&] { got = ch.receive().value(); });
+
+    auto producer = [&]() -> Task {
+      auto r = co_await ch.async_send(9);
+      CHECK(r.has_value());
+      done.count_down();
+    };
+    producer();
+    done.wait();
+    receiver.join();
+    CHECK(got == 9);
+  }
+
+  TEST_CASE("coroutines meet each other on an unbuffered channel") {
+    constexpr int N = 2000;
+    chx::ThreadPoolExecutor pool(2);
+    auto ch = chx::CreateChannel<int>();
+    std::latch done{2};
+    long sum = 0;
+    bool sent = true;
+
+    auto producer = [&](chx::SenderChannel<int> tx) -> Task {
+      for (int i = 1; i <= N; ++i) {
+        sent = (co_await tx.async_send(i, pool)).has_value() && sent;
+      }
+      done.count_down();
+    };
+    auto consumer = [&](chx::ReceiverChannel<int> rx) -> Task {
+      for (int i = 1; i <= N; ++i) {
+        sum += (co_await rx.async_receive(pool)).value_or(0);
+      }
+      done.count_down();
+    };
+
+    consumer(ch.make_receiver());
+    producer(ch.make_sender());
+    done.wait();
+    CHECK(sent);
+    CHECK(sum == static_cast<long>(N) * (N + 1) / 2);
+  }
+
+  TEST_CASE("each send resumes a single suspended receiver") {
+    constexpr int N = 1000;
+    chx::ThreadPoolExecutor pool(2);
+    CountingExecutor counting(pool);
+    auto buffered = chx::CreateChannel<int, 4>();
+    auto unbuffered = chx::CreateChannel<int>();
+    std::latch done{2 * N};
+
+    auto consumer = [&](auto &ch) -> Task {
+      co_await ch.async_receive(counting);
+      done.count_down();
+    };
+    for (int i = 0; i < N; ++i) {
+      consumer(buffered);
+      consumer(unbuffered);
+    }
+    CHECK(counting.posted == 0);
+    REQUIRE(buffered.send(1).has_value());
+    CHECK(counting.posted == 1);
+    REQUIRE(unbuffered.send(2).has_value());
+    CHECK(counting.posted == 2);
+
+    buffered.close();
+    unbuffered.close();
+    done.wait();
+    CHECK(counting.posted == 2 * N);
+  }
+
+  TEST_CASE("destroying a suspended coroutine withdraws it from the channel") {
+    chx::ThreadPoolExecutor pool(1);
+    auto ch = chx::CreateChannel<int, 4>();
+    auto consumer = [&]() -> Held { co_await ch.async_receive(pool); };
+
+    Held held = consumer();
+    REQUIRE_FALSE(held.handle.done());
+    held.handle.destroy();
+    REQUIRE(ch.send(1).has_value());
+    CHECK(ch.try_receive() == 1);
+  }
+
+  TEST_CASE("destroying a coroutine suspended on a lock-free channel") {
+    // These cores do not queue coroutines: the waiter of the coroutine, and
+    // the retries it already posted, must not outlive it.
+    ManualExecutor manual;
+    auto ch = chx::CreateChannel<int, 4, chx::policy::Mpmc>();
+    auto consumer = [&]() -> Held { co_await ch.async_receive(manual); };
+
+    Held held = consumer();
+    REQUIRE_FALSE(held.handle.done());
+    held.handle.destroy();
+    REQUIRE(ch.send(1).has_value());
+    CHECK(manual.tasks.empty());
+    CHECK(ch.try_receive() == 1);
+
+    held = consumer();
+    REQUIRE(ch.send(2).has_value());
+    REQUIRE(manual.tasks.size() == 1);
+    held.handle.destroy();
+    manual.run();
+    CHECK(ch.try_receive() == 2);
+
+    auto full = chx::CreateChannel<int, 2, chx::policy::Spsc>();
+    REQUIRE(full.send(1).has_value());
+    REQUIRE(full.send(2).has_value());
+    auto producer = [&]() -> Held { co_await full.async_send(3, manual); };
+    held = producer();
+    REQUIRE_FALSE(held.handle.done());
+    held.handle.destroy();
+    CHECK(full.receive() == 1);
+    manual.run();
+    CHECK(full.try_receive() == 2);
+    CHECK(full.try_receive().error() == chx::Error::would_block);
+  }
+}
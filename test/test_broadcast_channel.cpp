@@ -0,0 +1,157 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/Broadcast/BroadcastChannel.hpp"
+#include "chx/channel_factory.hpp"
+#include "doctest.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_SUITE("BroadcastChannel") {
+  TEST_CASE("every subscriber receives every message in order") {
+    auto tx = chx::CreateBroadcastChannel<int, 4>();
+    auto first = tx.subscribe();
+    auto second = tx.subscribe();
+    CHECK(tx.subscribers() == 2);
+    for (int i = 0; i < 3; ++i) {
+      CHECK(tx.send(i).has_value());
+    }
+    CHECK(first.size() == 3);
+    for (int i = 0; i < 3; ++i) {
+      CHECK(*first.receive() == i);
+    }
+    for (int i = 0; i < 3; ++i) {
+      CHECK(*second.try_receive() == i);
+    }
+    CHECK(first.try_receive().error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("late subscribers start at the head") {
+    auto tx = chx::CreateBroadcastChannel<int, 4>();
+    auto early = tx.subscribe();
+    CHECK(tx.send(1).has_value());
+    auto late = tx.subscribe();
+    CHECK(tx.send(2).has_value());
+    CHECK(late.size() == 1);
+    CHECK(*late.receive() == 2);
+    CHECK(*early.receive() == 1);
+  }
+
+  TEST_CASE("senders wait for the slowest subscriber only") {
+    auto tx = chx::CreateBroadcastChannel<int, 2>();
+    auto fast = tx.subscribe();
+    auto slow = tx.subscribe();
+    CHECK(tx.try_send(1).has_value());
+    CHECK(tx.try_send(2).has_value());
+    CHECK(*fast.receive() == 1);
+    CHECK(*fast.receive() == 2);
+    // `slow` still holds both slots.
+    auto full = tx.try_send(3);
+    REQUIRE_FALSE(full.has_value());
+    CHECK(full.error() == chx::Error::would_block);
+    CHECK(tx.send_for(3, std::chrono::milliseconds(10)).error() ==
+          chx::Error::timeout);
+
+    std::atomic<bool> sent{false};
+    std::thread sender([&] {
+      CHECK(tx.send(3).has_value());
+      sent = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK_FALSE(sent.load());
+    CHECK(*slow.receive() == 1);
+    sender.join();
+    CHECK(sent.load());
+    CHECK(*fast.receive() == 3);
+  }
+
+  TEST_CASE("a dropped subscriber no longer holds the senders back") {
+    auto tx = chx::CreateBroadcastChannel<int, 1>();
+    auto kept = tx.subscribe();
+    auto dropped = std::make_unique<chx::broadcast::Subscriber<int, 1>>(
+        tx.subscribe());
+    CHECK(tx.send(1).has_value());
+    CHECK(*kept.receive() == 1);
+    CHECK(tx.try_send(2).error() == chx::Error::would_block);
+    dropped.reset();
+    CHECK(tx.subscribers() == 1);
+    CHECK(tx.try_send(2).has_value());
+  }
+
+  TEST_CASE("messages are read in place without copies") {
+    auto tx = chx::CreateBroadcastChannel<std::string, 8>();
+    auto rx = tx.subscribe();
+    CHECK(tx.emplace_send(3, 'x').has_value());
+    const std::string *stored = nullptr;
+    auto size = rx.receive_with([&](const std::string &value) {
+      stored = &value;
+      return value.size();
+    });
+    REQUIRE(size.has_value());
+    CHECK(*size == 3);
+    CHECK(stored != nullptr);
+  }
+
+  TEST_CASE("a subscriber keeps the messages a loop did not reach") {
+    auto tx = chx::CreateBroadcastChannel<int, 16>();
+    auto rx = tx.subscribe();
+    for (int i = 0; i < 6; ++i) {
+      REQUIRE(tx.send(i).has_value());
+    }
+    for (int value : rx) {
+      CHECK(value == 0);
+      break;
+    }
+    CHECK(rx.receive() == 1);
+    CHECK(rx.try_receive() == 2);
+    CHECK(rx.receive_with([](const int &value) { return value * 10; }) == 30);
+    auto moved = std::move(rx);
+    std::vector<int> out(4);
+    REQUIRE(moved.receive_many(out, 2) == 2);
+    CHECK(out[0] == 4);
+    CHECK(out[1] == 5);
+  }
+
+  TEST_CASE("subscribers on other threads see the whole stream") {
+    constexpr int messages = 10000;
+    auto tx = chx::CreateBroadcastChannel<int, 64>();
+    std::vector<chx::broadcast::Subscriber<int, 64>> subscribers;
+    for (int i = 0; i < 4; ++i) {
+      subscribers.push_back(tx.subscribe());
+    }
+    std::vector<long> sums(subscribers.size(), 0);
+    std::atomic<bool> in_order{true};
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < subscribers.size(); ++i) {
+      threads.emplace_back([&, i] {
+        int expected = 0;
+        for (int value : subscribers[i]) {
+          if (value != expected++) {
+            in_order = false;
+          }
+          sums[i] += value;
+        }
+      });
+    }
+    for (int i = 0; i < messages; ++i) {
+      REQUIRE(tx.send(i).has_value());
+    }
+    // Closing drops what was not received yet, so wait for the subscribers.
+    for (auto &subscriber : subscribers) {
+      while (subscriber.size() != 0) {
+        std::this_thread::yield();
+      }
+    }
+    tx.close();
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    CHECK(in_order.load());
+    for (long sum : sums) {
+      CHECK(sum == static_cast<long>(messages) * (messages - 1) / 2);
+    }
+    CHECK(tx.send(0).error() == chx::Error::closed);
+  }
+}
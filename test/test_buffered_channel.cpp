@@ -1,10 +1,18 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "chx/Buffered/BufferedChannel.hpp"
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
 #include "doctest.h"
+#include "chx/channel_factory.hpp"
+#include <array>
 #include <atomic>
+#include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 #include <chrono>
+#include <limits>
+#include <stdexcept>
 
 using chx::buffered::Channel;
 
@@ -105,14 +113,21 @@ TEST_SUITE("BufferedChannel") {
     CHECK(ch.send(2).has_value());
     auto res = ch.try_send(3);
     CHECK_FALSE(res.has_value());
-    CHECK(res.error() == "cannot send inmediatly since the buffer is full");
+    CHECK(res.error() == chx::Error::would_block);
   }
 
   TEST_CASE("try_receive fails when buffer is empty") {
     Channel<int, 1> ch;
     auto res = ch.try_receive();
     CHECK_FALSE(res.has_value());
-    CHECK(res.error() == "cannot receive inmediatly since the buffer is empty");
+    CHECK(res.error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("errors can be printed for logging") {
+    CHECK(chx::to_string(chx::Error::closed) == "channel closed");
+    CHECK(chx::to_string(chx::Error::would_block) == "operation would block");
+    CHECK(chx::to_string(chx::Error::timeout) == "operation timed out");
+    CHECK(chx::to_string(chx::Error::cancelled) == "operation cancelled");
   }
 
   TEST_CASE("receive waits until an element is available") {
@@ -151,10 +166,10 @@ TEST_SUITE("BufferedChannel") {
     ch.close();
     auto send_res = ch.send(1);
     CHECK_FALSE(send_res.has_value());
-    CHECK(send_res.error() == "channel closed");
+    CHECK(send_res.error() == chx::Error::closed);
     auto recv_res = ch.receive();
     CHECK_FALSE(recv_res.has_value());
-    CHECK(recv_res.error() == "channel closed");
+    CHECK(recv_res.error() == chx::Error::closed);
   }
 
   TEST_CASE("multiple senders and receivers") {
@@ -192,4 +207,374 @@ TEST_SUITE("BufferedChannel") {
     CHECK(total_produced == 100);
     CHECK(total_consumed == 100);
   }
+
+  TEST_CASE("send_many and receive_many wrap around the buffer") {
+    Channel<int, 4> ch;
+    std::vector<int> out(4);
+    for (int round = 0; round < 3; ++round) {
+      std::vector<int> values = {round, round + 1, round + 2};
+      auto sent = ch.send_many(values);
+      REQUIRE(sent.has_value());
+      CHECK(*sent == 3);
+      auto received = ch.receive_many(out, 3, 4);
+      REQUIRE(received.has_value());
+      CHECK(*received == 3);
+      CHECK(out[0] == round);
+      CHECK(out[2] == round + 2);
+    }
+  }
+
+  TEST_CASE("try_send_many and try_receive_many report partial counts") {
+    Channel<int, 3> ch;
+    std::vector<int> values = {1, 2, 3, 4, 5};
+    auto sent = ch.try_send_many(values);
+    REQUIRE(sent.has_value());
+    CHECK(*sent == 3);
+    auto full = ch.try_send_many(std::span(values).subspan(3));
+    CHECK_FALSE(full.has_value());
+    CHECK(full.error() == chx::Error::would_block);
+
+    std::vector<int> out(2);
+    auto received = ch.try_receive_many(out);
+    REQUIRE(received.has_value());
+    CHECK(*received == 2);
+    CHECK(out == std::vector<int>{1, 2});
+    received = ch.try_receive_many(out);
+    REQUIRE(received.has_value());
+    CHECK(*received == 1);
+    CHECK(out[0] == 3);
+    auto empty = ch.try_receive_many(out);
+    CHECK_FALSE(empty.has_value());
+    CHECK(empty.error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("batches larger than the buffer keep their order") {
+    constexpr int N = 10000;
+    Channel<int, 16> ch;
+    bool in_order = true;
+    int next = 0;
+
+    std::thread consumer([&] {
+      std::vector<int> out(7);
+      while (next < N) {
+        auto received = ch.receive_many(out, 1, out.size());
+        if (!received.has_value()) {
+          break;
+        }
+        for (std::size_t i = 0; i < *received; ++i) {
+          if (out[i] != next++) {
+            in_order = false;
+          }
+        }
+      }
+    });
+
+    std::vector<int> values(N);
+    for (int i = 0; i < N; ++i) {
+      values[i] = i;
+    }
+    auto sent = ch.send_many(values);
+    consumer.join();
+    REQUIRE(sent.has_value());
+    CHECK(*sent == static_cast<std::size_t>(N));
+    CHECK(next == N);
+    CHECK(in_order);
+  }
+
+  TEST_CASE("send_many fails once the channel is closed") {
+    Channel<int, 2> ch;
+    ch.close();
+    std::vector<int> values = {1, 2};
+    auto sent = ch.send_many(values);
+    CHECK_FALSE(sent.has_value());
+    CHECK(sent.error() == chx::Error::closed);
+    std::vector<int> out(2);
+    auto received = ch.receive_many(out, 1, 2);
+    CHECK_FALSE(received.has_value());
+    CHECK(received.error() == chx::Error::closed);
+  }
+
+  TEST_CASE("send_for and receive_for time out") {
+    using namespace std::chrono_literals;
+    Channel<int, 1> ch;
+    auto empty = ch.receive_for(20ms);
+    CHECK_FALSE(empty.has_value());
+    CHECK(empty.error() == chx::Error::timeout);
+
+    CHECK(ch.send_for(1, 20ms).has_value());
+    auto full = ch.send_for(2, 20ms);
+    CHECK_FALSE(full.has_value());
+    CHECK(full.error() == chx::Error::timeout);
+  }
+
+  TEST_CASE("receive_until succeeds when a value arrives in time") {
+    Channel<int, 1> ch;
+    std::thread producer([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      ch.send(5);
+    });
+    auto v = ch.receive_until(std::chrono::steady_clock::now() +
+                              std::chrono::seconds(10));
+    producer.join();
+    REQUIRE(v.has_value());
+    CHECK(*v == 5);
+  }
+
+  TEST_CASE("runtime capacity channel blocks when its buffer is full") {
+    Channel<int, chx::dynamic_capacity> ch(3);
+    REQUIRE(ch.try_send(1).has_value());
+    REQUIRE(ch.try_send(2).has_value());
+    REQUIRE(ch.try_send(3).has_value());
+    auto full = ch.try_send(4);
+    REQUIRE_FALSE(full.has_value());
+    CHECK(full.error() == chx::Error::would_block);
+    CHECK(ch.receive().value() == 1);
+    REQUIRE(ch.try_send(4).has_value());
+
+    std::vector<int> out(3);
+    REQUIRE(ch.receive_many(out, 3, 3).value() == 3);
+    CHECK(out == std::vector<int>{2, 3, 4});
+  }
+
+  TEST_CASE("large runtime capacity channel is mapped lazily") {
+    constexpr std::size_t capacity = 1 << 20;
+    auto ch = chx::CreateChannel<int>(capacity);
+    constexpr int N = 3 * (1 << 19);
+    std::thread producer([&] {
+      for (int i = 0; i < N; ++i) {
+        ch.send(i);
+      }
+    });
+    long long sum = 0;
+    for (int i = 0; i < N; ++i) {
+      sum += ch.receive().value_or(0);
+    }
+    producer.join();
+    CHECK(sum == static_cast<long long>(N) * (N - 1) / 2);
+
+    chx::buffered::CircularQueue<int, chx::dynamic_capacity> queue(capacity);
+    CHECK(queue.is_mapped());
+    chx::buffered::CircularQueue<int, chx::dynamic_capacity> small(16);
+    CHECK_FALSE(small.is_mapped());
+  }
+
+  TEST_CASE("huge page backing falls back to regular pages") {
+    auto ch = chx::CreateChannel<int>(1 << 20, chx::PageBacking::huge);
+    REQUIRE(ch.send(7).has_value());
+    CHECK(ch.receive().value() == 7);
+  }
+
+  TEST_CASE("runtime capacity that overflows the ring size is rejected") {
+    constexpr std::size_t max = std::numeric_limits<std::size_t>::max();
+    // One more int than fits would wrap to a 4 byte ring.
+    CHECK_THROWS_AS(chx::CreateChannel<int>(max / sizeof(int) + 1),
+                    std::length_error);
+    CHECK_THROWS_AS(chx::CreateChannel<std::string>(max), std::length_error);
+  }
+
+  TEST_CASE("runtime capacity channel only constructs the stored objects") {
+    // No default constructor: the buffer is not filled up front.
+    struct Item {
+      explicit Item(std::shared_ptr<int> p) : ptr(std::move(p)) {}
+      std::shared_ptr<int> ptr;
+    };
+    auto tracked = std::make_shared<int>(1);
+    {
+      Channel<Item, chx::dynamic_capacity> ch(4);
+      REQUIRE(ch.send(Item(tracked)).has_value());
+      REQUIRE(ch.send(Item(tracked)).has_value());
+      CHECK(tracked.use_count() == 3);
+      auto item = ch.receive();
+      REQUIRE(item.has_value());
+    }
+    // The element left in the buffer is destroyed with the channel.
+    CHECK(tracked.use_count() == 1);
+  }
+
+  TEST_CASE("queue keeps FIFO order across the wrap around point") {
+    auto check = [](auto &queue) {
+      int next_in = 0, next_out = 0;
+      for (int round = 0; round < 50; ++round) {
+        while (queue.push(next_in)) {
+          next_in++;
+        }
+        for (int i = 0; i < 3; ++i) {
+          REQUIRE(*queue.front() == next_out++);
+          queue.pop();
+        }
+      }
+      while (!queue.is_empty()) {
+        REQUIRE(*queue.front() == next_out++);
+        queue.pop();
+      }
+      CHECK(next_in == next_out);
+    };
+    chx::buffered::CircularQueue<int, 8> power_of_two;
+    chx::buffered::CircularQueue<int, 5> other;
+    chx::buffered::CircularQueue<int, chx::dynamic_capacity> runtime(6);
+    check(power_of_two);
+    check(other);
+    check(runtime);
+  }
+
+  TEST_CASE("queue destroys popped elements") {
+    auto tracked = std::make_shared<int>(1);
+    chx::buffered::CircularQueue<std::shared_ptr<int>, 4> queue;
+    REQUIRE(queue.push(tracked));
+    REQUIRE(queue.push(tracked));
+    CHECK(tracked.use_count() == 3);
+    queue.pop();
+    CHECK(tracked.use_count() == 2);
+    std::vector<std::shared_ptr<int>> out(1);
+    REQUIRE(queue.pop_many(out) == 1);
+    out.clear();
+    CHECK(tracked.use_count() == 1);
+  }
+
+  TEST_CASE("emplace_send builds the object in the buffer") {
+    struct Message {
+      Message(int a, int b) : sum(a + b) {}
+      Message(const Message &other)
+          : sum(other.sum), copies(other.copies + 1) {}
+      Message(Message &&other) noexcept
+          : sum(other.sum), copies(other.copies), moves(other.moves + 1) {}
+      Message &operator=(Message &&) = default;
+      int sum;
+      int copies = 0;
+      int moves = 0;
+    };
+    auto ch = chx::CreateChannel<Message, 2>();
+    REQUIRE(ch.emplace_send(2, 3).has_value());
+    auto message = ch.receive();
+    REQUIRE(message.has_value());
+    CHECK(message->sum == 5);
+    CHECK(message->copies == 0);
+    // Out of the buffer into the result, and nothing on the way in.
+    CHECK(message->moves <= 2);
+
+    chx::Channel<Message> erased = ch;
+    REQUIRE(erased.emplace_send(4, 4).has_value());
+    CHECK(ch.receive()->sum == 8);
+  }
+
+  TEST_CASE("claimed slots are filled and read in place") {
+    struct Frame {
+      int id;
+      std::array<unsigned char, 4096> pixels;
+    };
+    auto ch = chx::CreateChannel<Frame, 2>();
+    auto tx = ch.make_sender();
+    auto rx = ch.make_receiver();
+    auto slot = tx.claim();
+    REQUIRE(slot.has_value());
+    Frame *filled = &**slot;
+    (*slot)->id = 7;
+    (*slot)->pixels.fill(0xab);
+    // Nothing is visible until the slot is committed.
+    CHECK(ch.size() == 0);
+    CHECK(rx.try_receive().error() == chx::Error::would_block);
+    REQUIRE(slot->commit().has_value());
+    CHECK(ch.size() == 1);
+
+    auto view = rx.acquire();
+    REQUIRE(view.has_value());
+    CHECK(&**view == filled);
+    CHECK((*view)->id == 7);
+    CHECK((*view)->pixels[4095] == 0xab);
+    CHECK(ch.size() == 1);
+    view->release();
+    CHECK(ch.size() == 0);
+  }
+
+  TEST_CASE("uncommitted slots are cancelled") {
+    auto ch = chx::CreateChannel<std::string, 1>();
+    {
+      auto slot = ch.claim(3, 'x');
+      REQUIRE(slot.has_value());
+      CHECK(**slot == "xxx");
+      // A single slot may be claimed at a time.
+      CHECK(ch.try_claim().error() == chx::Error::would_block);
+      CHECK(ch.try_send("y").error() == chx::Error::would_block);
+    }
+    CHECK(ch.size() == 0);
+    REQUIRE(ch.try_send("y").has_value());
+    CHECK(ch.try_claim().error() == chx::Error::would_block);
+    {
+      auto view = ch.try_acquire();
+      REQUIRE(view.has_value());
+      CHECK(**view == "y");
+      CHECK(ch.try_receive().error() == chx::Error::would_block);
+    }
+    CHECK(ch.size() == 0);
+
+    auto slot = ch.claim();
+    REQUIRE(slot.has_value());
+    ch.close();
+    CHECK(slot->commit().error() == chx::Error::closed);
+    CHECK(ch.size() == 0);
+  }
+
+  TEST_CASE("claims and plain operations interleave between threads") {
+    constexpr int N = 20000;
+    auto ch = chx::CreateChannel<int, 4>();
+    auto claimer = std::thread([&] {
+      for (int i = 0; i < N; i += 2) {
+        auto slot = ch.claim(i);
+        if (slot.has_value()) {
+          (void)slot->commit();
+        }
+      }
+    });
+    auto sender = std::thread([&] {
+      for (int i = 1; i < N; i += 2) {
+        (void)ch.send(i);
+      }
+    });
+    std::atomic<long long> sum = 0;
+    auto acquirer = std::thread([&] {
+      for (int i = 0; i < N / 2; ++i) {
+        auto view = ch.acquire();
+        if (view.has_value()) {
+          sum += **view;
+        }
+      }
+    });
+    for (int i = 0; i < N / 2; ++i) {
+      sum += ch.receive().value_or(0);
+    }
+    claimer.join();
+    sender.join();
+    acquirer.join();
+    CHECK(sum == static_cast<long long>(N) * (N - 1) / 2);
+    CHECK(ch.size() == 0);
+  }
+
+  TEST_CASE("spin-then-park channel passes values between threads") {
+    constexpr int N = 50000;
+    auto ch = chx::CreateChannel<int, 8, chx::policy::Locked,
+                                 chx::wait::SpinThenPark>();
+    std::thread producer([&] {
+      for (int i = 0; i < N; ++i) {
+        ch.send(i);
+      }
+    });
+    long long sum = 0;
+    for (int i = 0; i < N; ++i) {
+      sum += ch.receive().value_or(0);
+    }
+    producer.join();
+    CHECK(sum == static_cast<long long>(N) * (N - 1) / 2);
+  }
+
+  TEST_CASE("spin-then-park channel times out when the buffer stays full") {
+    Channel<int, 1, chx::wait::SpinThenPark> ch;
+    REQUIRE(ch.send(1).has_value());
+    const auto start = std::chrono::steady_clock::now();
+    auto res = ch.send_until(
+        2, chx::detail::deadline_after(std::chrono::milliseconds(20)));
+    REQUIRE_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::timeout);
+    CHECK(std::chrono::steady_clock::now() - start >=
+          std::chrono::milliseconds(20));
+  }
 }
@@ -0,0 +1,163 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/channel.hpp"
+#include "chx/channel_factory.hpp"
+#include "doctest.h"
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace {
+
+/**
+ *  @brief Splits a channel into one sender and one receiver, dropping the
+ *  `Channel` handle itself (which counts on both sides). The handles are
+ *  optional so that the tests can drop them with `reset`.
+ * */
+template <typename Ch> auto split(Ch ch) {
+  return std::pair{std::optional(ch.make_sender()),
+                   std::optional(ch.make_receiver())};
+}
+
+template <typename Handle> auto &core(Handle &handle) {
+  return chx::detail::HandleAccess::core(handle);
+}
+
+/**
+ *  @brief The receiver takes what was sent before the last sender was
+ *  dropped, and then finds the channel closed. `make` builds the channel.
+ * */
+template <typename Make> void check_drain(Make make) {
+  auto [sender, receiver] = split(make());
+  REQUIRE(sender->send(1).has_value());
+  REQUIRE(sender->send(2).has_value());
+  sender.reset();
+
+  CHECK_FALSE(receiver->is_closed());
+  CHECK(receiver->receive() == 1);
+  CHECK(receiver->try_receive() == 2);
+  CHECK(receiver->is_closed());
+  CHECK(receiver->receive().error() == chx::Error::closed);
+  CHECK(receiver->try_receive().error() == chx::Error::closed);
+}
+
+/**
+ *  @brief A receiver blocked on an empty channel wakes up when the last
+ *  sender is dropped.
+ * */
+template <typename Make> void check_wake(Make make) {
+  auto [sender, receiver] = split(make());
+  std::optional<chx::Error> error;
+  std::thread consumer([&, &receiver = receiver] {
+    auto v = receiver->receive();
+    error = v.has_value() ? std::nullopt : std::optional(v.error());
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  sender.reset();
+  consumer.join();
+  CHECK(error == chx::Error::closed);
+}
+
+} // namespace
+
+TEST_SUITE("Handle count") {
+  TEST_CASE("handles are counted on the sides they use") {
+    auto ch = chx::CreateChannel<int, 4>();
+    CHECK(core(ch)->senders() == 1);
+    CHECK(core(ch)->receivers() == 1);
+
+    auto sender = ch.make_sender();
+    auto receiver = ch.make_receiver();
+    auto copy = sender;
+    CHECK(core(ch)->senders() == 3);
+    CHECK(core(ch)->receivers() == 2);
+
+    auto other = chx::CreateChannel<int, 4>();
+    receiver = other.make_receiver();
+    CHECK(core(ch)->receivers() == 1);
+    CHECK(core(other)->receivers() == 2);
+  }
+
+  TEST_CASE("assigning handles across channels keeps the counts right") {
+    auto a = chx::CreateChannel<int>(4);
+    auto b = chx::CreateChannel<int>(4);
+    auto sa = a.make_sender();
+    auto sb = b.make_sender();
+    auto ra = a.make_receiver();
+    auto rb = b.make_receiver();
+
+    // `sa` and `ra` are the last handles of the first core once `a` is
+    // reassigned: assigning them drops it while they detach from it.
+    a = b;
+    sa = sb;
+    ra = rb;
+    CHECK(core(b)->senders() == 4);
+    CHECK(core(b)->receivers() == 4);
+    CHECK_FALSE(sa.is_closed());
+    REQUIRE(sa.send(1).has_value());
+    CHECK(ra.receive() == 1);
+
+    auto c = chx::CreateChannel<int>(4);
+    auto sc = c.make_sender();
+    c = a;
+    sc = sa;
+    CHECK(core(b)->senders() == 6);
+  }
+
+  TEST_CASE("dropping the last sender closes the channel once drained") {
+    check_drain([] { return chx::CreateChannel<int, 4>(); });
+    check_drain([] { return chx::CreateChannel<int, 4, chx::policy::Spsc>(); });
+    check_drain([] { return chx::CreateChannel<int, 4, chx::policy::Mpmc>(); });
+    check_drain(
+        [] { return chx::CreateChannel<int, chx::policy::Unbounded>(); });
+    check_drain(
+        [] { return chx::CreateChannel<int, 4, chx::policy::Priority<2>>(); });
+  }
+
+  TEST_CASE("dropping the last sender wakes blocked receivers") {
+    check_wake([] { return chx::CreateChannel<int>(); });
+    check_wake([] { return chx::CreateChannel<int, 4>(); });
+    check_wake([] { return chx::CreateChannel<int, 4, chx::policy::Spsc>(); });
+    check_wake([] { return chx::CreateChannel<int, 4, chx::policy::Mpmc>(); });
+    check_wake(
+        [] { return chx::CreateChannel<int, chx::policy::Unbounded>(); });
+    check_wake(
+        [] { return chx::CreateChannel<int, 4, chx::policy::Priority<2>>(); });
+  }
+
+  TEST_CASE("a sender copy keeps the channel open") {
+    auto [sender, receiver] = split(chx::CreateChannel<std::string, 4>());
+    auto copy = *sender;
+    sender.reset();
+    CHECK_FALSE(receiver->is_closed());
+    REQUIRE(copy.send("still open").has_value());
+    CHECK(receiver->receive() == "still open");
+  }
+
+  TEST_CASE("dropping the last receiver makes sends fail fast") {
+    auto [sender, receiver] = split(chx::CreateChannel<int, 1>());
+    REQUIRE(sender->send(1).has_value());
+    receiver.reset();
+    CHECK(sender->is_closed());
+    // The buffer is full, but the send fails instead of blocking forever.
+    CHECK(sender->send(2).error() == chx::Error::closed);
+  }
+
+  TEST_CASE("dropping the last receiver fails blocked senders") {
+    auto [sender, receiver] = split(chx::CreateChannel<int>());
+    std::optional<chx::Error> error;
+    std::thread producer([&, &sender = sender] {
+      auto res = sender->send(1);
+      error = res.has_value() ? std::nullopt : std::optional(res.error());
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    receiver.reset();
+    producer.join();
+    CHECK(error == chx::Error::closed);
+  }
+}
@@ -0,0 +1,154 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/Ipc/IpcChannel.hpp"
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "doctest.h"
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+struct Message {
+  std::uint64_t sequence;
+  double payload[3];
+};
+
+/**
+ *  @returns A shared memory name that no other test run uses.
+ * */
+std::string unique_name(const char *test) {
+  return "/chx-test-" + std::string(test) + "-" + std::to_string(::getpid());
+}
+
+} // namespace
+
+TEST_SUITE("IpcChannel") {
+  TEST_CASE("a named channel is opened by a second mapping") {
+    const std::string name = unique_name("named");
+    auto created = chx::CreateSharedChannel<Message>(name, 5);
+    auto opened = chx::OpenSharedChannel<Message>(name);
+    chx::ipc::Channel<Message>::unlink(name);
+    CHECK(created.capacity() == 8);
+    CHECK(opened.capacity() == 8);
+
+    auto tx = created.make_sender();
+    auto rx = opened.make_receiver();
+    CHECK(tx.send(Message{1, {0.5, 1.5, 2.5}}).has_value());
+    CHECK(opened.size() == 1);
+    auto message = rx.receive();
+    REQUIRE(message.has_value());
+    CHECK(message->sequence == 1);
+    CHECK(message->payload[2] == 2.5);
+    CHECK(rx.try_receive().error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("try_send fails when the ring is full") {
+    auto ch = chx::CreateSharedChannel<int>(2);
+    CHECK(ch.try_send(1).has_value());
+    CHECK(ch.try_send(2).has_value());
+    CHECK(ch.try_send(3).error() == chx::Error::would_block);
+    CHECK(ch.send_for(3, std::chrono::milliseconds(10)).error() ==
+          chx::Error::timeout);
+    CHECK(*ch.receive() == 1);
+    CHECK(ch.try_send(3).has_value());
+  }
+
+  TEST_CASE("opening checks the type of the channel") {
+    const std::string name = unique_name("type");
+    auto created = chx::CreateSharedChannel<std::uint32_t>(name, 4);
+    CHECK_THROWS_AS(chx::OpenSharedChannel<Message>(name), std::system_error);
+    CHECK_THROWS_AS(chx::CreateSharedChannel<std::uint32_t>(name, 4),
+                    std::system_error);
+    chx::ipc::Channel<std::uint32_t>::unlink(name);
+    CHECK_THROWS_AS(chx::OpenSharedChannel<std::uint32_t>(name),
+                    std::system_error);
+  }
+
+  TEST_CASE("capacities whose mapping overflows are rejected") {
+    using Ipc = chx::ipc::Channel<Message>;
+    const std::size_t max = std::numeric_limits<std::size_t>::max();
+    CHECK(std::has_single_bit(Ipc::max_capacity()));
+    CHECK_THROWS_AS(Ipc::create(max), std::length_error);
+    CHECK_THROWS_AS(Ipc::create(max / 2 + 2), std::length_error);
+    CHECK_THROWS_AS(Ipc::create(Ipc::max_capacity() + 1), std::length_error);
+
+    // The name is removed again when creating fails.
+    const std::string name = unique_name("overflow");
+    CHECK_THROWS_AS(Ipc::create(name, max), std::length_error);
+    CHECK_THROWS_AS(Ipc::open(name), std::system_error);
+  }
+
+  TEST_CASE("opening rejects a capacity larger than the file") {
+    auto created = chx::ipc::Channel<Message>::create(4);
+    // The capacity follows the 8-byte magic number of the header. Its slots
+    // would wrap the size computed from it around to a small one.
+    const std::uint64_t capacity = std::uint64_t(1) << 62;
+    REQUIRE(::pwrite(created->fd(), &capacity, sizeof(capacity), 8) ==
+            sizeof(capacity));
+    CHECK_THROWS_AS(chx::ipc::Channel<Message>::open(created->fd()),
+                    std::system_error);
+  }
+
+  TEST_CASE("close wakes receivers of other mappings") {
+    auto created = chx::ipc::Channel<int>::create(4);
+    auto opened = chx::OpenSharedChannel<int>(created->fd());
+    std::thread receiver([&] {
+      auto r = opened.receive();
+      CHECK_FALSE(r.has_value());
+      CHECK(r.error() == chx::Error::closed);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    created->close();
+    receiver.join();
+    CHECK(opened.is_closed());
+  }
+
+  TEST_CASE("another process receives every message") {
+    constexpr std::uint64_t messages = 100000;
+    auto ch = chx::CreateSharedChannel<Message>(16);
+    auto results = chx::CreateSharedChannel<std::uint64_t>(2);
+
+    const pid_t child = ::fork();
+    REQUIRE(child >= 0);
+    if (child == 0) {
+      // Sum the sequences, blocking on the shared futexes when the parent is
+      // behind.
+      std::uint64_t sum = 0;
+      std::uint64_t expected = 0;
+      bool in_order = true;
+      for (std::uint64_t i = 0; i < messages; ++i) {
+        auto message = ch.receive();
+        if (!message.has_value()) {
+          ::_exit(2);
+        }
+        in_order = in_order && message->sequence == expected++;
+        sum += message->sequence;
+      }
+      (void)results.send(in_order ? sum : 0);
+      ::_exit(0);
+    }
+
+    auto tx = ch.make_sender();
+    bool sent = true;
+    for (std::uint64_t i = 0; i < messages && sent; ++i) {
+      sent = tx.send(Message{i, {}}).has_value();
+    }
+    CHECK(sent);
+    auto sum = results.receive();
+    int status = 0;
+    REQUIRE(::waitpid(child, &status, 0) == child);
+    CHECK(WIFEXITED(status));
+    CHECK(WEXITSTATUS(status) == 0);
+    REQUIRE(sum.has_value());
+    CHECK(*sum == messages * (messages - 1) / 2);
+  }
+}
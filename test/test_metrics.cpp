@@ -0,0 +1,107 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#ifndef CHX_ENABLE_METRICS
+#define CHX_ENABLE_METRICS
+#endif
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/channel_factory.hpp"
+#include "doctest.h"
+#include <chrono>
+#include <limits>
+#include <thread>
+
+static_assert(chx::metrics_enabled);
+
+TEST_SUITE("Metrics") {
+  TEST_CASE("size and capacity follow the buffer") {
+    auto buffered = chx::CreateChannel<int, 4>();
+    auto spsc = chx::CreateChannel<int, 4, chx::policy::Spsc>();
+    auto mpmc = chx::CreateChannel<int, 4, chx::policy::Mpmc>();
+    auto runtime = chx::CreateChannel<int>(std::size_t{4});
+    auto check = [](auto ch) {
+      CHECK(ch.capacity() == 4);
+      CHECK(ch.size() == 0);
+      auto tx = ch.make_sender();
+      tx.send(1);
+      tx.send(2);
+      tx.send(3);
+      CHECK(ch.size() == 3);
+      CHECK(tx.size() == 3);
+      auto rx = ch.make_receiver();
+      REQUIRE(rx.receive().value() == 1);
+      CHECK(rx.size() == 2);
+    };
+    check(buffered);
+    check(spsc);
+    check(mpmc);
+    check(runtime);
+  }
+
+  TEST_CASE("unbuffered channels never store anything") {
+    auto ch = chx::CreateChannel<int>();
+    CHECK(ch.capacity() == 0);
+    std::thread receiver([rx = ch.make_receiver()]() mutable {
+      REQUIRE(rx.receive().value() == 7);
+    });
+    ch.make_sender().send(7);
+    receiver.join();
+    CHECK(ch.size() == 0);
+    CHECK(ch.metrics().sends == 1);
+    CHECK(ch.metrics().receives == 1);
+  }
+
+  TEST_CASE("unbounded size spans several segments") {
+    auto ch = chx::CreateChannel<int, chx::policy::Unbounded>();
+    CHECK(ch.capacity() == std::numeric_limits<std::size_t>::max());
+    auto tx = ch.make_sender();
+    auto rx = ch.make_receiver();
+    for (int i = 0; i < 100; ++i) {
+      tx.send(i);
+      REQUIRE(ch.size() == static_cast<std::size_t>(i + 1));
+    }
+    for (int i = 0; i < 100; ++i) {
+      REQUIRE(rx.receive().value() == i);
+      REQUIRE(ch.size() == static_cast<std::size_t>(99 - i));
+    }
+  }
+
+  TEST_CASE("counters record operations, failures and depth") {
+    auto ch = chx::CreateChannel<int, 2>();
+    auto tx = ch.make_sender();
+    auto rx = ch.make_receiver();
+    REQUIRE(rx.try_receive().error() == chx::Error::would_block);
+    tx.send(1);
+    tx.send(2);
+    REQUIRE(tx.try_send(3).error() == chx::Error::would_block);
+    REQUIRE(rx.receive().value() == 1);
+    ch.close();
+
+    const chx::ChannelMetrics metrics = rx.metrics();
+    CHECK(metrics.sends == 2);
+    CHECK(metrics.receives == 1);
+    CHECK(metrics.try_send_failures == 1);
+    CHECK(metrics.try_receive_failures == 1);
+    CHECK(metrics.depth == 1);
+    CHECK(metrics.high_water == 2);
+    CHECK(metrics.closes == 1);
+    CHECK(metrics.blocked_sends == 0);
+    CHECK(metrics.blocked_receives == 0);
+  }
+
+  TEST_CASE("blocked operations record the time they waited") {
+    auto ch = chx::CreateChannel<int, 1, chx::policy::Spsc>();
+    auto tx = ch.make_sender();
+    auto rx = ch.make_receiver();
+    tx.send(1);
+    std::thread sender([&] { tx.send(2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    REQUIRE(rx.receive().value() == 1);
+    sender.join();
+    REQUIRE(rx.receive().value() == 2);
+
+    const chx::ChannelMetrics metrics = ch.metrics();
+    CHECK(metrics.blocked_sends == 1);
+    CHECK(metrics.send_blocked_time >= std::chrono::milliseconds(10));
+    CHECK(metrics.blocked_receives == 0);
+  }
+}
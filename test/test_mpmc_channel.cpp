@@ -0,0 +1,177 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/Mpmc/MpmcChannel.hpp"
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/channel_factory.hpp"
+#include "doctest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using chx::mpmc::Channel;
+
+TEST_SUITE("MpmcChannel") {
+  TEST_CASE("try_send fails when buffer is full") {
+    Channel<int, 2> ch;
+    CHECK(ch.send(1).has_value());
+    CHECK(ch.send(2).has_value());
+    auto res = ch.try_send(3);
+    CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("try_receive fails when buffer is empty") {
+    Channel<int, 2> ch;
+    auto res = ch.try_receive();
+    CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("values come out in order") {
+    Channel<int, 4> ch;
+    for (int round = 0; round < 3; ++round) {
+      for (int i = 0; i < 4; ++i) {
+        CHECK(ch.try_send(i).has_value());
+      }
+      for (int i = 0; i < 4; ++i) {
+        auto v = ch.try_receive();
+        REQUIRE(v.has_value());
+        CHECK(*v == i);
+      }
+    }
+  }
+
+  TEST_CASE("send unblocks after receive when buffer was full") {
+    Channel<int, 2> ch;
+    CHECK(ch.send(1).has_value());
+    CHECK(ch.send(2).has_value());
+    std::atomic<bool> sent_third{false};
+    std::thread producer([&] {
+      auto r = ch.send(3);
+      if (r.has_value()) {
+        sent_third = true;
+      }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK_FALSE(sent_third.load());
+    auto v = ch.receive();
+    CHECK(v.has_value());
+    producer.join();
+    CHECK(sent_third.load());
+  }
+
+  TEST_CASE("close wakes blocked receivers") {
+    Channel<int, 4> ch;
+    std::atomic<int> failed = 0;
+    std::vector<std::thread> receivers;
+    for (int i = 0; i < 4; ++i) {
+      receivers.emplace_back([&] {
+        auto res = ch.receive();
+        if (!res.has_value() && res.error() == chx::Error::closed) {
+          ++failed;
+        }
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ch.close();
+    for (auto &t : receivers)
+      t.join();
+    CHECK(failed == 4);
+    CHECK_FALSE(ch.send(1).has_value());
+  }
+
+  TEST_CASE("many senders and receivers deliver every value once") {
+    constexpr int producers = 8;
+    constexpr int consumers = 8;
+    constexpr int per_producer = 20000;
+    Channel<long, 16> ch;
+    std::atomic<long> sum = 0;
+    std::atomic<int> count = 0;
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; ++p) {
+      threads.emplace_back([&] {
+        for (int i = 1; i <= per_producer; ++i) {
+          ch.send(i);
+        }
+      });
+    }
+    for (int c = 0; c < consumers; ++c) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < producers * per_producer / consumers; ++i) {
+          auto v = ch.receive();
+          if (v.has_value()) {
+            sum += *v;
+            ++count;
+          }
+        }
+      });
+    }
+    for (auto &t : threads)
+      t.join();
+
+    CHECK(count == producers * per_producer);
+    CHECK(sum == static_cast<long>(producers) * per_producer *
+                     (per_producer + 1) / 2);
+  }
+
+  TEST_CASE("CreateChannel hands it out through the Mpmc policy") {
+    chx::Channel<int> ch = chx::CreateChannel<int, 8, chx::policy::Mpmc>();
+    auto sender = ch.make_sender();
+    auto receiver = ch.make_receiver();
+    CHECK(sender.send(7).has_value());
+    auto v = receiver.receive();
+    REQUIRE(v.has_value());
+    CHECK(*v == 7);
+  }
+
+  TEST_CASE("send_for and receive_for time out") {
+    using namespace std::chrono_literals;
+    Channel<int, 2> ch;
+    auto empty = ch.receive_for(20ms);
+    CHECK_FALSE(empty.has_value());
+    CHECK(empty.error() == chx::Error::timeout);
+
+    CHECK(ch.send_for(1, 20ms).has_value());
+    CHECK(ch.send_for(2, 20ms).has_value());
+    auto full = ch.send_for(3, 20ms);
+    CHECK_FALSE(full.has_value());
+    CHECK(full.error() == chx::Error::timeout);
+    CHECK(ch.receive_for(20ms).value() == 1);
+  }
+
+  TEST_CASE("only the stored objects are alive") {
+    // No default constructor, and counts the live objects, moved-from ones
+    // included.
+    struct Item {
+      explicit Item(int &live) : live(&live) { ++*this->live; }
+      Item(const Item &other) : live(other.live) { ++*this->live; }
+      Item &operator=(const Item &) = default;
+      ~Item() { --*this->live; }
+      int *live;
+    };
+    auto check = [](auto &ch, int &live) {
+      for (int i = 0; i < 7; ++i) {
+        REQUIRE(ch.send(Item(live)).has_value());
+        REQUIRE(ch.receive().has_value());
+      }
+      CHECK(live == 0);
+      REQUIRE(ch.send(Item(live)).has_value());
+      REQUIRE(ch.send(Item(live)).has_value());
+      CHECK(live == 2);
+    };
+    int live = 0;
+    {
+      Channel<Item, 4> power_of_two;
+      check(power_of_two, live);
+    }
+    // The objects left in the ring are destroyed with the channel.
+    CHECK(live == 0);
+    {
+      Channel<Item, 3> other;
+      check(other, live);
+    }
+    CHECK(live == 0);
+  }
+}
@@ -0,0 +1,152 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/channel_factory.hpp"
+#include "chx/executor.hpp"
+#include "chx/pipeline.hpp"
+#include "doctest.h"
+#include <chrono>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+std::vector<int> iota(int first, int last) {
+  std::vector<int> values(last - first);
+  std::iota(values.begin(), values.end(), first);
+  return values;
+}
+} // namespace
+
+TEST_SUITE("pipeline") {
+  TEST_CASE("map and filter stages share a small pool") {
+    chx::ThreadPoolExecutor pool(2);
+    auto numbers = chx::CreateChannel<int, 16>();
+    auto doubled = chx::CreateChannel<long, 16>();
+    auto kept = chx::CreateChannel<long, 16>();
+
+    chx::pipeline::source(iota(1, 1001), numbers.make_sender(),
+                          {.executor = &pool});
+    chx::pipeline::map(
+        numbers.make_receiver(), doubled.make_sender(),
+        [](int x) { return 2L * x; }, {.workers = 4, .executor = &pool});
+    chx::pipeline::filter(
+        doubled.make_receiver(), kept.make_sender(),
+        [](long x) { return x % 3 == 0; }, {.workers = 2, .executor = &pool});
+
+    long sum = 0;
+    int count = 0;
+    for (long v : kept.make_receiver()) {
+      sum += v;
+      count++;
+    }
+    // Multiples of 3 among 2, 4, ..., 2000: 6, 12, ..., 1998.
+    CHECK(count == 333);
+    CHECK(sum == 6L * 333 * 334 / 2);
+    CHECK(numbers.is_closed());
+    CHECK(doubled.is_closed());
+  }
+
+  TEST_CASE("stages meet each other on unbuffered channels") {
+    chx::ThreadPoolExecutor pool(2);
+    auto numbers = chx::CreateChannel<int>();
+    auto doubled = chx::CreateChannel<long>();
+    auto kept = chx::CreateChannel<long>();
+
+    chx::pipeline::source(iota(1, 1001), numbers.make_sender(),
+                          {.executor = &pool});
+    chx::pipeline::map(
+        numbers.make_receiver(), doubled.make_sender(),
+        [](int x) { return 2L * x; }, {.workers = 3, .executor = &pool});
+    chx::pipeline::filter(
+        doubled.make_receiver(), kept.make_sender(),
+        [](long x) { return x % 3 == 0; }, {.workers = 2, .executor = &pool});
+
+    long sum = 0;
+    int count = 0;
+    for (long v : kept.make_receiver()) {
+      sum += v;
+      count++;
+    }
+    CHECK(count == 333);
+    CHECK(sum == 6L * 333 * 334 / 2);
+    CHECK(numbers.is_closed());
+    CHECK(doubled.is_closed());
+  }
+
+  TEST_CASE("batch groups objects in order and flushes the last batch") {
+    chx::ThreadPoolExecutor pool(1);
+    auto numbers = chx::CreateChannel<int, 4>();
+    auto batches = chx::CreateChannel<std::vector<int>, 4>();
+    chx::pipeline::source(iota(0, 10), numbers.make_sender(),
+                          {.executor = &pool});
+    chx::pipeline::batch(numbers.make_receiver(), batches.make_sender(), 4,
+                         {.executor = &pool});
+
+    std::vector<std::vector<int>> received;
+    for (auto &&b : batches.make_receiver()) {
+      received.push_back(std::move(b));
+    }
+    REQUIRE(received.size() == 3);
+    CHECK(received[0] == std::vector<int>{0, 1, 2, 3});
+    CHECK(received[1] == std::vector<int>{4, 5, 6, 7});
+    CHECK(received[2] == std::vector<int>{8, 9});
+  }
+
+  TEST_CASE("fan_out spreads objects and fan_in merges them back") {
+    chx::ThreadPoolExecutor pool(2);
+    auto numbers = chx::CreateChannel<std::string, 8>();
+    std::vector<chx::SenderChannel<std::string>> senders;
+    std::vector<chx::ReceiverChannel<std::string>> receivers;
+    for (int i = 0; i < 3; ++i) {
+      chx::Channel<std::string> lane = chx::CreateChannel<std::string, 8>();
+      senders.push_back(lane.make_sender());
+      receivers.push_back(lane.make_receiver());
+    }
+    auto merged = chx::CreateChannel<std::string, 8>();
+
+    std::vector<std::string> words;
+    for (int i = 0; i < 300; ++i) {
+      words.push_back(std::to_string(i));
+    }
+    chx::pipeline::source(words, numbers.make_sender(), {.executor = &pool});
+    chx::pipeline::fan_out(numbers.make_receiver(), senders,
+                           {.workers = 2, .executor = &pool});
+    chx::pipeline::fan_in(receivers, merged.make_sender(),
+                          {.executor = &pool});
+
+    long sum = 0;
+    int count = 0;
+    for (auto &&word : merged.make_receiver()) {
+      sum += std::stol(word);
+      count++;
+    }
+    CHECK(count == 300);
+    CHECK(sum == 299L * 300 / 2);
+  }
+
+  TEST_CASE("closing the end of a pipeline stops the stages upstream") {
+    chx::ThreadPoolExecutor pool(2);
+    auto numbers = chx::CreateChannel<int, 4>();
+    auto squares = chx::CreateChannel<int, 4>();
+    chx::pipeline::source(iota(0, 1000000), numbers.make_sender(),
+                          {.executor = &pool});
+    chx::pipeline::map(
+        numbers.make_receiver(), squares.make_sender(),
+        [](int x) { return x * x; }, {.workers = 2, .executor = &pool});
+
+    auto rx = squares.make_receiver();
+    for (int i = 0; i < 5; ++i) {
+      REQUIRE(rx.receive().has_value());
+    }
+    rx.close();
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!numbers.is_closed() &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(numbers.is_closed());
+  }
+}
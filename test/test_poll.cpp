@@ -0,0 +1,154 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/channel.hpp"
+#include "chx/channel_factory.hpp"
+#include "chx/poll.hpp"
+#include "doctest.h"
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace {
+
+bool readable(int fd) {
+  pollfd entry{fd, POLLIN, 0};
+  return ::poll(&entry, 1, 0) == 1 && (entry.revents & POLLIN) != 0;
+}
+
+/**
+ *  @returns The counter of the eventfd, consuming it: the number of times it
+ *  was signalled.
+ * */
+std::uint64_t signals(int fd) {
+  std::uint64_t count = 0;
+  return ::read(fd, &count, sizeof(count)) == sizeof(count) ? count : 0;
+}
+
+} // namespace
+
+TEST_SUITE("PollHandle") {
+  TEST_CASE("the eventfd starts signalled") {
+    auto ch = chx::CreateChannel<int, 4>();
+    REQUIRE(ch.send(1).has_value());
+    chx::PollHandle poll(ch);
+    CHECK(readable(poll.fd()));
+    poll.rearm();
+    CHECK_FALSE(readable(poll.fd()));
+    CHECK(ch.try_receive() == 1);
+  }
+
+  TEST_CASE("a burst of sends signals the eventfd once") {
+    auto ch = chx::CreateChannel<int, 16>();
+    auto rx = ch.make_receiver();
+    chx::PollHandle poll(rx);
+    poll.rearm();
+
+    for (int i = 0; i < 10; ++i) {
+      REQUIRE(ch.send(i).has_value());
+    }
+    CHECK(readable(poll.fd()));
+    CHECK(signals(poll.fd()) == 1);
+
+    // Sends are not signalled again until the handle is rearmed.
+    REQUIRE(ch.send(10).has_value());
+    CHECK_FALSE(readable(poll.fd()));
+    poll.rearm();
+    REQUIRE(ch.send(11).has_value());
+    CHECK(readable(poll.fd()));
+  }
+
+  TEST_CASE("writable handles are signalled when space is freed") {
+    auto ch = chx::CreateChannel<int, 1>();
+    auto tx = ch.make_sender();
+    chx::PollHandle poll(tx, chx::WaitEvent::writable);
+    REQUIRE(tx.send(1).has_value());
+    poll.rearm();
+
+    CHECK(tx.try_send(2).error() == chx::Error::would_block);
+    CHECK_FALSE(readable(poll.fd()));
+    CHECK(ch.receive() == 1);
+    CHECK(readable(poll.fd()));
+    poll.rearm();
+    CHECK(tx.try_send(2).has_value());
+  }
+
+  TEST_CASE("closing the channel signals the eventfd") {
+    auto ch = chx::CreateChannel<int, 4>();
+    chx::PollHandle poll(ch);
+    poll.rearm();
+    ch.close();
+    CHECK(readable(poll.fd()));
+  }
+
+  TEST_CASE("unbuffered receivers are signalled by blocked senders") {
+    auto ch = chx::CreateChannel<int>();
+    chx::PollHandle poll(ch);
+    poll.rearm();
+
+    std::thread producer([&] { REQUIRE(ch.send(7).has_value()); });
+    pollfd entry{poll.fd(), POLLIN, 0};
+    REQUIRE(::poll(&entry, 1, 5000) == 1);
+    poll.rearm();
+    std::expected<int, chx::Error> value = std::unexpected(chx::Error{});
+    // The sender may be signalled before it is ready to hand the value over.
+    while (!(value = ch.try_receive()).has_value()) {
+      std::this_thread::yield();
+    }
+    producer.join();
+    CHECK(*value == 7);
+  }
+
+  TEST_CASE("an epoll loop drains the channel in batches") {
+    constexpr int count = 10000;
+    auto ch = chx::CreateChannel<int, 64>();
+    auto rx = ch.make_receiver();
+    chx::PollHandle poll(rx);
+
+    const int epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    REQUIRE(epoll >= 0);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    REQUIRE(::epoll_ctl(epoll, EPOLL_CTL_ADD, poll.fd(), &event) == 0);
+
+    bool sent = true;
+    std::thread producer([&sent, tx = ch.make_sender()]() mutable {
+      for (int i = 0; i < count; ++i) {
+        sent = tx.send(i).has_value() && sent;
+      }
+    });
+
+    std::vector<int> received;
+    bool closed = false;
+    while (!closed) {
+      epoll_event ready{};
+      REQUIRE(::epoll_wait(epoll, &ready, 1, 5000) == 1);
+      poll.rearm();
+      while (true) {
+        auto value = rx.try_receive();
+        if (!value.has_value()) {
+          closed = value.error() == chx::Error::closed;
+          break;
+        }
+        received.push_back(*value);
+      }
+      if (received.size() == count) {
+        ch.close();
+      }
+    }
+    producer.join();
+    ::close(epoll);
+
+    CHECK(sent);
+    REQUIRE(received.size() == count);
+    bool in_order = true;
+    for (int i = 0; i < count; ++i) {
+      in_order = in_order && received[i] == i;
+    }
+    CHECK(in_order);
+  }
+}
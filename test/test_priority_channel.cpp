@@ -0,0 +1,117 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/Priority/PriorityChannel.hpp"
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/channel_factory.hpp"
+#include "doctest.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using chx::priority::Channel;
+
+TEST_SUITE("PriorityChannel") {
+  TEST_CASE("receive takes from the highest priority lane first") {
+    Channel<int, 3, 8> ch;
+    CHECK(ch.send_to(2, 20).has_value());
+    CHECK(ch.send_to(1, 10).has_value());
+    CHECK(ch.send_to(2, 21).has_value());
+    CHECK(ch.send_to(0, 0).has_value());
+    CHECK(ch.send_to(1, 11).has_value());
+    CHECK(ch.size() == 5);
+    CHECK(ch.size(1) == 2);
+    for (int expected : {0, 10, 11, 20, 21}) {
+      auto v = ch.try_receive();
+      REQUIRE(v.has_value());
+      CHECK(*v == expected);
+    }
+    CHECK(ch.try_receive().error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("plain sends go through the lowest priority lane") {
+    Channel<int, 2, 4> ch;
+    CHECK(ch.send(1).has_value());
+    CHECK(ch.try_send(2).has_value());
+    CHECK(ch.size(Channel<int, 2, 4>::default_lane) == 2);
+    CHECK(ch.send_to(0, 0).has_value());
+    CHECK(*ch.receive() == 0);
+    CHECK(*ch.receive() == 1);
+  }
+
+  TEST_CASE("each lane has its own capacity") {
+    Channel<int, 2, 2> ch;
+    CHECK(ch.capacity() == 4);
+    CHECK(ch.try_send_to(1, 1).has_value());
+    CHECK(ch.try_send_to(1, 2).has_value());
+    auto res = ch.try_send_to(1, 3);
+    REQUIRE_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::would_block);
+    // The control lane still has room while the bulk one is full.
+    CHECK(ch.try_send_to(0, 0).has_value());
+
+    std::atomic<bool> sent{false};
+    std::thread sender([&] {
+      CHECK(ch.send_to(1, 3).has_value());
+      sent = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK_FALSE(sent.load());
+    // Receiving from lane 0 frees no room in lane 1.
+    CHECK(*ch.receive() == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK_FALSE(sent.load());
+    CHECK(*ch.receive() == 1);
+    sender.join();
+    CHECK(sent.load());
+  }
+
+  TEST_CASE("weights keep the lower lanes from starving") {
+    Channel<int, 2, 16> ch({3, 0});
+    for (int i = 0; i < 8; ++i) {
+      CHECK(ch.send_to(0, i).has_value());
+    }
+    CHECK(ch.send_to(1, 100).has_value());
+    CHECK(ch.send_to(1, 101).has_value());
+    std::vector<int> received;
+    std::vector<int> batch(16);
+    auto count = ch.try_receive_many(batch);
+    REQUIRE(count.has_value());
+    received.assign(batch.begin(), batch.begin() + *count);
+    CHECK(received == std::vector<int>{0, 1, 2, 100, 3, 4, 5, 101, 6, 7});
+  }
+
+  TEST_CASE("a blocked receiver wakes up for any lane") {
+    auto ch = chx::CreateChannel<std::string, 4, chx::policy::Priority<2>>();
+    auto rx = ch.make_receiver();
+    auto tx = ch.make_sender();
+    std::thread receiver([&] {
+      auto v = rx.receive();
+      REQUIRE(v.has_value());
+      CHECK(*v == "flush");
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(tx.send_to(0, std::string("flush")).has_value());
+    receiver.join();
+    auto timed_out = tx.send_to_for(5, "data", std::chrono::milliseconds(1));
+    CHECK(timed_out.has_value());
+    CHECK(ch.size() == 1);
+  }
+
+  TEST_CASE("close wakes blocked senders and receivers") {
+    Channel<int, 2, 1> ch;
+    CHECK(ch.send_to(0, 1).has_value());
+    std::thread sender([&] {
+      auto r = ch.send_to(0, 2);
+      CHECK_FALSE(r.has_value());
+      CHECK(r.error() == chx::Error::closed);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ch.close();
+    sender.join();
+    CHECK(ch.is_closed());
+    CHECK(ch.receive().error() == chx::Error::closed);
+    CHECK(ch.send_to(1, 3).error() == chx::Error::closed);
+  }
+}
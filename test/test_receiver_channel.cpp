@@ -1,11 +1,77 @@
 #include "chx/channel_factory.hpp"
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/Buffered/BufferedChannel.hpp"
 #include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
 #include "chx/channel.hpp"
 #include "chx/channel_factory.hpp"
 #include "doctest.h"
 #include <atomic>
+#include <chrono>
+#include <ranges>
+#include <string>
 #include <thread>
+#include <vector>
+
+namespace {
+/**
+ *  @brief Buffered channel that counts the receive operations reaching it.
+ * */
+class CountingCore final : public chx::ChannelCore<int> {
+public:
+  std::expected<void, chx::Error> send(int &&v) override {
+    return inner_.send(v);
+  }
+  std::expected<void, chx::Error> send(const int &v) override {
+    return inner_.send(v);
+  }
+  std::expected<void, chx::Error> try_send(int &&v) override {
+    return inner_.try_send(v);
+  }
+  std::expected<void, chx::Error> try_send(const int &v) override {
+    return inner_.try_send(v);
+  }
+  std::expected<int, chx::Error> receive() override {
+    this->calls++;
+    return inner_.receive();
+  }
+  std::expected<int, chx::Error> try_receive() override {
+    this->calls++;
+    return inner_.try_receive();
+  }
+  std::expected<void, chx::Error> send_until(int &&v,
+                                             chx::Deadline d) override {
+    return inner_.send_until(v, d);
+  }
+  std::expected<void, chx::Error> send_until(const int &v,
+                                             chx::Deadline d) override {
+    return inner_.send_until(v, d);
+  }
+  std::expected<int, chx::Error> receive_until(chx::Deadline d) override {
+    this->calls++;
+    return inner_.receive_until(d);
+  }
+  std::expected<std::size_t, chx::Error>
+  receive_many(std::span<int> out, std::size_t min, std::size_t max) override {
+    this->calls++;
+    return inner_.receive_many(out, min, max);
+  }
+  std::expected<std::size_t, chx::Error>
+  try_receive_many(std::span<int> out) override {
+    this->calls++;
+    return inner_.try_receive_many(out);
+  }
+  void close() override { inner_.close(); }
+  bool is_closed() const override { return inner_.is_closed(); }
+  std::size_t size() const override { return inner_.size(); }
+  std::size_t capacity() const override { return inner_.capacity(); }
+
+  int calls = 0;
+
+private:
+  chx::buffered::Channel<int, 128> inner_;
+};
+} // namespace
 
 TEST_SUITE("ReceiverChannel") {
   TEST_CASE("receive obtains value from sender") {
@@ -38,6 +104,132 @@ TEST_SUITE("ReceiverChannel") {
     receiver.close();
     auto res = receiver.receive();
     CHECK_FALSE(res.has_value());
-    CHECK(res.error() == std::string("channel closed"));
+    CHECK(res.error() == chx::Error::closed);
+  }
+
+  TEST_CASE("receive_many waits for min values on an unbuffered channel") {
+    chx::Channel<int> ch = chx::CreateChannel<int>();
+    auto receiver = ch.make_receiver();
+
+    std::thread producer([&] {
+      for (int i = 0; i < 3; ++i) {
+        ch.send(i);
+      }
+    });
+
+    std::vector<int> out(3);
+    auto received = receiver.receive_many(out, 3);
+    producer.join();
+    REQUIRE(received.has_value());
+    CHECK(*received == 3);
+    CHECK(out == std::vector<int>{0, 1, 2});
+  }
+
+  TEST_CASE("receive_for times out when no sender arrives") {
+    chx::Channel<int> ch = chx::CreateChannel<int, 4>();
+    auto receiver = ch.make_receiver();
+    auto res = receiver.receive_for(std::chrono::milliseconds(20));
+    CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::timeout);
+  }
+
+  TEST_CASE("receivers are input ranges that end when the channel closes") {
+    static_assert(std::ranges::input_range<chx::ReceiverChannel<int>>);
+    static_assert(std::ranges::input_range<chx::Channel<int>>);
+    static_assert(std::ranges::input_range<
+                  decltype(chx::CreateChannel<int, 8>().make_receiver())>);
+
+    chx::Channel<int> ch = chx::CreateChannel<int>();
+    std::thread producer([sender = ch.make_sender()]() mutable {
+      for (int i = 1; i <= 100; ++i) {
+        sender.send(i);
+      }
+      sender.close();
+    });
+
+    int sum = 0;
+    int count = 0;
+    for (auto &&v : ch.make_receiver()) {
+      sum += v;
+      count++;
+    }
+    producer.join();
+    CHECK(count == 100);
+    CHECK(sum == 5050);
+  }
+
+  TEST_CASE("leaving a range loop early keeps the other objects") {
+    auto ch = chx::CreateChannel<int, 64>();
+    auto sender = ch.make_sender();
+    for (int i = 0; i < 20; ++i) {
+      sender.send(i);
+    }
+    auto receiver = ch.make_receiver();
+    for (int v : receiver) {
+      CHECK(v == 0);
+      break;
+    }
+    // The loop took a whole batch, and left the rest in the handle.
+    CHECK(ch.size() == 0);
+
+    std::vector<int> doubled;
+    for (int v : receiver | std::views::transform([](int x) { return x * 2; }) |
+                     std::views::take(9)) {
+      doubled.push_back(v);
+    }
+    CHECK(doubled == std::vector<int>{2, 4, 6, 8, 10, 12, 14, 16, 18});
+    CHECK(receiver.receive() == 10);
+    CHECK(receiver.try_receive() == 11);
+    std::vector<int> out(4);
+    REQUIRE(receiver.receive_many(out, 4) == 4);
+    CHECK(out == std::vector<int>{12, 13, 14, 15});
+
+    // Closing the channel keeps the objects of the handle.
+    sender.close();
+    std::vector<int> rest;
+    for (int v : receiver) {
+      rest.push_back(v);
+    }
+    CHECK(rest == std::vector<int>{16, 17, 18, 19});
+  }
+
+  TEST_CASE("range loops take one batch per lock acquisition") {
+    auto core = std::make_shared<CountingCore>();
+    chx::Channel<int, CountingCore> rx(core);
+    for (int i = 0; i < 100; ++i) {
+      REQUIRE(rx.send(i).has_value());
+    }
+
+    int count = 0;
+    long sum = 0;
+    for (int v : rx | std::views::take(100)) {
+      sum += v;
+      count++;
+    }
+    CHECK(count == 100);
+    CHECK(sum == 4950);
+    // 100 objects in batches of `receive_batch_size`.
+    CHECK(core->calls == 4);
+    CHECK(rx.try_receive().error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("iteration receives types without a default constructor") {
+    struct Named {
+      explicit Named(std::string n) : name(std::move(n)) {}
+      std::string name;
+    };
+    auto ch = chx::CreateChannel<Named, 4>();
+    auto sender = ch.make_sender();
+    sender.send(Named("a"));
+    sender.send(Named("b"));
+
+    std::string names;
+    for (auto &&v : ch.make_receiver()) {
+      names += std::move(v.name);
+      if (names.size() == 2) {
+        break;
+      }
+    }
+    CHECK(names == "ab");
   }
 }
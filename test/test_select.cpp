@@ -0,0 +1,212 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/channel_factory.hpp"
+#include "chx/select.hpp"
+#include "doctest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST_SUITE("select") {
+  TEST_CASE("receives from the channel that has a value") {
+    auto a = chx::CreateChannel<int, 4>();
+    auto b = chx::CreateChannel<int, 4>();
+    b.send(7);
+    int got = 0;
+    auto fired = chx::select(
+        chx::on_receive(a, [&](std::expected<int, chx::Error>) { got = -1; }),
+        chx::on_receive(b, [&](std::expected<int, chx::Error> v) {
+          got = v.value();
+        }));
+    CHECK(fired == 1);
+    CHECK(got == 7);
+  }
+
+  TEST_CASE("default case runs when nothing is ready") {
+    auto a = chx::CreateChannel<int, 1>();
+    a.send(1);
+    bool defaulted = false;
+    auto fired = chx::select(
+        chx::on_receive(a.make_receiver(), [](auto) {}),
+        chx::on_send(a.make_sender(), 2, [](auto) {}),
+        chx::on_default([&] { defaulted = true; }));
+    // The receive case is ready, so the default case must not run.
+    CHECK(fired == 0);
+    CHECK_FALSE(defaulted);
+
+    fired = chx::select(chx::on_receive(a, [](auto) {}),
+                        chx::on_default([&] { defaulted = true; }));
+    CHECK(fired == 1);
+    CHECK(defaulted);
+  }
+
+  TEST_CASE("blocks until a channel becomes ready") {
+    auto a = chx::CreateChannel<int, 4>();
+    auto b = chx::CreateChannel<int, 4, chx::policy::Mpmc>();
+    std::thread producer([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      b.send(42);
+    });
+    int got = 0;
+    auto fired = chx::select(
+        chx::on_receive(a, [&](auto) { got = -1; }),
+        chx::on_receive(b, [&](std::expected<int, chx::Error> v) {
+          got = v.value();
+        }));
+    producer.join();
+    CHECK(fired == 1);
+    CHECK(got == 42);
+  }
+
+  TEST_CASE("send case waits for free space") {
+    auto a = chx::CreateChannel<int, 1, chx::policy::Spsc>();
+    a.send(1);
+    std::thread consumer([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      a.receive();
+    });
+    bool sent = false;
+    auto fired = chx::select(chx::on_send(a, 2, [&](auto r) {
+      sent = r.has_value();
+    }));
+    consumer.join();
+    CHECK(fired == 0);
+    CHECK(sent);
+    CHECK(a.receive().value() == 2);
+  }
+
+  TEST_CASE("meets blocked counterparts on unbuffered channels") {
+    auto a = chx::CreateChannel<int>();
+    std::thread producer([&] { a.send(5); });
+    int got = 0;
+    chx::select(chx::on_receive(
+        a, [&](std::expected<int, chx::Error> v) { got = v.value(); }));
+    producer.join();
+    CHECK(got == 5);
+
+    std::thread consumer([&] { got = a.receive().value(); });
+    chx::select(chx::on_send(a, 6, [](auto) {}));
+    consumer.join();
+    CHECK(got == 6);
+  }
+
+  TEST_CASE("two selects meet on an unbuffered channel") {
+    auto a = chx::CreateChannel<int>();
+    std::thread sender(
+        [&] { chx::select(chx::on_send(a.make_sender(), 8, [](auto) {})); });
+    int got = 0;
+    chx::select(chx::on_receive(
+        a, [&](std::expected<int, chx::Error> v) { got = v.value(); }));
+    sender.join();
+    CHECK(got == 8);
+  }
+
+  TEST_CASE("selects over several unbuffered channels fire one case each") {
+    constexpr int rounds = 2000;
+    auto a = chx::CreateChannel<int>();
+    auto b = chx::CreateChannel<int>();
+    std::vector<std::thread> threads;
+    std::atomic<long> sent{0};
+    for (int t = 0; t < 2; ++t) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < rounds; ++i) {
+          const int value = t * rounds + i;
+          chx::select(chx::on_send(a, value, [&](auto) { sent += value; }),
+                      chx::on_send(b, value, [&](auto) { sent += value; }));
+        }
+      });
+    }
+    std::atomic<long> received{0};
+    std::atomic<int> count{0};
+    for (int t = 0; t < 2; ++t) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < rounds; ++i) {
+          auto take = [&](std::expected<int, chx::Error> v) {
+            received += v.value();
+            count++;
+          };
+          chx::select(chx::on_receive(b, take), chx::on_receive(a, take));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    CHECK(count == 2 * rounds);
+    CHECK(received == sent);
+    CHECK(sent == (2L * rounds - 1) * 2 * rounds / 2);
+  }
+
+  TEST_CASE("unbuffered and buffered cases wait together") {
+    auto a = chx::CreateChannel<int>();
+    auto c = chx::CreateChannel<int, 4>();
+    std::thread producer([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      c.send(3);
+    });
+    int got = 0;
+    auto fired = chx::select(
+        chx::on_receive(a, [&](auto) { got = -1; }),
+        chx::on_receive(c, [&](std::expected<int, chx::Error> v) {
+          got = v.value();
+        }));
+    producer.join();
+    CHECK(fired == 1);
+    CHECK(got == 3);
+    // The node of the unbuffered case was withdrawn.
+    CHECK(a.try_send(1).error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("closing an unbuffered channel wakes a select waiting on it") {
+    auto a = chx::CreateChannel<int>();
+    auto b = chx::CreateChannel<int>();
+    std::thread closer([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      b.close();
+    });
+    chx::Error error = chx::Error::would_block;
+    auto fired = chx::select(
+        chx::on_send(a, 1, [](auto) {}),
+        chx::on_receive(b, [&](std::expected<int, chx::Error> v) {
+          error = v.error();
+        }));
+    closer.join();
+    CHECK(fired == 1);
+    CHECK(error == chx::Error::closed);
+  }
+
+  TEST_CASE("a closed channel fires its case with an error") {
+    auto a = chx::CreateChannel<int, 4>();
+    auto b = chx::CreateChannel<int, 4>();
+    std::thread closer([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      b.close();
+    });
+    chx::Error error = chx::Error::would_block;
+    auto fired = chx::select(
+        chx::on_receive(a, [](auto) {}),
+        chx::on_receive(b, [&](std::expected<int, chx::Error> v) {
+          error = v.error();
+        }));
+    closer.join();
+    CHECK(fired == 1);
+    CHECK(error == chx::Error::closed);
+  }
+
+  TEST_CASE("every ready case gets picked eventually") {
+    auto a = chx::CreateChannel<int, 64>();
+    auto b = chx::CreateChannel<int, 64>();
+    int picks[2] = {0, 0};
+    for (int i = 0; i < 50; ++i) {
+      a.try_send(i);
+      b.try_send(i);
+      auto fired = chx::select(chx::on_receive(a, [](auto) {}),
+                               chx::on_receive(b, [](auto) {}));
+      picks[fired]++;
+    }
+    CHECK(picks[0] > 0);
+    CHECK(picks[1] > 0);
+  }
+}
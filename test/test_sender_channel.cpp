@@ -5,7 +5,11 @@
 #include "chx/channel_factory.hpp"
 #include "doctest.h"
 #include <atomic>
+#include <chrono>
+#include <list>
 #include <thread>
+#include <type_traits>
+#include <vector>
 
 TEST_SUITE("SenderChannel") {
   TEST_CASE("send delivers value to receiver") {
@@ -42,6 +46,54 @@ TEST_SUITE("SenderChannel") {
     sender.close();
     auto res = sender.send(1);
     CHECK_FALSE(res.has_value());
-    CHECK(res.error() == std::string("channel closed"));
+    CHECK(res.error() == chx::Error::closed);
+  }
+
+  TEST_CASE("send_many moves a range through the channel") {
+    chx::Channel<int> ch = chx::CreateChannel<int, 8>();
+    auto sender = ch.make_sender();
+    std::vector<int> values = {1, 2, 3};
+    auto sent = sender.send_many(values.begin(), values.end());
+    REQUIRE(sent.has_value());
+    CHECK(*sent == 3);
+
+    std::list<int> more = {4, 5};
+    sent = sender.send_many(more.begin(), more.end());
+    REQUIRE(sent.has_value());
+    CHECK(*sent == 2);
+
+    for (int i = 1; i <= 5; ++i) {
+      auto v = ch.try_receive();
+      REQUIRE(v.has_value());
+      CHECK(*v == i);
+    }
+  }
+
+  TEST_CASE("send_until times out when no receiver arrives") {
+    chx::Channel<int> ch = chx::CreateChannel<int>();
+    auto sender = ch.make_sender();
+    auto res = sender.send_until(1, std::chrono::system_clock::now() +
+                                        std::chrono::milliseconds(20));
+    CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::timeout);
+  }
+
+  TEST_CASE("statically typed senders convert to the type-erased handle") {
+    auto ch = chx::CreateChannel<int, 4>();
+    using Core = chx::buffered::Channel<int, 4>;
+    static_assert(std::is_same_v<decltype(ch)::core_type, Core>);
+    auto sender = ch.make_sender();
+    static_assert(
+        std::is_same_v<decltype(sender), chx::SenderChannel<int, Core>>);
+
+    chx::SenderChannel<int> erased = sender;
+    chx::Channel<int> erased_ch = ch;
+    REQUIRE(sender.send(1).has_value());
+    REQUIRE(erased.send(2).has_value());
+    CHECK(erased_ch.receive().value() == 1);
+    CHECK(ch.receive().value() == 2);
+
+    erased.close();
+    CHECK(sender.is_closed());
   }
 }
@@ -0,0 +1,143 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/Spsc/SpscChannel.hpp"
+#include "chx/channel_factory.hpp"
+#include "doctest.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using chx::spsc::Channel;
+
+TEST_SUITE("SpscChannel") {
+  TEST_CASE("try_send fails when buffer is full") {
+    Channel<int, 2> ch;
+    CHECK(ch.send(1).has_value());
+    CHECK(ch.send(2).has_value());
+    auto res = ch.try_send(3);
+    CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("try_receive fails when buffer is empty") {
+    Channel<int, 1> ch;
+    auto res = ch.try_receive();
+    CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("receive waits until an element is available") {
+    Channel<int, 1> ch;
+    std::thread producer([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      ch.send(42);
+    });
+    auto result = ch.receive();
+    CHECK(result.has_value());
+    CHECK(result.value() == 42);
+    producer.join();
+  }
+
+  TEST_CASE("send unblocks after receive when buffer was full") {
+    Channel<int, 2> ch;
+    CHECK(ch.send(1).has_value());
+    CHECK(ch.send(2).has_value());
+    std::atomic<bool> sent_third{false};
+    std::thread producer([&] {
+      auto r = ch.send(3);
+      if (r.has_value()) {
+        sent_third = true;
+      }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK_FALSE(sent_third.load());
+    auto v = ch.receive();
+    CHECK(v.has_value());
+    producer.join();
+    CHECK(sent_third.load());
+  }
+
+  TEST_CASE("close wakes a blocked receiver") {
+    Channel<int, 4> ch;
+    std::thread closer([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      ch.close();
+    });
+    auto res = ch.receive();
+    closer.join();
+    CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::closed);
+    CHECK(ch.is_closed());
+    CHECK_FALSE(ch.send(1).has_value());
+  }
+
+  TEST_CASE("one producer and one consumer keep order") {
+    constexpr int N = 200000;
+    Channel<int, 64> ch;
+    bool in_order = true;
+
+    std::thread consumer([&] {
+      for (int i = 0; i < N; ++i) {
+        auto v = ch.receive();
+        if (!v.has_value() || *v != i) {
+          in_order = false;
+        }
+      }
+    });
+    for (int i = 0; i < N; ++i) {
+      ch.send(i);
+    }
+    consumer.join();
+    CHECK(in_order);
+  }
+
+  TEST_CASE("CreateChannel hands it out through the Spsc policy") {
+    chx::Channel<int> ch = chx::CreateChannel<int, 8, chx::policy::Spsc>();
+    auto sender = ch.make_sender();
+    auto receiver = ch.make_receiver();
+    CHECK(sender.send(7).has_value());
+    auto v = receiver.receive();
+    REQUIRE(v.has_value());
+    CHECK(*v == 7);
+  }
+
+  TEST_CASE("send_for and receive_for time out") {
+    using namespace std::chrono_literals;
+    Channel<int, 2> ch;
+    auto empty = ch.receive_for(20ms);
+    CHECK_FALSE(empty.has_value());
+    CHECK(empty.error() == chx::Error::timeout);
+
+    CHECK(ch.send_for(1, 20ms).has_value());
+    CHECK(ch.send_for(2, 20ms).has_value());
+    auto full = ch.send_for(3, 20ms);
+    CHECK_FALSE(full.has_value());
+    CHECK(full.error() == chx::Error::timeout);
+    CHECK(ch.receive_for(20ms).value() == 1);
+  }
+
+  TEST_CASE("only the stored objects are alive") {
+    // No default constructor: the ring is not filled up front.
+    struct Item {
+      explicit Item(std::shared_ptr<int> p) : ptr(std::move(p)) {}
+      std::shared_ptr<int> ptr;
+    };
+    auto tracked = std::make_shared<int>(1);
+    {
+      Channel<Item, 3> ch;
+      for (int i = 0; i < 5; ++i) {
+        REQUIRE(ch.send(Item(tracked)).has_value());
+        REQUIRE(ch.receive().has_value());
+      }
+      // Popped objects are destroyed, not left moved-from in their slot.
+      CHECK(tracked.use_count() == 1);
+      REQUIRE(ch.send(Item(tracked)).has_value());
+      REQUIRE(ch.send(Item(tracked)).has_value());
+      CHECK(tracked.use_count() == 3);
+    }
+    // The objects left in the ring are destroyed with the channel.
+    CHECK(tracked.use_count() == 1);
+  }
+}
@@ -0,0 +1,132 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/Unbounded/UnboundedChannel.hpp"
+#include "chx/channel_factory.hpp"
+#include "doctest.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using chx::unbounded::Channel;
+
+TEST_SUITE("UnboundedChannel") {
+  TEST_CASE("send never blocks and keeps FIFO order") {
+    Channel<int> ch;
+    constexpr int N = 10000;
+    for (int i = 0; i < N; ++i) {
+      REQUIRE(ch.try_send(i).has_value());
+    }
+    for (int i = 0; i < N; ++i) {
+      auto v = ch.try_receive();
+      REQUIRE(v.has_value());
+      CHECK(*v == i);
+    }
+    auto empty = ch.try_receive();
+    REQUIRE_FALSE(empty.has_value());
+    CHECK(empty.error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("segments are reused in steady state") {
+    Channel<int> ch;
+    for (int round = 0; round < 10000; ++round) {
+      for (int i = 0; i < 10; ++i) {
+        ch.send(i);
+      }
+      for (int i = 0; i < 10; ++i) {
+        REQUIRE(ch.receive().value() == i);
+      }
+    }
+    CHECK(ch.segments_allocated() <= 3);
+  }
+
+  TEST_CASE("receive waits until an element is available") {
+    Channel<int> ch;
+    std::thread producer([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      ch.send(42);
+    });
+    auto v = ch.receive();
+    producer.join();
+    REQUIRE(v.has_value());
+    CHECK(*v == 42);
+  }
+
+  TEST_CASE("receive_for times out when nothing is sent") {
+    Channel<int> ch;
+    auto v = ch.receive_until(chx::detail::deadline_after(
+        std::chrono::milliseconds(10)));
+    REQUIRE_FALSE(v.has_value());
+    CHECK(v.error() == chx::Error::timeout);
+  }
+
+  TEST_CASE("multiple senders and receivers") {
+    auto ch = chx::CreateChannel<int, chx::policy::Unbounded>();
+    constexpr int senders = 4;
+    constexpr int receivers = 4;
+    constexpr int per_sender = 20000;
+    std::atomic<long long> sum = 0;
+    std::atomic<int> count = 0;
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < receivers; ++r) {
+      threads.emplace_back([&, rx = ch.make_receiver()]() mutable {
+        for (;;) {
+          auto v = rx.receive();
+          if (!v.has_value()) {
+            break;
+          }
+          sum += *v;
+          count++;
+        }
+      });
+    }
+    std::vector<std::thread> producers;
+    for (int s = 0; s < senders; ++s) {
+      producers.emplace_back([&, tx = ch.make_sender()]() mutable {
+        for (int i = 1; i <= per_sender; ++i) {
+          tx.send(i);
+        }
+      });
+    }
+    for (auto &t : producers) {
+      t.join();
+    }
+    while (count < senders * per_sender) {
+      std::this_thread::yield();
+    }
+    ch.close();
+    for (auto &t : threads) {
+      t.join();
+    }
+    CHECK(count == senders * per_sender);
+    CHECK(sum == static_cast<long long>(senders) * per_sender *
+                     (per_sender + 1) / 2);
+  }
+
+  TEST_CASE("close prevents further send and receive operations") {
+    Channel<int> ch;
+    ch.send(1);
+    ch.close();
+    CHECK(ch.is_closed());
+    CHECK(ch.send(2).error() == chx::Error::closed);
+    CHECK(ch.receive().error() == chx::Error::closed);
+  }
+
+  TEST_CASE("elements left in the channel are destroyed with it") {
+    auto tracked = std::make_shared<int>(1);
+    {
+      Channel<std::shared_ptr<int>> ch;
+      for (int i = 0; i < 100; ++i) {
+        ch.send(tracked);
+      }
+      for (int i = 0; i < 40; ++i) {
+        REQUIRE(ch.receive().has_value());
+      }
+      CHECK(tracked.use_count() == 61);
+    }
+    CHECK(tracked.use_count() == 1);
+  }
+}
@@ -2,6 +2,7 @@
 #include "chx/Unbuffered/UnbufferedChannel.hpp"
 #include "doctest.h"
 #include <atomic>
+#include <chrono>
 #include <latch>
 #include <thread>
 #include <vector>
@@ -30,12 +31,14 @@ TEST_SUITE("UnbufferedChannel") {
     Channel<int> ch;
     auto res = ch.try_send(5);
     CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::would_block);
   }
 
   TEST_CASE("try_receive fails when no sender") {
     Channel<int> ch;
     auto res = ch.try_receive();
     CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::would_block);
   }
 
   TEST_CASE("try_send/try_receive succeed when counterpart waiting") {
@@ -125,4 +128,111 @@ TEST_SUITE("UnbufferedChannel") {
     CHECK(produced == N);
     CHECK(consumed == N);
   }
+
+  TEST_CASE("send_for withdraws its value when nobody receives it") {
+    using namespace std::chrono_literals;
+    Channel<int> ch;
+    auto res = ch.send_for(1, 20ms);
+    CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::timeout);
+    CHECK(ch.try_receive().error() == chx::Error::would_block);
+
+    std::thread producer([&] { ch.send(2); });
+    auto v = ch.receive();
+    producer.join();
+    REQUIRE(v.has_value());
+    CHECK(*v == 2);
+  }
+
+  TEST_CASE("receive_for times out without a sender") {
+    using namespace std::chrono_literals;
+    Channel<int> ch;
+    auto res = ch.receive_for(20ms);
+    CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::timeout);
+    CHECK(ch.try_send(1).error() == chx::Error::would_block);
+  }
+
+  TEST_CASE("close releases a sender waiting for its receiver") {
+    Channel<int> ch;
+    std::latch sending{1};
+    std::thread closer([&] {
+      sending.wait();
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      ch.close();
+    });
+    sending.count_down();
+    auto res = ch.send(1);
+    closer.join();
+    CHECK_FALSE(res.has_value());
+    CHECK(res.error() == chx::Error::closed);
+  }
+
+  TEST_CASE("blocked senders are served in arrival order") {
+    using namespace std::chrono_literals;
+    Channel<int> ch;
+    std::vector<std::thread> senders;
+    for (int i = 0; i < 3; ++i) {
+      senders.emplace_back([&ch, i] { ch.send(i); });
+      std::this_thread::sleep_for(20ms);
+    }
+    // A receiver that gives up leaves no trace in the queue.
+    CHECK(ch.receive_for(0ms).value() == 0);
+    CHECK(ch.receive().value() == 1);
+    CHECK(ch.try_receive().value() == 2);
+    for (auto &t : senders) {
+      t.join();
+    }
+  }
+
+  TEST_CASE("a receiver that timed out does not take a later value") {
+    using namespace std::chrono_literals;
+    Channel<int> ch;
+    std::thread patient([&] { CHECK(ch.receive().value() == 7); });
+    std::this_thread::sleep_for(10ms);
+    CHECK(ch.receive_for(10ms).error() == chx::Error::timeout);
+    CHECK(ch.send(7).has_value());
+    patient.join();
+  }
+
+  TEST_CASE("spin-then-park channel rendez-vous between many threads") {
+    constexpr int N = 2000;
+    Channel<int, chx::wait::SpinThenPark> ch;
+    std::atomic<long> sum{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < N; ++i) {
+          ch.send(t * N + i);
+        }
+      });
+      threads.emplace_back([&] {
+        for (int i = 0; i < N; ++i) {
+          sum += ch.receive().value_or(0);
+        }
+      });
+    }
+    for (auto &t : threads) {
+      t.join();
+    }
+    const long total = 4L * N;
+    CHECK(sum == total * (total - 1) / 2);
+  }
+
+  TEST_CASE("spin-then-park channel times out and wakes on close") {
+    Channel<int, chx::wait::SpinThenPark> ch;
+    auto v = ch.receive_until(chx::detail::deadline_after(
+        std::chrono::milliseconds(20)));
+    REQUIRE_FALSE(v.has_value());
+    CHECK(v.error() == chx::Error::timeout);
+
+    std::thread receiver([&] {
+      auto r = ch.receive();
+      CHECK(r.error() == chx::Error::closed);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ch.close();
+    receiver.join();
+  }
 }
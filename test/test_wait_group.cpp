@@ -0,0 +1,120 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "chx/ReceiverChannel.hpp"
+#include "chx/SenderChannel.hpp"
+#include "chx/channel_factory.hpp"
+#include "chx/wait_group.hpp"
+#include "doctest.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_SUITE("WaitGroup") {
+  TEST_CASE("wait returns right away without pending tasks") {
+    chx::WaitGroup group;
+    group.wait();
+    CHECK(group.pending() == 0);
+  }
+
+  TEST_CASE("wait blocks until every task is done") {
+    chx::WaitGroup group;
+    std::atomic<int> finished{0};
+    std::vector<std::thread> workers;
+    group.add(100);
+    for (int i = 0; i < 100; ++i) {
+      workers.emplace_back([&] {
+        finished++;
+        group.done();
+      });
+    }
+    group.wait();
+    CHECK(finished == 100);
+    CHECK(group.pending() == 0);
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  TEST_CASE("wait_for times out while tasks are pending") {
+    chx::WaitGroup group;
+    group.add();
+    CHECK_FALSE(group.wait_for(std::chrono::milliseconds(10)));
+    CHECK(group.pending() == 1);
+    group.done();
+    CHECK(group.wait_for(std::chrono::milliseconds(10)));
+  }
+
+  TEST_CASE("the group can be destroyed as soon as wait returns") {
+    for (int round = 0; round < 1000; ++round) {
+      auto group = std::make_unique<chx::WaitGroup>();
+      int calls = 0;
+      group->add();
+      group->when_done([&] { calls++; });
+      std::thread worker([g = group.get()] { g->done(); });
+      group->wait();
+      group.reset();
+      worker.join();
+      REQUIRE(calls == 1);
+    }
+  }
+
+  TEST_CASE("close_when_done ends the fan-in channel") {
+    auto results = chx::CreateChannel<int>();
+    chx::WaitGroup group;
+    group.add(8);
+    group.close_when_done(results);
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 8; ++w) {
+      workers.emplace_back([&, sender = results.make_sender()]() mutable {
+        for (int i = 1; i <= 10; ++i) {
+          sender.send(i);
+        }
+        group.done();
+      });
+    }
+    int sum = 0;
+    for (int v : results.make_receiver()) {
+      sum += v;
+    }
+    CHECK(sum == 8 * 55);
+    CHECK(results.is_closed());
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  TEST_CASE("close_when_done lets receivers drain a buffered channel") {
+    auto results = chx::CreateChannel<int, 8>();
+    chx::WaitGroup group;
+    group.add(4);
+    group.close_when_done(results);
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 4; ++w) {
+      workers.emplace_back([&, w, sender = results.make_sender()]() mutable {
+        sender.send(w);
+        group.done();
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    // Every worker is done before anything is received.
+    CHECK(results.size() == 4);
+    std::vector<int> received;
+    for (int v : results.make_receiver()) {
+      received.push_back(v);
+    }
+    std::sort(received.begin(), received.end());
+    CHECK(received == std::vector<int>{0, 1, 2, 3});
+    CHECK(results.is_closed());
+  }
+
+  TEST_CASE("close_when_done closes right away when nothing is pending") {
+    auto ch = chx::CreateChannel<int, 4>();
+    chx::WaitGroup group;
+    group.close_when_done(ch.make_sender());
+    CHECK(ch.is_closed());
+  }
+}